@@ -3,13 +3,15 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 
 #include "shader.h"
 #include "glmutils.h"
 
 #include "plane_model.h"
 #include "primitives.h"
+#include "frame_pacer.h"
+#include "uniform_buffer.h"
+#include "render_queue.h"
 
 #include <random>
 
@@ -18,9 +20,9 @@
 struct SceneObject{
     unsigned int VAO;
     unsigned int vertexCount;
-    void drawSceneObject() const{
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,  vertexCount, GL_UNSIGNED_INT, 0);
+    // adds the draw of the object with program and a transform of the queue
+    void queueSceneObject(RenderQueue &queue, unsigned int program, uint32_t transform) const{
+        queue.add(program, VAO, 0, transform, vertexCount);
     }
 };
 
@@ -44,7 +46,7 @@ void processInput(GLFWwindow* window);
 void cursor_input_callback(GLFWwindow* window, double posX, double posY);
 void drawCube(glm::mat4 model);
 void drawPlane(glm::mat4 model);
-void drawParticles(glm::mat4 viewProjection, int windOffset, int gravityOffset); //particles: d
+void drawParticles(int windOffset, int gravityOffset); //particles: d
 
 // screen settings
 // ---------------
@@ -65,6 +67,28 @@ std::vector<Shader> shaderParticlePrograms;
 Shader* activeParticleShader;
 int activeParticleShaderID = 0;
 
+// the particle uniforms that are the same for the 20 instances, uploaded once per frame to a uniform buffer that both
+// particle shaders read, the members follow the std140 layout of the Particles block in the shaders
+struct ParticlesBlock {
+    alignas(16) glm::mat4 viewProjection;
+    alignas(16) glm::mat4 prevViewProjection;
+    alignas(16) glm::vec3 camPosition;
+    alignas(16) glm::vec3 camForward;
+    float boxSize;
+};
+ParticlesBlock particlesBlock;
+UniformBuffer<ParticlesBlock>* particlesBuffer;
+
+// the uniforms set for every draw, looked up by name once and not in every draw (see Shader::uniform)
+struct Uniforms {
+    Shader::Uniform offsets = Shader::uniform("offsets");
+    Shader::Uniform instanceVelocity = Shader::uniform("instanceVelocity");
+} uniforms;
+
+// the draws of the scene, sorted by program and vertex array before they are issued (see render_queue.h), the
+// shaders take the model view projection matrix in "model"
+RenderQueue renderQueue(true);
+
 // global variables used for control
 // ---------------------------------
 float currentTime;
@@ -143,15 +167,13 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
 
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count(); //d
+        currentTime = pacer.beginFrame(); //d
 
         processInput(window);
 
@@ -168,13 +190,11 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
+    delete particlesBuffer;
 
     //particles: deleting the shaderProgramParticles
     //delete activeParticleShader;
@@ -199,22 +219,33 @@ void drawObjects(){
     glm::mat4 view = glm::lookAt(camPosition, camPosition + camForward, glm::vec3(0,1,0));
     glm::mat4 viewProjection = projection * view;
 
+    // the objects are added to the queue with their model matrix, and drawn by submit()
+    renderQueue.begin(viewProjection);
+
     // draw floor (the floor was built so that it does not need to be transformed)
-    shaderProgram->use();
-    shaderProgram->setMat4("model", viewProjection);
-    floorObj.drawSceneObject();
+    floorObj.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(glm::mat4(1.0f)));
 
     // draw 2 cubes and 2 planes in different locations and with different orientations
-    drawCube(viewProjection * glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
-    drawCube(viewProjection * glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+    drawCube(glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
+    drawCube(glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+
+    drawPlane(glm::translate(-2.0f, .5f, 2.0f) * glm::rotateX(glm::quarter_pi<float>()) * scale);
+    drawPlane(glm::translate(2.0f, .5f, -2.0f) * glm::rotateX(glm::quarter_pi<float>() * 3.f) * scale);
 
-    drawPlane(viewProjection * glm::translate(-2.0f, .5f, 2.0f) * glm::rotateX(glm::quarter_pi<float>()) * scale);
-    drawPlane(viewProjection * glm::translate(2.0f, .5f, -2.0f) * glm::rotateX(glm::quarter_pi<float>() * 3.f) * scale);
+    renderQueue.submit();
 
 
     // particles: This part draws the particles. Use view/projection to convert to world space
     activeParticleShader->use(); // Important: Use the particle shader program before proceeding to draw particles
 
+    // the uniforms shared by all the instances
+    particlesBlock.viewProjection = viewProjection;
+    particlesBlock.prevViewProjection = prevViewProjection;
+    particlesBlock.camPosition = camPosition;
+    particlesBlock.camForward = camForward;
+    particlesBlock.boxSize = boxSize;
+    particlesBuffer->update(particlesBlock);
+
     // Setup random generators for wind and gravity offsets
     std::random_device rd;  //Will be used to obtain a seed for the random number engine dd
     std::mt19937 gen(rd()); //Standard mersenne_twister_engine seeded with rd()
@@ -225,7 +256,7 @@ void drawObjects(){
     for(int i = 0; i<20; i++) { // Running 20 simulation instances
         int windOffset = distrib_wind(gen);
         int gravityOffset = distrib_gravity(gen);
-        drawParticles(viewProjection, windOffset, gravityOffset);
+        drawParticles(windOffset, gravityOffset);
     }
     //drawParticles(viewProjection,2);
 
@@ -236,17 +267,16 @@ void drawObjects(){
 
 void drawCube(glm::mat4 model){
     // draw object
-    shaderProgram->setMat4("model", model);
-    cube.drawSceneObject();
+    cube.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model));
 }
 
 
 void drawPlane(glm::mat4 model){
 
     // draw plane body and right wing
-    shaderProgram->setMat4("model", model);
-    planeBody.drawSceneObject();
-    planeWing.drawSceneObject();
+    uint32_t body = renderQueue.transform(model);
+    planeBody.queueSceneObject(renderQueue, shaderProgram->ID, body);
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, body);
 
     // propeller,
     glm::mat4 propeller = model * glm::translate(.0f, .5f, .0f) *
@@ -254,28 +284,24 @@ void drawPlane(glm::mat4 model){
                           glm::rotate(glm::half_pi<float>(), glm::vec3(1.0,0.0,0.0)) *
                           glm::scale(.5f, .5f, .5f);
 
-    shaderProgram->setMat4("model", propeller);
-    planePropeller.drawSceneObject();
+    planePropeller.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(propeller));
 
     // right wing back,
     glm::mat4 wingRightBack = model * glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingRightBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingRightBack));
 
     // left wing,
     glm::mat4 wingLeft = model * glm::scale(-1.0f, 1.0f, 1.0f);
-    shaderProgram->setMat4("model", wingLeft);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeft));
 
     // left wing back,
     glm::mat4 wingLeftBack =  model *  glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(-.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingLeftBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeftBack));
 }
 
 //particles:
 // Note: model and viewProjection are interchangeable here
-void drawParticles(glm::mat4 viewProjection, int windOffset, int gravityOffset) {
+void drawParticles(int windOffset, int gravityOffset) {
     glm::vec3 offsets;
     if(activeParticleShaderID==0){  // rain
         offsets = glm::vec3(-currentTime * windOffset, -currentTime * gravityOffset, -currentTime * windOffset);
@@ -288,14 +314,9 @@ void drawParticles(glm::mat4 viewProjection, int windOffset, int gravityOffset)
     // Create an instance velocity vector from the wind and gravity offsets.
     glm::vec3 instanceVelocity = glm::vec3(windOffset,gravityOffset,windOffset);
 
-    // Update all the general UNIFORMS in the particle shader program
-    activeParticleShader->setMat4("viewProjection", viewProjection);
-    activeParticleShader->setMat4("prevViewProjection", prevViewProjection);
-    activeParticleShader->setVec3("offsets", offsets);
-    activeParticleShader->setFloat("boxSize", boxSize);
-    activeParticleShader->setVec3("camPosition", camPosition);
-    activeParticleShader->setVec3("camForward", camForward);
-    activeParticleShader->setVec3("instanceVelocity",instanceVelocity);
+    // Update the UNIFORMS of the instance in the particle shader program (the general ones are in particlesBuffer)
+    activeParticleShader->setVec3(uniforms.offsets, offsets);
+    activeParticleShader->setVec3(uniforms.instanceVelocity, instanceVelocity);
 
     //bindParticleAttributes(); // BONUS: Uncomment this line to create prize winning abstract art
 
@@ -313,6 +334,9 @@ void setup(){
     shaderParticlePrograms.push_back(Shader("shaders/rainShader.vert", "shaders/rainShader.frag"));
     shaderParticlePrograms.push_back(Shader("shaders/snowShader.vert", "shaders/snowShader.frag"));
     activeParticleShader = &shaderParticlePrograms[0];
+    particlesBuffer = new UniformBuffer<ParticlesBlock>(0);
+    for (Shader &program : shaderParticlePrograms)
+        program.bindUniformBlock("Particles", particlesBuffer->getBinding());
 
     // load floor mesh into openGL
     floorObj.VAO = createVertexArray(floorVertices, floorColors, floorIndices);
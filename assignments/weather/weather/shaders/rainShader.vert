@@ -1,11 +1,14 @@
 #version 330 core
 layout (location = 0) in vec3 pos;   // the position variable has attribute position 0
-uniform mat4 viewProjection; // current viewProjection matrix
-uniform mat4 prevViewProjection; // previous viewProjection matrix
-uniform float boxSize;
+// the uniforms that are the same for every instance of a frame, uploaded once per frame (see uniform_buffer.h)
+layout (std140) uniform Particles {
+    mat4 viewProjection; // current viewProjection matrix
+    mat4 prevViewProjection; // previous viewProjection matrix
+    vec3 camPosition;
+    vec3 camForward;
+    float boxSize;
+};
 uniform vec3 offsets;
-uniform vec3 camPosition;
-uniform vec3 camForward;
 uniform vec3 instanceVelocity;
 out float lenColorScale;
 
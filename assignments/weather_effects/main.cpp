@@ -4,13 +4,15 @@
 #include <random>
 
 #include <vector>
-#include <chrono>
 
 #include "shader.h"
 #include "glmutils.h"
 #include "primitives.h"
 
 #include "Camera.h"
+#include "frame_pacer.h"
+#include "uniform_buffer.h"
+#include "render_queue.h"
 
 // Constants
 const int INSTANCES = 5;
@@ -20,9 +22,9 @@ const int INSTANCES = 5;
 struct SceneObject {
     unsigned int VAO;
     unsigned int vertexCount;
-    void drawSceneObject() const {
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,  vertexCount, GL_UNSIGNED_INT, 0);
+    // adds the draw of the object with program and a transform of the queue
+    void queueSceneObject(RenderQueue &queue, unsigned int program, uint32_t transform) const {
+        queue.add(program, VAO, 0, transform, vertexCount);
     }
 };
 
@@ -36,9 +38,10 @@ unsigned int createElementArrayBuffer(const std::vector<unsigned int> &array);
 unsigned int createVertexArray(const std::vector<float> &positions, const std::vector<float> &colors, const std::vector<unsigned int> &indices);
 void setup();
 void drawObjects(glm::mat4 viewProjection);
-void drawRain(glm::mat4 viewProj);
-void drawSnow(glm::mat4 viewProj);
+void drawRain();
+void drawSnow();
 void drawWeather(glm::mat4 viewProj);
+void simulateWeather(float step);
 glm::mat4 getViewProjection();
 
 // glfw and input functions
@@ -67,6 +70,30 @@ Shader* geometryShader;
 Shader* rainShader;
 Shader* snowShader;
 
+// the weather uniforms that are the same for every instance, uploaded once per frame to a uniform buffer that the rain
+// and the snow shaders read, the members follow the std140 layout of the Frame block in the shaders
+struct FrameBlock {
+    alignas(16) glm::mat4 viewProj;
+    alignas(16) glm::mat4 viewProjPrev;
+    alignas(16) glm::vec3 cameraPos;
+    alignas(16) glm::vec3 forwardOffset;
+    float boxSize;
+};
+FrameBlock frameBlock;
+UniformBuffer<FrameBlock>* frameBuffer;
+
+// the uniforms set for every draw, looked up by name once and not in every draw (see Shader::uniform)
+struct Uniforms {
+    Shader::Uniform offsets = Shader::uniform("offsets");
+    Shader::Uniform velocity = Shader::uniform("velocity");
+    Shader::Uniform heightScale = Shader::uniform("heightScale");
+    Shader::Uniform maxSize = Shader::uniform("maxSize");
+} uniforms;
+
+// the draws of the scene, sorted by program and vertex array before they are issued (see render_queue.h), the
+// shaders take the model view projection matrix in "model"
+RenderQueue renderQueue(true);
+
 // global variables used for control
 // ---------------------------------
 //! Random
@@ -75,6 +102,9 @@ std::default_random_engine eng(rd());
 
 //! Time
 float currentTime, deltaTime = 0.f, lastFrame = 0.f;
+// the weather is simulated in fixed steps, so it moves the same at any frame rate
+const float simulationStep = 1.0f / 60.0f;
+float simulationTime = 0.f;
 
 //! The Box
 float boxSize = 50.f;
@@ -165,12 +195,12 @@ struct WeatherSystem {
         }
     }
 
-    /* Simulate one cycle of weather to update gravity and wind offsets */
-    void simulate() {
+    /* Simulate one step of weather, step seconds long, to update gravity and wind offsets */
+    void simulate(float step, float time) {
         // self-explanatory
-        gravityOffset -= glm::vec3(0, gravDelta * deltaTime, 0);
+        gravityOffset -= glm::vec3(0, gravDelta * step, 0);
         // to add some variety the wind makes a circle :D
-        windOffset += glm::vec3(sin(currentTime + randomOffset.x)/10, 0, cos(currentTime + randomOffset.z)/10) * windDelta;
+        windOffset += glm::vec3(sin(time + randomOffset.x)/10, 0, cos(time + randomOffset.z)/10) * windDelta;
     }
 };
 
@@ -235,19 +265,21 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 1.0f / 60.0f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
         deltaTime = currentTime - lastFrame;
         lastFrame = currentTime;
 
         processInput(window);
 
+        // catch the weather up with the time that passed
+        for (unsigned int steps = pacer.fixedSteps(simulationStep); steps > 0; steps--)
+            simulateWeather(simulationStep);
+
         glClearColor(0.02f, 0.01f, 0.2f, 1.0f);
 
         // notice that we also need to clear the depth buffer (aka z-buffer) every new frame
@@ -262,15 +294,13 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete geometryShader;
     delete rainShader;
     delete snowShader;
+    delete frameBuffer;
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -283,6 +313,9 @@ void setup() {
     geometryShader = new Shader("shaders/geometry.vert", "shaders/geometry.frag");
     rainShader = new Shader("shaders/rain.vert", "shaders/rain.frag");
     snowShader = new Shader("shaders/snow.vert", "shaders/snow.frag");
+    frameBuffer = new UniformBuffer<FrameBlock>(0);
+    rainShader->bindUniformBlock("Frame", frameBuffer->getBinding());
+    snowShader->bindUniformBlock("Frame", frameBuffer->getBinding());
 
     // load floor mesh into openGL
     floorObj.VAO = createVertexArray(floorVertices, floorColors, floorIndices);
@@ -294,7 +327,6 @@ void setup() {
 
     // set up rain weather instances
     rainShader->use();
-    rainShader->setFloat("boxSize", boxSize);
     for(unsigned int i = 0; i < INSTANCES; i++) {
         auto instance = new WeatherSystem(rainShader, (unsigned int) 1000/INSTANCES, 2);
         instance->gravDelta *= 10;
@@ -304,7 +336,6 @@ void setup() {
 
     // set up snow weather instances
     snowShader->use();
-    snowShader->setFloat("boxSize", boxSize);
     for(unsigned int i = 0; i < INSTANCES; i++) {
         auto instance = new WeatherSystem(snowShader, (unsigned int) 5000/INSTANCES, 1);
         instance->initParticles();
@@ -331,57 +362,65 @@ void drawObjects(glm::mat4 viewProjection){
     // perspective_projection_from_view <- view_from_world
 
 
+    // the objects are added to the queue with their model matrix, and drawn by submit()
+    renderQueue.begin(viewProjection);
+
     // draw floor (the floor was built so that it does not need to be transformed)
-    geometryShader->setMat4("model", viewProjection);
-    floorObj.drawSceneObject();
+    floorObj.queueSceneObject(renderQueue, geometryShader->ID, renderQueue.transform(glm::mat4(1.0f)));
 
     // draw 2 cubes and 2 planes in different locations and with different orientations
-    drawCube(viewProjection * glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
-    drawCube(viewProjection * glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+    drawCube(glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
+    drawCube(glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+
+    renderQueue.submit();
 }
 
 void drawWeather(glm::mat4 viewProj) {
+    // the uniforms shared by all the instances
+    frameBlock.viewProj = viewProj;
+    frameBlock.viewProjPrev = prevViewProj;
+    frameBlock.cameraPos = camera->position;
+    frameBlock.forwardOffset = camera->forward * boxSize / 2.f;
+    frameBlock.boxSize = boxSize;
+    frameBuffer->update(frameBlock);
     if(toggleRain)
-        drawRain(viewProj);
+        drawRain();
     else
-        drawSnow(viewProj);
+        drawSnow();
     prevViewProj = viewProj;
 }
 
-void drawRain(glm::mat4 viewProj) {
+void simulateWeather(float step) {
+    simulationTime += step;
+    for(const auto& instance : toggleRain ? rainWeatherInstances : snowWeatherInstances)
+        instance->simulate(step, simulationTime); // update gravity & wind offsets
+}
+
+void drawRain() {
     for(const auto& instance : rainWeatherInstances) {
         instance->shader->use(); // start using the correct shader
-        instance->simulate(); // update gravity & wind offsets
         auto fwdOffset = camera->forward * boxSize / 2.f; // update forward offset
         auto offsets = instance->gravityOffset + instance->windOffset + instance->randomOffset; // sum them all up
         offsets -= camera->position + fwdOffset + boxSize / 2.f; // factor in camera position and fwd offset
         offsets = glm::mod(offsets, boxSize); // constrain them inside the boxSize
-        // set up uniforms
-        instance->shader->setMat4("viewProj", viewProj);
-        instance->shader->setMat4("viewProjPrev", prevViewProj);
-        instance->shader->setVec3("cameraPos", camera->position);
-        instance->shader->setVec3("forwardOffset", fwdOffset);
-        instance->shader->setVec3("offsets", offsets);
-        instance->shader->setVec3("velocity", glm::vec3(0.0f, 1.0f, 0.0f) * instance->gravDelta + glm::normalize(instance->windOffset));
-        instance->shader->setFloat("heightScale", 0.01f * instance->particleSize/10);
+        // set up the uniforms of the instance (the ones shared by all the instances are in frameBuffer)
+        instance->shader->setVec3(uniforms.offsets, offsets);
+        instance->shader->setVec3(uniforms.velocity, glm::vec3(0.0f, 1.0f, 0.0f) * instance->gravDelta + glm::normalize(instance->windOffset));
+        instance->shader->setFloat(uniforms.heightScale, 0.01f * instance->particleSize/10);
         instance->drawParticles();
     }
 }
 
-void drawSnow(glm::mat4 viewProj) {
+void drawSnow() {
     for(const auto& instance : snowWeatherInstances) {
         instance->shader->use(); // start using the correct shader
-        instance->simulate(); // update gravity & wind offsets
         auto fwdOffset = camera->forward * boxSize / 2.f; // update forward offset
         auto offsets = instance->gravityOffset + instance->windOffset + instance->randomOffset; // sum them all up
         offsets -= camera->position + fwdOffset + boxSize / 2.f; // factor in camera position and fwd offset
         offsets = glm::mod(offsets, boxSize); // constrain them inside the boxSize
-        // set up uniforms
-        instance->shader->setMat4("viewProj", viewProj);
-        instance->shader->setVec3("cameraPos", camera->position);
-        instance->shader->setVec3("forwardOffset", fwdOffset);
-        instance->shader->setVec3("offsets", offsets);
-        instance->shader->setFloat("maxSize", instance->particleSize);
+        // set up the uniforms of the instance (the ones shared by all the instances are in frameBuffer)
+        instance->shader->setVec3(uniforms.offsets, offsets);
+        instance->shader->setFloat(uniforms.maxSize, instance->particleSize);
         instance->drawParticles();
     }
 }
@@ -389,8 +428,7 @@ void drawSnow(glm::mat4 viewProj) {
 
 void drawCube(glm::mat4 model){
     // draw object
-    geometryShader->setMat4("model", model);
-    cube.drawSceneObject();
+    cube.queueSceneObject(renderQueue, geometryShader->ID, renderQueue.transform(model));
 }
 
 unsigned int createVertexArray(const std::vector<float> &positions, const std::vector<float> &colors, const std::vector<unsigned int> &indices){
@@ -4,10 +4,15 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "program_cache.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 /// Shader class from https://learnopengl.com
 /// https://learnopengl.com/code_viewer_gh.php?code=includes/learnopengl/shader.h
@@ -62,44 +67,19 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        // 2. load the program linked by an earlier run (see program_cache.h) if the sources and the driver are the
+        // same, else compile and link it, and cache it for the next runs
+        ID = glCreateProgram();
+        const std::string cachePath = programcache::cachePath(vertexPath, fragmentPath, geometryPath);
+        const uint64_t cacheKey = programcache::programKey({vertexCode, fragmentCode, geometryCode});
+        if (!programcache::load(ID, cachePath, cacheKey))
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            compileAndLink(vertexCode, fragmentCode, geometryPath != nullptr ? &geometryCode : nullptr);
+            programcache::store(ID, cachePath, cacheKey);
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
 
+        // the locations of the uniforms are looked up once, here, and not every time a uniform is set
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -107,66 +87,200 @@ public:
     {
         glUseProgram(ID);
     }
-    // utility uniform functions
+    // a uniform name resolved once, that the setters take instead of the name, e.g.
+    //   const Shader::Uniform modelUniform = Shader::uniform("model");
+    //   shader->setMat4(modelUniform, model);
+    // the location of the uniform in each program is then found with an array lookup, without comparing strings.
+    // The same handle works with every program (the uniform is set if the program uses it)
+    struct Uniform {
+        unsigned int id;
+    };
+    static Uniform uniform(const std::string &name)
+    {
+        std::vector<std::string> &names = uniformNames();
+        auto found = std::find(names.begin(), names.end(), name);
+        if (found == names.end())
+            found = names.insert(names.end(), name);
+        return Uniform{(unsigned int)(found - names.begin())};
+    }
+    // location of a uniform of the program, -1 (which glUniform ignores) if the program does not use it
+    GLint getLocation(const std::string &name) const
+    {
+        auto byName = [](const std::pair<std::string, GLint> &u, const std::string &n){ return u.first < n; };
+        auto found = std::lower_bound(uniforms.begin(), uniforms.end(), name, byName);
+        if (found != uniforms.end() && found->first == name)
+            return found->second;
+        // the elements of arrays after the first are not listed by the reflection
+        return name.find('[') != std::string::npos ? glGetUniformLocation(ID, name.c_str()) : -1;
+    }
+    GLint getLocation(Uniform uniform) const
+    {
+        if (uniform.id >= locations.size())
+            locations.resize(uniform.id + 1, unresolved);
+        if (locations[uniform.id] == unresolved)
+            locations[uniform.id] = getLocation(uniformNames()[uniform.id]);
+        return locations[uniform.id];
+    }
+    // connects the std140 uniform block blockName of the program to the uniform buffer at binding (see UniformBuffer
+    // in uniform_buffer.h), returns false if the program does not use the block
+    bool bindUniformBlock(const std::string &blockName, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(ID, index, binding);
+        return true;
+    }
+    // utility uniform functions, name is a std::string or a Uniform
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    template <class Name>
+    void setBool(const Name &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    template <class Name>
+    void setInt(const Name &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    template <class Name>
+    void setFloat(const Name &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    template <class Name>
+    void setVec2(const Name &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getLocation(name), 1, &value[0]);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    template <class Name>
+    void setVec2(const Name &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    template <class Name>
+    void setVec3(const Name &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getLocation(name), 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    template <class Name>
+    void setVec3(const Name &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    template <class Name>
+    void setVec4(const Name &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getLocation(name), 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w)
+    template <class Name>
+    void setVec4(const Name &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    template <class Name>
+    void setMat2(const Name &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    template <class Name>
+    void setMat3(const Name &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    template <class Name>
+    void setMat4(const Name &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // the active uniforms of the program (outside of uniform blocks), sorted by name, with their location
+    std::vector<std::pair<std::string, GLint>> uniforms;
+    // the location of each Uniform handle in this program, filled as they are used
+    enum { unresolved = -2 };
+    mutable std::vector<GLint> locations;
+
+    static std::vector<std::string> &uniformNames()
+    {
+        static std::vector<std::string> names;
+        return names;
+    }
+
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+            std::string uniformName(name.data(), length);
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location < 0)
+                continue; // a member of a uniform block
+            uniforms.emplace_back(uniformName, location);
+            // an array is listed as "name[0]", and can be set as "name"
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniforms.emplace_back(uniformName.substr(0, uniformName.size() - 3), location);
+        }
+        std::sort(uniforms.begin(), uniforms.end());
+    }
+
+    // compiles the shaders and links them in the program ID, geometryCode is null if there is no geometry shader
+    // ------------------------------------------------------------------------
+    void compileAndLink(const std::string &vertexCode, const std::string &fragmentCode, const std::string *geometryCode)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(geometryCode != nullptr)
+        {
+            const char * gShaderCode = geometryCode->c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+        // shader Program
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        if(geometryCode != nullptr)
+            glAttachShader(ID, geometry);
+        programcache::prepare(ID);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(geometryCode != nullptr)
+            glDeleteShader(geometry);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -1,13 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 pos;
 
-uniform float boxSize;
+// the uniforms that are the same for every instance of a frame, uploaded once per frame (see uniform_buffer.h)
+layout (std140) uniform Frame {
+    mat4 viewProj;
+    mat4 viewProjPrev;
+    vec3 cameraPos;
+    vec3 forwardOffset;
+    float boxSize;
+};
 
-uniform mat4 viewProj;
-uniform mat4 viewProjPrev;
-
-uniform vec3 cameraPos;
-uniform vec3 forwardOffset;
 uniform vec3 offsets;
 
 uniform float maxSize;
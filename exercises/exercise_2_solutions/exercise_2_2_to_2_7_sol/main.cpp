@@ -5,7 +5,7 @@
 
 #include <iostream>
 #include <vector>
-#include <chrono>
+#include "frame_pacer.h"
 
 void bindAttributes();
 void createVertexBufferObject();
@@ -82,16 +82,14 @@ int main()
 
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         // glfw input
         processInput(window);
@@ -116,11 +114,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            // busy waiting
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
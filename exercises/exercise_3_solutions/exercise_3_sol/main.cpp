@@ -2,7 +2,6 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <vector>
-#include <chrono>
 #include <shader_s.h>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -12,6 +11,7 @@
 
 // the plane model is stored in the file so that we do not need to deal with model loading yet
 #include "plane_model.h"
+#include "frame_pacer.h"
 
 // structure to hold the info necessary to render an object
 struct SceneObject{
@@ -110,14 +110,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         processInput(window);
 
@@ -138,10 +136,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) { // busy wait
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
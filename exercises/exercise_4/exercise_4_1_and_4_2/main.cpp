@@ -3,7 +3,6 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 #include <shader.h>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -14,6 +13,7 @@
 
 #include "plane_model.h"
 #include "primitives.h"
+#include "frame_pacer.h"
 
 
 // structure to hold render info
@@ -129,14 +129,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         glClearColor(0.5f, 0.5f, 1.0f, 1.0f);
 
@@ -153,10 +151,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
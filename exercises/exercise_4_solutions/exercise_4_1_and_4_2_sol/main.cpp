@@ -3,7 +3,6 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 #include <shader.h>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -13,6 +12,8 @@
 
 #include "plane_model.h"
 #include "primitives.h"
+#include "frame_pacer.h"
+#include "render_queue.h"
 
 
 // structure to hold render info
@@ -21,9 +22,9 @@ struct SceneObject{
     unsigned int VAO;
     unsigned int vertexCount;
 
-    void drawSceneObject(){
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, 0);
+    // adds the draw of the object with program and a transform of the queue
+    void queueSceneObject(RenderQueue &queue, unsigned int program, uint32_t transform) const{
+        queue.add(program, VAO, 0, transform, vertexCount);
     }
 };
 
@@ -58,6 +59,9 @@ SceneObject planeBody;
 SceneObject planeWing;
 SceneObject planePropeller;
 Shader* shaderProgram;
+// the draws of the frame, sorted by program and vertex array before they are issued (see render_queue.h), there is
+// no camera yet, the shaders take the model matrix in "model"
+RenderQueue renderQueue;
 
 // global variables used for control
 // -----------------------------------
@@ -126,14 +130,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         glClearColor(0.5f, 0.5f, 1.0f, 1.0f);
 
@@ -143,17 +145,17 @@ int main()
         shaderProgram->use();
         // NEW!
         // we now have a function to draw the arrow too
+        // they add their parts to the queue with their model matrix, and submit() draws them
+        renderQueue.begin(glm::mat4(1.0f));
         drawArrow();
         drawPlane();
+        renderQueue.submit();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
@@ -194,10 +196,8 @@ void drawArrow(){
 
     // set scale matrix
     glm::mat4 scale = glm::scale(.1f, glm::length(clickDiff), 1.0f);
-    // set shader "model" matrix
-    shaderProgram->setMat4("model", position * rotation * scale);
-
-    arrow.drawSceneObject();
+    // the "model" matrix of the arrow
+    arrow.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(position * rotation * scale));
 
 }
 
@@ -268,9 +268,9 @@ void drawPlane(){
     glm::mat4 model = translation * rotation * scale;
 
     // draw plane body and right wing
-    shaderProgram->setMat4("model", model);
-    planeBody.drawSceneObject();
-    planeWing.drawSceneObject();
+    uint32_t body = renderQueue.transform(model);
+    planeBody.queueSceneObject(renderQueue, shaderProgram->ID, body);
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, body);
 
     // propeller,
     // half size -> make perpendicular to plane forward axis -> rotate around plane forward axis -> move to the tip of the plane
@@ -279,26 +279,22 @@ void drawPlane(){
                           glm::rotate(glm::half_pi<float>(), glm::vec3(1.0,0.0,0.0)) *
                           glm::scale(.5f, .5f, .5f);
 
-    shaderProgram->setMat4("model", propeller);
-    planePropeller.drawSceneObject();
+    planePropeller.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(propeller));
 
     // right wing back,
     // half size -> move to the back
     glm::mat4 wingRightBack = model * glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingRightBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingRightBack));
 
     // left wing,
     // mirror in x
     glm::mat4 wingLeft = model * glm::scale(-1.0f, 1.0f, 1.0f);
-    shaderProgram->setMat4("model", wingLeft);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeft));
 
     // left wing back,
     // half size + mirror in x -> move to the back
     glm::mat4 wingLeftBack =  model *  glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(-.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingLeftBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeftBack));
 
 }
 
@@ -3,13 +3,13 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 
 #include "shader.h"
 #include "glmutils.h"
 #include "glm/ext.hpp"
 #include "plane_model.h"
 #include "primitives.h"
+#include "frame_pacer.h"
 
 // structure to hold render info
 // -----------------------------
@@ -116,14 +116,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
         deltaTime = currentTime - lastFrame;
         lastFrame = currentTime;
 
@@ -141,10 +139,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
@@ -3,7 +3,6 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 #include <shader.h>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -13,15 +12,17 @@
 
 #include "primitives.h"
 #include "plane_model.h"
+#include "frame_pacer.h"
+#include "render_queue.h"
 
 // structure to hold render info
 // -----------------------------
 struct SceneObject{
     unsigned int VAO;
     unsigned int vertexCount;
-    void drawSceneObject(){
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,  vertexCount, GL_UNSIGNED_INT, 0);
+    // adds the draw of the object with program and a transform of the queue
+    void queueSceneObject(RenderQueue &queue, unsigned int program, uint32_t transform) const{
+        queue.add(program, VAO, 0, transform, vertexCount);
     }
 };
 
@@ -51,6 +52,9 @@ const unsigned int SCR_HEIGHT = 600;
 SceneObject cube;
 SceneObject planeBody, planeWing, planePropeller;
 Shader* shaderProgram;
+// the draws of the frame, sorted by program and vertex array before they are issued (see render_queue.h), the
+// shaders take the model view projection matrix in "model"
+RenderQueue renderQueue(true);
 
 // global variables used for control
 // ---------------------------------
@@ -117,14 +121,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         glClearColor(0.6f, 0.6f, 0.6f, 1.0f);
 
@@ -138,10 +140,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
@@ -243,24 +242,24 @@ void drawObject(){
     glm::mat4 model = trackballRotation() * storedRotation;
 
 
-    glm::mat4 viewProj = viewProjection();
-    glm::mat4 MVP = viewProj * model;
+    // the parts are added to the queue with their model matrix, and drawn by submit()
+    renderQueue.begin(viewProjection());
 
     if(!g_airplane) {
         // draw cube and return
         // scale the cube to half the size (not needed for the plane)
         glm::mat4 scale = glm::scale(.5f, .5f, .5f);
         // draw cube
-        shaderProgram->setMat4("model", MVP * scale);
-        cube.drawSceneObject();
+        cube.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model * scale));
+        renderQueue.submit();
         return;
     }
 
     // draw plane
     // plane body and right wing
-    shaderProgram->setMat4("model", MVP);
-    planeBody.drawSceneObject();
-    planeWing.drawSceneObject();
+    uint32_t body = renderQueue.transform(model);
+    planeBody.queueSceneObject(renderQueue, shaderProgram->ID, body);
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, body);
 
     // propeller,
     glm::mat4 propeller = glm::translate(.0f, .5f, .0f) *
@@ -268,24 +267,21 @@ void drawObject(){
                           glm::rotate(glm::half_pi<float>(), glm::vec3(1.0,0.0,0.0)) *
                           glm::scale(.5f, .5f, .5f);
 
-    shaderProgram->setMat4("model", MVP * propeller);
-    planePropeller.drawSceneObject();
+    planePropeller.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model * propeller));
 
     // right wing back,
     glm::mat4 wingRightBack = glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f,.5f,.5f);
-    shaderProgram->setMat4("model", MVP * wingRightBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model * wingRightBack));
 
     // left wing,
     glm::mat4 wingLeft = glm::scale(-1.0f, 1.0f, 1.0f);
-    shaderProgram->setMat4("model", MVP * wingLeft);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model * wingLeft));
 
     // left wing back,
     glm::mat4 wingLeftBack =  glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(-.5f,.5f,.5f);
-    shaderProgram->setMat4("model", MVP * wingLeftBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model * wingLeftBack));
 
+    renderQueue.submit();
 }
 
 
@@ -3,22 +3,23 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 
 #include "shader.h"
 #include "glmutils.h"
 
 #include "plane_model.h"
 #include "primitives.h"
+#include "frame_pacer.h"
+#include "render_queue.h"
 
 // structure to hold render info
 // -----------------------------
 struct SceneObject{
     unsigned int VAO;
     unsigned int vertexCount;
-    void drawSceneObject() const{
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,  vertexCount, GL_UNSIGNED_INT, 0);
+    // adds the draw of the object with program and a transform of the queue
+    void queueSceneObject(RenderQueue &queue, unsigned int program, uint32_t transform) const{
+        queue.add(program, VAO, 0, transform, vertexCount);
     }
 };
 
@@ -52,6 +53,9 @@ SceneObject planeBody;
 SceneObject planeWing;
 SceneObject planePropeller;
 Shader* shaderProgram;
+// the draws of the frame, sorted by program and vertex array before they are issued (see render_queue.h), the
+// shaders take the model view projection matrix in "model"
+RenderQueue renderQueue(true);
 
 // global variables used for control
 // ---------------------------------
@@ -114,14 +118,12 @@ int main()
     // -----------
     // render every loopInterval seconds
     float loopInterval = 0.02f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-        currentTime = appTime.count();
+        currentTime = pacer.beginFrame();
 
         processInput(window);
 
@@ -137,10 +139,7 @@ int main()
         glfwPollEvents();
 
         // control render loop frequency
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        pacer.endFrame();
     }
 
     delete shaderProgram;
@@ -165,32 +164,35 @@ void drawObjects(){
     glm::mat4 view = glm::lookAt(camPosition, camPosition + camForward, glm::vec3(0,1,0));
     glm::mat4 viewProjection = projection * view;
 
+    // the objects are added to the queue with their model matrix, and drawn by submit()
+    renderQueue.begin(viewProjection);
+
     // draw floor (the floor was built so that it does not need to be transformed)
-    shaderProgram->setMat4("model", viewProjection);
-    floorObj.drawSceneObject();
+    floorObj.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(glm::mat4(1.0f)));
 
     // draw 2 cubes and 2 planes in different locations and with different orientations
-    drawCube(viewProjection * glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
-    drawCube(viewProjection * glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+    drawCube(glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
+    drawCube(glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+
+    drawPlane(glm::translate(-2.0f, .5f, 2.0f) * glm::rotateX(glm::quarter_pi<float>()) * scale);
+    drawPlane(glm::translate(2.0f, .5f, -2.0f) * glm::rotateX(glm::quarter_pi<float>() * 3.f) * scale);
 
-    drawPlane(viewProjection * glm::translate(-2.0f, .5f, 2.0f) * glm::rotateX(glm::quarter_pi<float>()) * scale);
-    drawPlane(viewProjection * glm::translate(2.0f, .5f, -2.0f) * glm::rotateX(glm::quarter_pi<float>() * 3.f) * scale);
+    renderQueue.submit();
 }
 
 
 void drawCube(glm::mat4 model){
     // draw object
-    shaderProgram->setMat4("model", model);
-    cube.drawSceneObject();
+    cube.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(model));
 }
 
 
 void drawPlane(glm::mat4 model){
 
     // draw plane body and right wing
-    shaderProgram->setMat4("model", model);
-    planeBody.drawSceneObject();
-    planeWing.drawSceneObject();
+    uint32_t body = renderQueue.transform(model);
+    planeBody.queueSceneObject(renderQueue, shaderProgram->ID, body);
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, body);
 
     // propeller,
     glm::mat4 propeller = model * glm::translate(.0f, .5f, .0f) *
@@ -198,23 +200,19 @@ void drawPlane(glm::mat4 model){
                           glm::rotate(glm::half_pi<float>(), glm::vec3(1.0,0.0,0.0)) *
                           glm::scale(.5f, .5f, .5f);
 
-    shaderProgram->setMat4("model", propeller);
-    planePropeller.drawSceneObject();
+    planePropeller.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(propeller));
 
     // right wing back,
     glm::mat4 wingRightBack = model * glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingRightBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingRightBack));
 
     // left wing,
     glm::mat4 wingLeft = model * glm::scale(-1.0f, 1.0f, 1.0f);
-    shaderProgram->setMat4("model", wingLeft);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeft));
 
     // left wing back,
     glm::mat4 wingLeftBack =  model *  glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(-.5f,.5f,.5f);
-    shaderProgram->setMat4("model", wingLeftBack);
-    planeWing.drawSceneObject();
+    planeWing.queueSceneObject(renderQueue, shaderProgram->ID, renderQueue.transform(wingLeftBack));
 }
 
 
@@ -2,48 +2,43 @@
 // Created by henrique debarba on 07/10/2021.
 //
 
-#include <assert.h>
+#include <cassert>
+#include <algorithm>
 #include "CustomFrameBuffer.h"
 
 CustomFrameBuffer::CustomFrameBuffer(uint32_t width, uint32_t height) : W(width), H(height){
-    if (buffer != nullptr) // ensure that there is no buffer allocated ...
-        delete buffer;
-    int size = W * H * 3 * 3; // (the hardcoded 3s are the width and height of each "pixel")
-    buffer = new Colors::color[size]; // ... and allocate one
+    // one color per pixel, the 3x3 cells are only made when the buffer is displayed
+    buffer = new Colors::color[W * H]; // allocate buffers
+    decoration = new Colors::color[W * H];
     clearBuffer();
 }
 
 CustomFrameBuffer::~CustomFrameBuffer(){
     delete[] buffer; // clean our memory
+    delete[] decoration;
 }
 
-void CustomFrameBuffer::clearBuffer(Colors::color col){
-    int size = W * H * 3 * 3;
-    for(int i = 0; i < size; i++)
-        buffer[i] = col;
+void CustomFrameBuffer::clearBuffer(Colors::color col) const{
+    std::fill(buffer, buffer + W * H, col);
+    // no ring is painted (alpha 0)
+    std::fill(decoration, decoration + W * H, 0);
 }
 
-void CustomFrameBuffer::paintAt(uint32_t x, uint32_t y, Colors::color col, CustomFrameBuffer::fill fillOption){
+void CustomFrameBuffer::paintAt(uint32_t x, uint32_t y, Colors::color col, CustomFrameBuffer::fill fillOption) const{
     assert (x < W && y < H); // ensure valid position, crash if not (sooo dramatic!)
 
-    // location of the center pixel in the buffer
-    int px = (x * 3 + 1) + (y * 3 + 1) * W * 3;
-
-    if (fillOption != CustomFrameBuffer::fill::center) {
-        // fill out the 3x3 range
-        for (int i = -1; i <= 1; i++) {
-            for (int j = -1; j <= 1; j++) {
-                if (fillOption == CustomFrameBuffer::fill::cross && abs(i) + abs(j) > 1)
-                    continue; // skip corners
-                if (fillOption == CustomFrameBuffer::fill::checkboard && abs(i) + abs(j) != 1)
-                    continue;
-                if (fillOption == CustomFrameBuffer::fill::frame && abs(i) + abs(j) == 0)
-                    continue;
-                int currentPx = px + j * 3 * W + i;
-                buffer[currentPx] = col;
-            }
-        }
-    } else { // fill out only the center
+    unsigned int px = x + y * W;
+
+    // solid, cross and center paint the center of the 3x3 cell
+    if (fillOption != CustomFrameBuffer::fill::checkboard && fillOption != CustomFrameBuffer::fill::frame)
         buffer[px] = col;
-    }
-}
\ No newline at end of file
+
+    // the ring has a single color, so a new decoration replaces the previous one
+    uint32_t parts = 0;
+    if (fillOption == CustomFrameBuffer::fill::solid || fillOption == CustomFrameBuffer::fill::frame)
+        parts = ring::edges | ring::corners;
+    else if (fillOption == CustomFrameBuffer::fill::cross || fillOption == CustomFrameBuffer::fill::checkboard)
+        parts = ring::edges;
+    if (parts)
+        decoration[px] = (col & 0x00FFFFFF) | (parts << 24);
+}
@@ -23,21 +23,27 @@ namespace Colors{
 }
 
 
+// the buffer has one color per (logical) pixel, on screen each pixel is shown as a 3x3 cell (see CustomFrameBufferDisplay)
+// the 8 cells around the center are the ring of the pixel, the ring is not stored in the color buffer but in the
+// decoration buffer, which has the color of the ring and which parts of the ring are painted
 class CustomFrameBuffer {
 public:
     // solid paints in a 3x3 range, center paints only the pixel in the center, cross don't paint the corners
     enum fill {solid, cross, center, checkboard, frame};
+    // parts of the ring painted by a decoration, stored in the alpha of the decoration color
+    enum ring : uint32_t {edges = 1, corners = 2};
     uint32_t W = 16;
     uint32_t H = 16;
-    Colors::color *buffer;
+    Colors::color *buffer = nullptr;
+    Colors::color *decoration = nullptr;
 
     CustomFrameBuffer(uint32_t width, uint32_t height);
     ~CustomFrameBuffer();
 
-    void clearBuffer(Colors::color col = Colors::black);
-    void paintAt(uint32_t x, uint32_t y, Colors::color col, fill fillOption = fill::center);
+    void clearBuffer(Colors::color col = Colors::black) const;
+    void paintAt(uint32_t x, uint32_t y, Colors::color col, fill fillOption = fill::center) const;
 
 };
 
 
-#endif //ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFER_H
\ No newline at end of file
+#endif //ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFER_H
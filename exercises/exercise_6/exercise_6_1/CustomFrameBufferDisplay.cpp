@@ -0,0 +1,109 @@
+#include <iostream>
+#include <cassert>
+#include "CustomFrameBufferDisplay.h"
+
+// shader programs
+// ---------------
+// a triangle that covers the whole viewport, made from the vertex index
+const char *displayVertexShaderSource = "#version 330 core\n"
+                                        "void main()\n"
+                                        "{\n"
+                                        "   vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+                                        "   gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);\n"
+                                        "}\0";
+// each pixel of the buffer covers a 3x3 cell of the viewport, the cell is split in the center, the 4 edges
+// (left, right, bottom and top) and the 4 corners. The decoration alpha has the parts of the ring it paints
+const char *displayFragmentShaderSource = "#version 330 core\n"
+                                          "out vec4 FragColor;\n"
+                                          "uniform sampler2D colorTexture;\n"
+                                          "uniform sampler2D decorationTexture;\n"
+                                          "uniform vec4 viewport;\n"
+                                          "uniform ivec2 gridSize;\n"
+                                          "uniform vec4 gridColor;\n"
+                                          "void main()\n"
+                                          "{\n"
+                                          "   vec2 cell = (gl_FragCoord.xy - viewport.xy) / viewport.zw * vec2(gridSize);\n"
+                                          "   ivec2 pixel = clamp(ivec2(cell), ivec2(0), gridSize - 1);\n"
+                                          "   ivec2 sub = clamp(ivec2(fract(cell) * 3.0), ivec2(0), ivec2(2));\n"
+                                          "   if (sub == ivec2(1)) {\n"
+                                          "      FragColor = vec4(texelFetch(colorTexture, pixel, 0).rgb, 1.0);\n"
+                                          "      return;\n"
+                                          "   }\n"
+                                          "   vec4 decoration = texelFetch(decorationTexture, pixel, 0);\n"
+                                          "   int parts = int(decoration.a * 255.0 + 0.5);\n"
+                                          "   int part = (sub.x == 1 || sub.y == 1) ? 1 : 2; // edges : corners\n"
+                                          "   FragColor = (parts & part) != 0 ? vec4(decoration.rgb, 1.0) : gridColor;\n"
+                                          "}\n\0";
+
+GLuint compileShader(GLenum type, const char *source){
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT")
+                  << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    return shader;
+}
+
+CustomFrameBufferDisplay::CustomFrameBufferDisplay(uint32_t width, uint32_t height) :
+        W(width), H(height), colorTexture(width, height), decorationTexture(width, height){
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, displayVertexShaderSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, displayFragmentShaderSource);
+
+    // link shaders
+    shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+    // check for linking errors
+    int success;
+    char infoLog[512];
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    glUseProgram(shaderProgram);
+    glUniform1i(glGetUniformLocation(shaderProgram, "colorTexture"), 0);
+    glUniform1i(glGetUniformLocation(shaderProgram, "decorationTexture"), 1);
+    viewportLoc = glGetUniformLocation(shaderProgram, "viewport");
+    gridSizeLoc = glGetUniformLocation(shaderProgram, "gridSize");
+    gridColorLoc = glGetUniformLocation(shaderProgram, "gridColor");
+
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+void CustomFrameBufferDisplay::draw(const CustomFrameBuffer &fb, Colors::color gridColor){
+    assert (fb.W == W && fb.H == H);
+
+    // upload the pixels and the decorations, rows are tightly packed 32 bits colors
+    colorTexture.upload(fb.buffer);
+    decorationTexture.upload(fb.decoration);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture.textureId());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, decorationTexture.textureId());
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glUseProgram(shaderProgram);
+    glUniform4f(viewportLoc, (float) viewport[0], (float) viewport[1], (float) viewport[2], (float) viewport[3]);
+    glUniform2i(gridSizeLoc, (GLint) W, (GLint) H);
+    glUniform4f(gridColorLoc, (gridColor & 0xFF) / 255.f, ((gridColor >> 8) & 0xFF) / 255.f,
+                ((gridColor >> 16) & 0xFF) / 255.f, 1.f);
+
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
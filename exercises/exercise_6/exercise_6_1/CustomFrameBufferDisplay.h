@@ -0,0 +1,30 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFERDISPLAY_H
+#define ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFERDISPLAY_H
+
+#include <glad/glad.h>
+#include "CustomFrameBuffer.h"
+#include "streaming_texture.h"
+
+// shows a CustomFrameBuffer in the current viewport, each pixel is drawn as a 3x3 cell by a fragment shader:
+// the center has the color of the pixel, and the ring around it has the decoration of the pixel or the grid color.
+// Only the W x H pixels (and decorations) are uploaded, the 3x3 cells never exist in memory
+class CustomFrameBufferDisplay {
+public:
+    // needs a current OpenGL context, the textures are allocated once with the size of the buffer, and every frame
+    // is streamed through their pixel buffers (see StreamingTexture)
+    // like the window, the OpenGL objects live until the program ends (they are released by glfwTerminate)
+    CustomFrameBufferDisplay(uint32_t width, uint32_t height);
+
+    // upload the buffer to the GPU and draw it
+    void draw(const CustomFrameBuffer &fb, Colors::color gridColor = Colors::dark);
+
+private:
+    uint32_t W, H;
+    StreamingTexture colorTexture, decorationTexture;
+    GLuint shaderProgram = 0;
+    GLuint emptyVAO = 0; // the full screen triangle is made in the vertex shader, but a VAO must be bound to draw
+    GLint viewportLoc = -1, gridSizeLoc = -1, gridColorLoc = -1;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFERDISPLAY_H
@@ -3,11 +3,12 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 
 #include "trianglerasterizer.h"
 #include "linerasterizer.h"
 #include "CustomFrameBuffer.h"
+#include "CustomFrameBufferDisplay.h"
+#include "frame_pacer.h"
 
 void key_input_callback(GLFWwindow* window, int button, int other, int action, int mods);
 void print_instructions();
@@ -65,76 +66,50 @@ int main()
 
     // initialize our custom frame buffer
     // ----------------------------------
-    // every frame we will: draw to it, upload it to a texture, and copy the texture to the window frame buffer.
+    // every frame we will: draw to it, upload it to the GPU, and draw it to the window frame buffer.
     CustomFrameBuffer customBuffer(max_W, max_H);
 
-
-    // initialize texture we will use to upload our buffer to GPU
-    // ----------------------------------------------------------
-    unsigned int bufferTexture;
-
-    glGenTextures(1, &bufferTexture);
-    glBindTexture(GL_TEXTURE_2D, bufferTexture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // initialize openGL frame buffer object
-    // ------------------------------------
-    // this helps handling writing the texture content into the window frame buffer
-    GLuint oglFrameBuffer = 0;
-    glGenFramebuffers(1, &oglFrameBuffer);
+    // the display uploads the buffer to textures and draws each pixel as a 3x3 cell, with the grid around it
+    // ----------------------------------------------------------------------------------------------------
+    CustomFrameBufferDisplay display(max_W, max_H);
 
     // render loop
     // -----------
     // render every loopInterval seconds
     float loopInterval = 1.f/60.f;
-    auto begin = std::chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
+        pacer.beginFrame();
 
 
         // render to our custom frame buffer
         // ---------------------------------
+        // the grid around the pixels is drawn by the display, it is not painted in the buffer
         customBuffer.clearBuffer(Colors::black);
 
-        // paint the dots in the middle of the pixels
-        for(int i = 0; i < customBuffer.W; i++){
-            for(int j = 0; j < customBuffer.H; j++)
-                customBuffer.paintAt(i, j, Colors::dark, CustomFrameBuffer::fill::frame);
-        }
-
 
         if (showTriangleFill) {
             // paint the filled pixels (triangle rasterization)
-            std::vector<glm::ivec2> pixels;
             triangle_rasterizer triangle(x_1, y_1, x_2, y_2, x_3, y_3);
-            // run rasterization
-            pixels = triangle.all_pixels();
-            for (auto it = pixels.begin(); it < pixels.end(); it++) {
-                customBuffer.paintAt(it->x, it->y, Colors::green, CustomFrameBuffer::fill::center);
-            }
+            // run rasterization, the pixels are painted as they are computed (no vector of pixels is allocated)
+            triangle.for_each_pixel([&](int x, int y) {
+                customBuffer.paintAt(x, y, Colors::green, CustomFrameBuffer::fill::center);
+            });
         }
 
         if (showTriangleLines) {
             // paint the lines connecting the vertices (line rasterizer)
-            std::vector<glm::ivec2> pixelsLine;
-            // run rasterization
             LineRasterizer lines[3] = {LineRasterizer(x_1, y_1, x_2, y_2),
                                        LineRasterizer(x_2, y_2, x_3, y_3),
                                        LineRasterizer(x_3, y_3, x_1, y_1)};
+            // run rasterization
             for (auto &l: lines) {
-                pixelsLine = l.all_pixels();
-                for (auto &p: pixelsLine) {
-                    customBuffer.paintAt(p.x, p.y, Colors::white, CustomFrameBuffer::fill::center);
-                }
+                l.for_each_pixel([&](int x, int y) {
+                    customBuffer.paintAt(x, y, Colors::white, CustomFrameBuffer::fill::center);
+                });
             }
         }
 
@@ -147,30 +122,15 @@ int main()
         // show our rendered triangle
         // --------------------------
 
-        // upload the custom color buffer to the GPU using the texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, bufferTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, max_W*3, max_H*3, 0, GL_RGBA, GL_UNSIGNED_BYTE, customBuffer.buffer);
-
-        // set opengl frame buffer object to read from our texture, we will copy from it
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, oglFrameBuffer);
-        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bufferTexture, 0);
-
-        // bind the window frame buffer, where we want to copy the contents of the texture to
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-
-        // copy from opengl the frame buffer object (access the texture) to the window frame buffer
-        glBlitFramebuffer(0,0, max_W * 3, max_H * 3,0,0,SCR_WIDTH,SCR_HEIGHT,GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        // upload the custom color buffer to the GPU and draw it to the window frame buffer
+        display.draw(customBuffer, Colors::dark);
 
 
         glfwSwapBuffers(window);
         glfwPollEvents();
 
-        // control render loop frequency (busy wait)
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
+        // control render loop frequency
+        pacer.endFrame();
     }
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
@@ -50,19 +50,28 @@ void triangle_rasterizer::next_fragment()
         this->x_current += 1;
     }
     else {
-        this->leftedge.next_fragment();
-        this->rightedge.next_fragment();
-        while (this->leftedge.more_fragments() && (leftedge.x() >= rightedge.x())) {
-            leftedge.next_fragment();
-            rightedge.next_fragment();
-        }
-        this->valid = this->leftedge.more_fragments();
-        if (this->valid) {
-            this->x_start   = leftedge.x();
-            this->x_current = this->x_start;
-            this->x_stop    = rightedge.x() - 1;
-            this->y_current = leftedge.y();
-        }
+        this->next_scanline();
+    }
+}
+
+/*
+ * Moves to the first pixel of the next scanline that has pixels inside the triangle
+ */
+void triangle_rasterizer::next_scanline()
+{
+    this->leftedge.next_fragment();
+    this->rightedge.next_fragment();
+    // the edges are valid in the loop, so the checks of x() and y() are not needed
+    while (this->leftedge.more_fragments() && (leftedge.x_unchecked() >= rightedge.x_unchecked())) {
+        leftedge.next_fragment();
+        rightedge.next_fragment();
+    }
+    this->valid = this->leftedge.more_fragments();
+    if (this->valid) {
+        this->x_start   = leftedge.x_unchecked();
+        this->x_current = this->x_start;
+        this->x_stop    = rightedge.x_unchecked() - 1;
+        this->y_current = leftedge.y_unchecked();
     }
 }
 
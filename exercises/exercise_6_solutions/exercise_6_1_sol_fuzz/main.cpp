@@ -0,0 +1,618 @@
+// correctness fuzzer and throughput microbenchmarks for the rasterizers of exercise 6
+//
+// fuzzing compares triangle_rasterizer (and the edge_rasterizer it uses) and LineRasterizer against simple
+// brute force references, on random primitives of every size, including degenerate ones:
+//  - triangles must cover exactly the pixels whose center is inside the triangle, with the top-left rule
+//    (pixels on a left or bottom edge are inside, pixels on a right or top edge are outside),
+//    the pixel by pixel interface (next_fragment) must agree with for_each_span
+//  - meshes of triangles that share edges must be watertight, every pixel inside the mesh is covered exactly once
+//  - lines must cover the pixel closest to the ideal line at every step along the major axis,
+//    and the same pixels in both directions
+//  - anti-aliased lines (only in the exercise 7 build, see FUZZ_AA_LINES) must give every pixel that overlaps the
+//    line, once, with a coverage close to the area measured with 16x16 samples per pixel
+//  - no rasterizer may throw
+// the benchmarks measure million pixels/s and million primitives/s by size class
+//
+// usage: exercise_6_1_sol_fuzz [--seed N] [--iterations N] [--fuzz-only] [--bench-only]
+//   --seed         seed of the random primitives (default 1), a failure is reproduced with the same seed
+//   --iterations   number of random primitives of each fuzzing test (default 20000)
+// returns 1 if any fuzzing test fails
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+#include "trianglerasterizer.h"
+#include "linerasterizer.h"
+#ifdef FUZZ_AA_LINES
+#include "aalinerasterizer.h"
+#endif
+
+typedef std::vector<glm::ivec2> Pixels;
+typedef std::chrono::steady_clock Clock;
+
+// the benchmarks write their results here, so that the loops can't be optimized away
+volatile uint64_t sink = 0;
+
+struct Failures {
+    unsigned int count = 0;
+    // only the first failures of each test are printed
+    void report(const std::string &test, const std::string &message){
+        if (count++ < 10)
+            std::cout << "  FAIL " << test << ": " << message << std::endl;
+    }
+};
+
+Pixels referenceTriangle(const glm::ivec2 v[3]);
+Pixels referenceLine(glm::ivec2 a, glm::ivec2 b);
+bool rasterizeTriangle(const glm::ivec2 v[3], Pixels &spans, Pixels &fragments, std::string &error);
+bool rasterizeLine(glm::ivec2 a, glm::ivec2 b, Pixels &pixels, std::string &error);
+std::string describe(const glm::ivec2 *v, int count);
+std::string firstDifference(Pixels a, Pixels b);
+
+void fuzzTriangles(std::mt19937 &rng, unsigned int iterations, Failures &failures);
+void fuzzMeshes(std::mt19937 &rng, unsigned int iterations, Failures &failures);
+void fuzzLines(std::mt19937 &rng, unsigned int iterations, Failures &failures);
+#ifdef FUZZ_AA_LINES
+void fuzzAALines(std::mt19937 &rng, unsigned int iterations, Failures &failures);
+#endif
+void benchTriangles(std::mt19937 &rng);
+void benchLines(std::mt19937 &rng);
+
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = 1;
+    unsigned int iterations = 20000;
+    bool fuzz = true, bench = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--fuzz-only") == 0) bench = false;
+        else if (std::strcmp(argv[i], "--bench-only") == 0) fuzz = false;
+        else {
+            std::cout << "usage: " << argv[0] << " [--seed N] [--iterations N] [--fuzz-only] [--bench-only]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    unsigned int failed = 0;
+    if (fuzz) {
+        std::cout << "fuzzing with seed " << seed << ", " << iterations << " iterations per test" << std::endl;
+        std::pair<const char*, std::function<void(std::mt19937&, unsigned int, Failures&)> > tests[] = {
+                {"triangles", fuzzTriangles}, {"meshes", fuzzMeshes}, {"lines", fuzzLines},
+#ifdef FUZZ_AA_LINES
+                {"aa lines", fuzzAALines},
+#endif
+        };
+        for (auto &test : tests) {
+            Failures failures;
+            test.second(rng, iterations, failures);
+            std::cout << std::left << std::setw(12) << test.first << (failures.count ? "FAILED" : "ok");
+            if (failures.count)
+                std::cout << " (" << failures.count << " failures)";
+            std::cout << std::endl;
+            failed += failures.count;
+        }
+    }
+    if (bench) {
+        benchTriangles(rng);
+        benchLines(rng);
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+
+// REFERENCES
+// ----------
+
+// twice the signed area of the triangle (a, b, p), positive if p is to the left of a->b (y up)
+int64_t edgeFunction(glm::ivec2 a, glm::ivec2 b, glm::ivec2 p){
+    return int64_t(b.x - a.x) * (p.y - a.y) - int64_t(b.y - a.y) * (p.x - a.x);
+}
+
+// pixels of the triangle, tested one by one over the bounding box, sorted by y and then x
+Pixels referenceTriangle(const glm::ivec2 v[3]){
+    Pixels pixels;
+    glm::ivec2 a = v[0], b = v[1], c = v[2];
+    int64_t area = edgeFunction(a, b, c);
+    if (area == 0)
+        return pixels;
+    // counter-clockwise, so the inside is to the left of every edge
+    if (area < 0)
+        std::swap(b, c);
+    const glm::ivec2 e0[3] = {a, b, c}, e1[3] = {b, c, a};
+    // top-left rule: the edges that go down are left edges, and a horizontal edge that goes right is a bottom edge
+    bool inclusive[3];
+    for (int e = 0; e < 3; e++) {
+        glm::ivec2 d = e1[e] - e0[e];
+        inclusive[e] = d.y < 0 || (d.y == 0 && d.x > 0);
+    }
+    glm::ivec2 lo = glm::min(a, glm::min(b, c)), hi = glm::max(a, glm::max(b, c));
+    for (int y = lo.y; y <= hi.y; y++) {
+        for (int x = lo.x; x <= hi.x; x++) {
+            bool inside = true;
+            for (int e = 0; e < 3 && inside; e++) {
+                int64_t f = edgeFunction(e0[e], e1[e], glm::ivec2(x, y));
+                inside = f > 0 || (f == 0 && inclusive[e]);
+            }
+            if (inside)
+                pixels.push_back(glm::ivec2(x, y));
+        }
+    }
+    return pixels;
+}
+
+// at each step along the major axis, the pixel closest to the ideal line, a line with no length has no pixels
+// ties are rounded away from the first end point, so the line covers the same pixels in both directions
+Pixels referenceLine(glm::ivec2 a, glm::ivec2 b){
+    Pixels pixels;
+    glm::ivec2 d = b - a;
+    bool xMajor = std::abs(d.x) > std::abs(d.y);
+    int steps = xMajor ? std::abs(d.x) : std::abs(d.y);
+    if (steps == 0)
+        return pixels;
+    for (int k = 0; k <= steps; k++) {
+        // the minor coordinate is a + k * minor / steps, rounded with exact integer arithmetic
+        int64_t minor = xMajor ? d.y : d.x;
+        int64_t num = int64_t(2) * k * std::abs(minor) + steps;
+        int64_t offset = num / (2 * steps);
+        // exactly halfway between two pixels: round towards the start when the line goes in the negative direction
+        bool negative = xMajor ? d.x < 0 : d.y < 0;
+        if (num % (2 * steps) == 0 && negative && offset > 0)
+            offset--;
+        int m = int(minor < 0 ? -offset : offset);
+        int s = xMajor ? (d.x < 0 ? -k : k) : (d.y < 0 ? -k : k);
+        pixels.push_back(xMajor ? glm::ivec2(a.x + s, a.y + m) : glm::ivec2(a.x + m, a.y + s));
+    }
+    return pixels;
+}
+
+
+// RASTERIZERS UNDER TEST
+// ----------------------
+
+// runs the span interface and the pixel by pixel interface, false (and the error) if anything throws
+bool rasterizeTriangle(const glm::ivec2 v[3], Pixels &spans, Pixels &fragments, std::string &error){
+    spans.clear();
+    fragments.clear();
+    try {
+        triangle_rasterizer spanRasterizer(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        spanRasterizer.for_each_span([&](int y, int xBegin, int xEnd){
+            for (int x = xBegin; x < xEnd; x++)
+                spans.push_back(glm::ivec2(x, y));
+        });
+        triangle_rasterizer pixelRasterizer(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        while (pixelRasterizer.more_fragments()) {
+            fragments.push_back(glm::ivec2(pixelRasterizer.x(), pixelRasterizer.y()));
+            pixelRasterizer.next_fragment();
+        }
+    }
+    catch (const std::exception &e) {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+// runs the pixel by pixel interface and for_each_pixel, false (and the error) if they differ or anything throws
+bool rasterizeLine(glm::ivec2 a, glm::ivec2 b, Pixels &pixels, std::string &error){
+    pixels.clear();
+    try {
+        LineRasterizer rasterizer(a.x, a.y, b.x, b.y);
+        while (rasterizer.more_fragments()) {
+            pixels.push_back(glm::ivec2(rasterizer.x(), rasterizer.y()));
+            rasterizer.next_fragment();
+        }
+        // for_each_pixel must give the same pixels in the same order
+        Pixels callback;
+        LineRasterizer(a.x, a.y, b.x, b.y).for_each_pixel([&](int x, int y){ callback.push_back(glm::ivec2(x, y)); });
+        if (callback != pixels) {
+            error = "next_fragment and for_each_pixel don't agree";
+            return false;
+        }
+    }
+    catch (const std::exception &e) {
+        error = std::string("threw ") + e.what();
+        return false;
+    }
+    return true;
+}
+
+std::string describe(const glm::ivec2 *v, int count){
+    std::ostringstream s;
+    for (int i = 0; i < count; i++)
+        s << (i ? " " : "") << "(" << v[i].x << ", " << v[i].y << ")";
+    return s.str();
+}
+
+// empty if both lists have the same pixels, in any order
+std::string firstDifference(Pixels a, Pixels b){
+    auto less = [](glm::ivec2 p, glm::ivec2 q){ return p.y < q.y || (p.y == q.y && p.x < q.x); };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    for (size_t i = 0; i < std::max(a.size(), b.size()); i++) {
+        if (i < a.size() && i < b.size() && a[i] == b[i])
+            continue;
+        std::ostringstream s;
+        s << a.size() << " pixels instead of " << b.size() << ", first difference at index " << i;
+        if (i < a.size()) s << " got (" << a[i].x << ", " << a[i].y << ")";
+        if (i < b.size()) s << " expected (" << b[i].x << ", " << b[i].y << ")";
+        return s.str();
+    }
+    return "";
+}
+
+
+// FUZZING
+// -------
+
+// random vertex in [-range, range], with a few vertices snapped to each other to make degenerate primitives
+glm::ivec2 randomPoint(std::mt19937 &rng, int range){
+    std::uniform_int_distribution<int> coord(-range, range);
+    return glm::ivec2(coord(rng), coord(rng));
+}
+
+void fuzzTriangles(std::mt19937 &rng, unsigned int iterations, Failures &failures){
+    const int ranges[] = {2, 8, 64, 300};
+    Pixels spans, fragments;
+    for (unsigned int i = 0; i < iterations; i++) {
+        int range = ranges[i % 4];
+        glm::ivec2 v[3] = {randomPoint(rng, range), randomPoint(rng, range), randomPoint(rng, range)};
+        switch (rng() % 8) {
+            case 0: v[1] = v[0]; break;                            // two equal vertices
+            case 1: v[2] = v[0] + (v[1] - v[0]) * 2; break;        // collinear
+            case 2: v[1].y = v[0].y; break;                        // horizontal edge
+            case 3: // sliver, a few pixels high and much longer
+                v[1] = v[0] + glm::ivec2(range * 8, int(rng() % 4));
+                v[2] = v[0] + glm::ivec2(int(rng() % (range * 8 + 1)), int(rng() % 4)); break;
+            default: break;
+        }
+
+        std::string error;
+        if (!rasterizeTriangle(v, spans, fragments, error)) {
+            failures.report("triangle " + describe(v, 3), "threw " + error);
+            continue;
+        }
+        std::string diff = firstDifference(spans, referenceTriangle(v));
+        if (!diff.empty())
+            failures.report("triangle " + describe(v, 3), diff);
+        else if (spans != fragments)
+            failures.report("triangle " + describe(v, 3), "next_fragment and for_each_span don't agree");
+    }
+}
+
+// grid meshes with jittered inner vertices, the two triangles of each cell use a random diagonal and random
+// vertex orders, every pixel strictly inside the grid must be covered once, and no pixel outside of it
+void fuzzMeshes(std::mt19937 &rng, unsigned int iterations, Failures &failures){
+    Pixels spans, fragments;
+    for (unsigned int i = 0; i < iterations / 100 + 1; i++) {
+        int cells = 2 + rng() % 6;
+        int cellSize = 4 + rng() % 40;
+        int size = cells * cellSize;
+        glm::ivec2 origin = randomPoint(rng, 100);
+        std::uniform_int_distribution<int> jitter(-(cellSize / 3), cellSize / 3);
+        std::vector<glm::ivec2> grid((cells + 1) * (cells + 1));
+        for (int y = 0; y <= cells; y++) {
+            for (int x = 0; x <= cells; x++) {
+                bool border = x == 0 || y == 0 || x == cells || y == cells;
+                grid[x + y * (cells + 1)] = origin + glm::ivec2(x, y) * cellSize
+                                            + (border ? glm::ivec2(0) : glm::ivec2(jitter(rng), jitter(rng)));
+            }
+        }
+
+        std::vector<int> coverage(size * size, 0);
+        int outside = 0;
+        for (int y = 0; y < cells; y++) {
+            for (int x = 0; x < cells; x++) {
+                glm::ivec2 c[4] = {grid[x + y * (cells + 1)], grid[x + 1 + y * (cells + 1)],
+                                   grid[x + 1 + (y + 1) * (cells + 1)], grid[x + (y + 1) * (cells + 1)]};
+                // diagonal 0-2 or 1-3, a jittered cell can be concave, then only one of them splits it in two
+                // counter-clockwise triangles, the other one would make overlapping triangles
+                int d = rng() % 2;
+                if (edgeFunction(c[d], c[d + 1], c[d + 2]) <= 0 || edgeFunction(c[d + 2], c[(d + 3) % 4], c[d]) <= 0)
+                    d = 1 - d;
+                glm::ivec2 tris[2][3] = {{c[d], c[d + 1], c[d + 2]}, {c[d + 2], c[(d + 3) % 4], c[d]}};
+                for (auto &tri : tris) {
+                    std::shuffle(tri, tri + 3, rng);
+                    std::string error;
+                    if (!rasterizeTriangle(tri, spans, fragments, error)) {
+                        failures.report("mesh triangle " + describe(tri, 3), "threw " + error);
+                        continue;
+                    }
+                    for (auto &p : spans) {
+                        glm::ivec2 local = p - origin;
+                        if (local.x < 0 || local.y < 0 || local.x >= size || local.y >= size) outside++;
+                        else coverage[local.x + local.y * size]++;
+                    }
+                }
+            }
+        }
+
+        std::ostringstream s;
+        s << cells << "x" << cells << " cells of " << cellSize << " pixels at (" << origin.x << ", " << origin.y << ")";
+        if (outside)
+            failures.report("mesh " + s.str(), std::to_string(outside) + " pixels outside of the mesh");
+        // the pixels on the left and bottom border of the grid are inside, the ones on the right and top are not
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int covered = coverage[x + y * size];
+                if (covered != 1) {
+                    failures.report("mesh " + s.str(), "pixel (" + std::to_string(origin.x + x) + ", "
+                                    + std::to_string(origin.y + y) + ") covered " + std::to_string(covered) + " times");
+                    y = size;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void fuzzLines(std::mt19937 &rng, unsigned int iterations, Failures &failures){
+    const int ranges[] = {2, 8, 64, 2000};
+    Pixels pixels, reversed;
+    for (unsigned int i = 0; i < iterations; i++) {
+        int range = ranges[i % 4];
+        glm::ivec2 v[2] = {randomPoint(rng, range), randomPoint(rng, range)};
+        switch (rng() % 6) {
+            case 0: v[1] = v[0]; break;                                            // no length
+            case 1: v[1].y = v[0].y; break;                                        // horizontal
+            case 2: v[1].x = v[0].x; break;                                        // vertical
+            case 3: { int d = v[1].x - v[0].x; v[1].y = v[0].y + (rng() % 2 ? d : -d); break; } // diagonal
+            default: break;
+        }
+
+        std::string error;
+        if (!rasterizeLine(v[0], v[1], pixels, error) || !rasterizeLine(v[1], v[0], reversed, error)) {
+            failures.report("line " + describe(v, 2), error);
+            continue;
+        }
+        Pixels expected = referenceLine(v[0], v[1]);
+        if (pixels != expected)
+            failures.report("line " + describe(v, 2), firstDifference(pixels, expected) + " or in a different order");
+        else if (!firstDifference(pixels, reversed).empty())
+            failures.report("line " + describe(v, 2), "different pixels when drawn in the other direction");
+    }
+}
+
+#ifdef FUZZ_AA_LINES
+// fraction of pixel (x, y) inside the line, measured with 16x16 samples
+float referenceAACoverage(glm::vec2 a, glm::vec2 b, float width, AALineRasterizer::Cap cap, int x, int y){
+    const int samples = 16;
+    float length = glm::length(b - a);
+    glm::vec2 dir = length > 0.f ? (b - a) / length : glm::vec2(1.f, 0.f);
+    float halfWidth = width * .5f, capExtent = cap == AALineRasterizer::Cap::butt ? 0.f : halfWidth;
+    // no sample of a pixel farther than that from the segment is in the line
+    glm::vec2 center = glm::vec2(x, y) - a;
+    if (glm::length(center - dir * glm::clamp(glm::dot(center, dir), 0.f, length)) > halfWidth + capExtent + 1.f)
+        return 0.f;
+    int inside = 0;
+    for (int i = 0; i < samples; i++) {
+        for (int j = 0; j < samples; j++) {
+            // one sample in each cell of the grid, moved in its cell so that the samples are not in rows and columns,
+            // a line along the grid would be measured with an error of up to a row of samples
+            float jitterX = std::fmod(.5f + j * .618034f, 1.f), jitterY = std::fmod(.5f + i * .618034f, 1.f);
+            glm::vec2 p = glm::vec2(x - .5f + (i + jitterX) / samples, y - .5f + (j + jitterY) / samples) - a;
+            float u = glm::dot(p, dir);
+            if (cap == AALineRasterizer::Cap::round)
+                inside += glm::length(p - dir * glm::clamp(u, 0.f, length)) <= halfWidth;
+            else
+                inside += u >= -capExtent && u <= length + capExtent && std::abs(dir.x * p.y - dir.y * p.x) <= halfWidth;
+        }
+    }
+    return inside / float(samples * samples);
+}
+
+// the coverage is a box filter split along and across the line, exact only for horizontal and vertical lines, so it
+// is compared with a tolerance: per pixel, and for the sum over the line, which is its area
+void fuzzAALines(std::mt19937 &rng, unsigned int iterations, Failures &failures){
+    const float ranges[] = {2.f, 8.f, 64.f};
+    const AALineRasterizer::Cap caps[] = {AALineRasterizer::Cap::butt, AALineRasterizer::Cap::square,
+                                          AALineRasterizer::Cap::round};
+    const float pixelTolerance = .2f, areaTolerance = .05f;
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<float> got;
+    // the reference is slow, the lines are fewer than in the other tests
+    for (unsigned int i = 0; i < iterations / 10 + 1; i++) {
+        float range = ranges[i % 3];
+        glm::vec2 a(unit(rng) * 2 * range - range, unit(rng) * 2 * range - range);
+        glm::vec2 b(unit(rng) * 2 * range - range, unit(rng) * 2 * range - range);
+        switch (rng() % 5) {
+            case 0: b = a; break;                                                  // no length
+            case 1: b.y = a.y; break;                                              // horizontal
+            case 2: b.x = a.x + (rng() % 2 ? b.y - a.y : a.y - b.y); break;        // diagonal
+            default: break;
+        }
+        float width = .25f + unit(rng) * 6.f;
+        AALineRasterizer::Cap cap = caps[rng() % 3];
+
+        std::ostringstream name;
+        name << "aa line (" << a.x << ", " << a.y << ") (" << b.x << ", " << b.y << ") width " << width
+             << " cap " << (int) cap;
+        glm::ivec2 lo(glm::floor(glm::min(a, b) - width - 2.f)), hi(glm::ceil(glm::max(a, b) + width + 2.f));
+        glm::ivec2 size = hi - lo + 1;
+        got.assign(size.x * size.y, -1.f);
+        std::string error;
+        try {
+            AALineRasterizer rasterizer(a.x, a.y, b.x, b.y, width, cap);
+            int lastY = lo.y;
+            rasterizer.for_each_pixel([&](int x, int y, float coverage, float t){
+                if (!error.empty())
+                    return;
+                std::string at = " at (" + std::to_string(x) + ", " + std::to_string(y) + ")";
+                if (x < lo.x || y < lo.y || x > hi.x || y > hi.y)
+                    error = "pixel out of reach of the line" + at;
+                else if (y < lastY)
+                    error = "pixels not in scanline order" + at;
+                else if (got[(x - lo.x) + (y - lo.y) * size.x] >= 0.f)
+                    error = "pixel given twice" + at;
+                else if (!(coverage > 0.f && coverage <= 1.f) || !(t >= 0.f && t <= 1.f))
+                    error = "coverage " + std::to_string(coverage) + " or t " + std::to_string(t) + " out of range" + at;
+                else
+                    got[(x - lo.x) + (y - lo.y) * size.x] = coverage;
+                lastY = y;
+            });
+            // the scanline range must not skip a pixel that the line overlaps
+            for (int y = lo.y; y <= hi.y && error.empty(); y++) {
+                for (int x = lo.x; x <= hi.x && error.empty(); x++) {
+                    if (rasterizer.coverage(x, y) > 0.f && got[(x - lo.x) + (y - lo.y) * size.x] < 0.f)
+                        error = "pixel (" + std::to_string(x) + ", " + std::to_string(y) + ") skipped";
+                }
+            }
+        }
+        catch (const std::exception &e) {
+            error = std::string("threw ") + e.what();
+        }
+        if (!error.empty()) {
+            failures.report(name.str(), error);
+            continue;
+        }
+
+        // the approximation is too coarse for lines thinner than a pixel, only the pixels they give are checked
+        double area = 0, referenceArea = 0;
+        for (int y = lo.y; y <= hi.y; y++) {
+            for (int x = lo.x; x <= hi.x; x++) {
+                float coverage = std::max(0.f, got[(x - lo.x) + (y - lo.y) * size.x]);
+                float reference = referenceAACoverage(a, b, width, cap, x, y);
+                area += coverage;
+                referenceArea += reference;
+                if (width >= 1.f && std::abs(coverage - reference) > pixelTolerance && error.empty())
+                    error = "coverage " + std::to_string(coverage) + " instead of " + std::to_string(reference)
+                            + " at (" + std::to_string(x) + ", " + std::to_string(y) + ")";
+            }
+        }
+        if (error.empty() && width >= 1.f && referenceArea >= 16.0
+            && std::abs(area - referenceArea) > areaTolerance * referenceArea)
+            error = "area " + std::to_string(area) + " instead of " + std::to_string(referenceArea);
+        if (!error.empty())
+            failures.report(name.str(), error);
+    }
+}
+#endif
+
+
+// BENCHMARKS
+// ----------
+
+// random triangle, of a size class, inside a 2048x2048 screen
+void randomTriangle(std::mt19937 &rng, const std::string &sizeClass, glm::ivec2 v[3]){
+    if (sizeClass == "sliver") {
+        // long and thin, 1 to 3 pixels wide, in a random direction
+        glm::ivec2 a = randomPoint(rng, 1024) / 2 + glm::ivec2(1024);
+        float angle = std::uniform_real_distribution<float>(0.f, 6.2831853f)(rng);
+        glm::vec2 dir(std::cos(angle), std::sin(angle));
+        v[0] = a;
+        v[1] = a + glm::ivec2(dir * 800.f);
+        v[2] = a + glm::ivec2(dir * 400.f + glm::vec2(-dir.y, dir.x) * float(1 + rng() % 3));
+        return;
+    }
+    int size = sizeClass == "tiny" ? 3 : (sizeClass == "medium" ? 48 : 2047);
+    glm::ivec2 corner = sizeClass == "huge" ? glm::ivec2(0) : randomPoint(rng, 1024 - size) + glm::ivec2(1024);
+    std::uniform_int_distribution<int> coord(0, size);
+    for (int i = 0; i < 3; i++)
+        v[i] = corner + glm::ivec2(coord(rng), coord(rng));
+}
+
+// runs f over all the primitives, and prints the throughput of the fastest of three runs
+void printThroughput(const std::string &name, size_t primitives, const std::function<uint64_t()> &f){
+    double best = 1e30;
+    uint64_t pixels = 0;
+    for (int run = 0; run < 3; run++) {
+        Clock::time_point start = Clock::now();
+        pixels = f();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << best * 1e3 << std::setw(14) << pixels / best * 1e-6
+              << std::setw(14) << primitives / best * 1e-6 << std::setw(14) << double(pixels) / primitives << std::endl;
+}
+
+void printHeader(const std::string &title){
+    std::cout << std::endl << std::left << std::setw(36) << title << std::right << std::setw(12) << "ms"
+              << std::setw(14) << "Mpixels/s" << std::setw(14) << "Mprims/s" << std::setw(14) << "pixels/prim" << std::endl;
+}
+
+void benchTriangles(std::mt19937 &rng){
+    printHeader("triangles");
+    const std::pair<const char*, unsigned int> classes[] = {{"tiny", 200000}, {"medium", 20000}, {"huge", 20}, {"sliver", 20000}};
+    for (auto &sizeClass : classes) {
+        std::vector<glm::ivec2> tris(sizeClass.second * 3);
+        for (unsigned int i = 0; i < sizeClass.second; i++)
+            randomTriangle(rng, sizeClass.first, &tris[i * 3]);
+
+        std::string name = sizeClass.first;
+        printThroughput(name + " next_fragment", sizeClass.second, [&]{
+            uint64_t pixels = 0, sum = 0;
+            for (unsigned int i = 0; i < tris.size(); i += 3) {
+                triangle_rasterizer r(tris[i].x, tris[i].y, tris[i + 1].x, tris[i + 1].y, tris[i + 2].x, tris[i + 2].y);
+                for (; r.more_fragments(); r.next_fragment(), pixels++)
+                    sum += r.x() ^ r.y();
+            }
+            sink = sum;
+            return pixels;
+        });
+        printThroughput(name + " for_each_pixel", sizeClass.second, [&]{
+            uint64_t pixels = 0, sum = 0;
+            for (unsigned int i = 0; i < tris.size(); i += 3) {
+                triangle_rasterizer r(tris[i].x, tris[i].y, tris[i + 1].x, tris[i + 1].y, tris[i + 2].x, tris[i + 2].y);
+                r.for_each_pixel([&](int x, int y){ sum += x ^ y; pixels++; });
+            }
+            sink = sum;
+            return pixels;
+        });
+        printThroughput(name + " for_each_span", sizeClass.second, [&]{
+            uint64_t pixels = 0, sum = 0;
+            for (unsigned int i = 0; i < tris.size(); i += 3) {
+                triangle_rasterizer r(tris[i].x, tris[i].y, tris[i + 1].x, tris[i + 1].y, tris[i + 2].x, tris[i + 2].y);
+                r.for_each_span([&](int y, int xBegin, int xEnd){ sum += y ^ xBegin; pixels += xEnd - xBegin; });
+            }
+            sink = sum;
+            return pixels;
+        });
+    }
+}
+
+void benchLines(std::mt19937 &rng){
+    printHeader("lines");
+    const std::pair<const char*, int> classes[] = {{"short", 4}, {"medium", 64}, {"long", 1024}};
+    for (auto &sizeClass : classes) {
+        unsigned int count = 2000000 / sizeClass.second;
+        std::vector<glm::ivec2> lines(count * 2);
+        for (unsigned int i = 0; i < count; i++) {
+            lines[i * 2] = randomPoint(rng, 1024 - sizeClass.second) + glm::ivec2(1024);
+            lines[i * 2 + 1] = lines[i * 2] + randomPoint(rng, sizeClass.second);
+        }
+
+        std::string name = sizeClass.first;
+        printThroughput(name + " next_fragment", count, [&]{
+            uint64_t pixels = 0, sum = 0;
+            for (unsigned int i = 0; i < lines.size(); i += 2) {
+                LineRasterizer r(lines[i].x, lines[i].y, lines[i + 1].x, lines[i + 1].y);
+                for (; r.more_fragments(); r.next_fragment(), pixels++)
+                    sum += r.x() ^ r.y();
+            }
+            sink = sum;
+            return pixels;
+        });
+        printThroughput(name + " for_each_pixel", count, [&]{
+            uint64_t pixels = 0, sum = 0;
+            for (unsigned int i = 0; i < lines.size(); i += 2) {
+                LineRasterizer r(lines[i].x, lines[i].y, lines[i + 1].x, lines[i + 1].y);
+                r.for_each_pixel([&](int x, int y){ sum += x ^ y; pixels++; });
+            }
+            sink = sum;
+            return pixels;
+        });
+    }
+}
@@ -0,0 +1,172 @@
+#include "aalinerasterizer.h"
+
+
+/*
+ * \class AALineRasterizer
+ * A class which scanconverts an anti-aliased straight line of any width. The line is a rectangle around the
+ * segment between the two end points, and each pixel gets the fraction of its area covered by the rectangle.
+ */
+
+/*
+ * Parameterized constructor creates an instance of an anti-aliased line rasterizer
+ * \param x1 - the x-coordinate of the first vertex
+ * \param y1 - the y-coordinate of the first vertex
+ * \param x2 - the x-coordinate of the second vertex
+ * \param y2 - the y-coordinate of the second vertex
+ * \param width - the width of the line in pixels
+ * \param cap - the shape of the ends of the line
+ */
+AALineRasterizer::AALineRasterizer(float x1, float y1, float x2, float y2, float width, Cap cap)
+{
+    this->init(x1, y1, x2, y2, width, cap);
+}
+
+/*
+ * Destroys the current instance of the anti-aliased line rasterizer
+ */
+AALineRasterizer::~AALineRasterizer()
+{}
+
+/*
+ * Initializes the AALineRasterizer with a new line
+ */
+void AALineRasterizer::init(float x1, float y1, float x2, float y2, float width, Cap cap)
+{
+    this->p1 = glm::vec2(x1, y1);
+    this->p2 = glm::vec2(x2, y2);
+    this->length = glm::length(this->p2 - this->p1);
+    // a line with no length has no direction, its caps are drawn around the point
+    this->dir = this->length > 0.f ? (this->p2 - this->p1) / this->length : glm::vec2(1.f, 0.f);
+    this->half_width = std::max(width, 0.f) * .5f;
+    this->cap = cap;
+    this->cap_extent = cap == Cap::butt ? 0.f : this->half_width;
+
+    // the points of a pixel projected on either axis of the line are spread like the sum of two uniform distributions,
+    // of widths |dir.x| and |dir.y|, so the part of a pixel in a band of that axis is exact (see cumulative)
+    float wide = std::max(std::abs(this->dir.x), std::abs(this->dir.y));
+    float narrow = std::min(std::abs(this->dir.x), std::abs(this->dir.y));
+    this->spread_h = (wide + narrow) * .5f;
+    this->spread_k = (wide - narrow) * .5f;
+    this->ramp_scale = narrow > 1e-4f ? 1.f / (2.f * wide * narrow) : 0.f;
+    this->flat_scale = 1.f / wide;
+
+    // a pixel overlaps the line only if its center is closer than the half width plus half a pixel diagonal
+    float reach = this->half_width + this->cap_extent + 1.f;
+    this->y_begin = int(std::floor(std::min(y1, y2) - reach));
+    this->y_end = int(std::ceil(std::max(y1, y2) + reach)) + 1;
+}
+
+/*
+ * Returns the fraction of pixel (x, y) covered by the line, in [0, 1]
+ */
+float AALineRasterizer::coverage(int x, int y) const
+{
+    // the pixel in the frame of the line: u along the line from the first vertex, v across it
+    glm::vec2 p = glm::vec2(x, y) - this->p1;
+    float u = glm::dot(p, this->dir);
+    float v = std::abs(this->dir.x * p.y - this->dir.y * p.x);
+
+    if (this->cap == Cap::round) {
+        // away from the ends the round caps don't matter, near them the pixel is sampled: the points closer than the
+        // half width to the segment are inside
+        if (u >= .75f && u <= this->length - .75f)
+            return this->band(v, -this->half_width, this->half_width);
+        // a pixel is within half a diagonal of its center
+        float dist = glm::length(p - this->dir * glm::clamp(u, 0.f, this->length));
+        if (dist >= this->half_width + .71f)
+            return 0.f;
+        if (dist <= this->half_width - .71f)
+            return 1.f;
+        const int samples = 4;
+        int inside = 0;
+        for (int i = 0; i < samples; i++) {
+            for (int j = 0; j < samples; j++) {
+                glm::vec2 s = p + glm::vec2((i + .5f) / samples - .5f, (j + .5f) / samples - .5f);
+                float t = glm::clamp(glm::dot(s, this->dir), 0.f, this->length);
+                inside += glm::length(s - this->dir * t) <= this->half_width;
+            }
+        }
+        return inside / float(samples * samples);
+    }
+
+    // exact along the sides, the corners multiply the parts across and along the line
+    float across = this->band(v, -this->half_width, this->half_width);
+    float along = this->band(u, -this->cap_extent, this->length + this->cap_extent);
+    return std::min(1.f, across * along);
+}
+
+/*
+ * Returns the position of the center of pixel (x, y) along the line, 0 at the first vertex and 1 at the
+ * second vertex, clamped to [0, 1]
+ */
+float AALineRasterizer::parameter(int x, int y) const
+{
+    if (!(this->length > 0.f))
+        return 0.f;
+    float u = glm::dot(glm::vec2(x, y) - this->p1, this->dir);
+    return glm::clamp(u / this->length, 0.f, 1.f);
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Fraction of the pixel centered at c, projected on an axis of the line, that is in [b0, b1]
+ */
+float AALineRasterizer::band(float c, float b0, float b1) const
+{
+    // most pixels are entirely in or out of the band
+    if (c - this->spread_h >= b0 && c + this->spread_h <= b1)
+        return 1.f;
+    if (c + this->spread_h <= b0 || c - this->spread_h >= b1)
+        return 0.f;
+    return this->cumulative(b1 - c) - this->cumulative(b0 - c);
+}
+
+/*
+ * Cumulative distribution of the projection of the pixel, the sum of two uniform distributions of widths |dir.x| and
+ * |dir.y| centered at 0, its density is a trapezoid (a box on a horizontal or vertical axis)
+ */
+float AALineRasterizer::cumulative(float t) const
+{
+    if (t <= -this->spread_h)
+        return 0.f;
+    if (t >= this->spread_h)
+        return 1.f;
+    if (t < -this->spread_k)
+        return (t + this->spread_h) * (t + this->spread_h) * this->ramp_scale;
+    if (t > this->spread_k)
+        return 1.f - (this->spread_h - t) * (this->spread_h - t) * this->ramp_scale;
+    return .5f + t * this->flat_scale;
+}
+
+/*
+ * Range of x to test in scanline y, it contains every pixel of the scanline which overlaps the line
+ */
+bool AALineRasterizer::scanline_range(int y, int &x_begin, int &x_end) const
+{
+    // the pixels that overlap the line are within reach of the segment (extended by the caps),
+    // so we only need the part of the segment which is within reach of the scanline
+    float reach = this->half_width + 1.f;
+    glm::vec2 a = this->p1 - this->dir * this->cap_extent;
+    glm::vec2 b = this->p2 + this->dir * this->cap_extent;
+    float t0 = 0.f, t1 = 1.f;
+    float dy = b.y - a.y;
+    if (std::abs(dy) > 1e-6f) {
+        float s0 = (y - reach - a.y) / dy;
+        float s1 = (y + reach - a.y) / dy;
+        t0 = std::max(t0, std::min(s0, s1));
+        t1 = std::min(t1, std::max(s0, s1));
+        if (t0 > t1)
+            return false;
+    }
+    else if (std::abs(y - a.y) > reach)
+        return false;
+
+    float xa = a.x + (b.x - a.x) * t0;
+    float xb = a.x + (b.x - a.x) * t1;
+    x_begin = int(std::floor(std::min(xa, xb) - reach));
+    x_end = int(std::ceil(std::max(xa, xb) + reach)) + 1;
+    return true;
+}
@@ -0,0 +1,137 @@
+#ifndef __AA_LINE_RASTERIZER_H__
+#define __AA_LINE_RASTERIZER_H__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+
+/**
+ * \class AALineRasterizer
+ * A class which scanconverts an anti-aliased straight line of any width. The line is a rectangle around the
+ * segment between the two end points, and each pixel gets the fraction of its area covered by the rectangle: exact
+ * along the sides of the line, approximated at the corners, and sampled for round caps. Pixels are unit squares
+ * centered at integer coordinates, the same convention as LineRasterizer, but the end points don't need to be
+ * rounded to a pixel.
+ */
+class AALineRasterizer {
+public:
+    /**
+     * Shape of the ends of the line
+     * butt ends exactly at the end points, square is extended by half the width, round ends with half a disk
+     */
+    enum class Cap {butt, square, round};
+
+    /**
+     * Parameterized constructor creates an instance of an anti-aliased line rasterizer
+     * \param x1 - the x-coordinate of the first vertex
+     * \param y1 - the y-coordinate of the first vertex
+     * \param x2 - the x-coordinate of the second vertex
+     * \param y2 - the y-coordinate of the second vertex
+     * \param width - the width of the line in pixels
+     * \param cap - the shape of the ends of the line
+     */
+    AALineRasterizer(float x1, float y1, float x2, float y2, float width = 1.f, Cap cap = Cap::butt);
+
+    /**
+     * Destroys the current instance of the anti-aliased line rasterizer
+     */
+    virtual ~AALineRasterizer();
+
+    /**
+     * Initializes the AALineRasterizer with a new line
+     * \param x1 - the x-coordinate of the first vertex
+     * \param y1 - the y-coordinate of the first vertex
+     * \param x2 - the x-coordinate of the second vertex
+     * \param y2 - the y-coordinate of the second vertex
+     * \param width - the width of the line in pixels
+     * \param cap - the shape of the ends of the line
+     */
+    void init(float x1, float y1, float x2, float y2, float width = 1.f, Cap cap = Cap::butt);
+
+    /**
+     * Returns the fraction of pixel (x, y) covered by the line, in [0, 1]
+     */
+    float coverage(int x, int y) const;
+
+    /**
+     * Returns the position of the center of pixel (x, y) along the line, 0 at the first vertex and 1 at the
+     * second vertex, it is clamped to [0, 1] so it can be used to interpolate the vertex attributes
+     */
+    float parameter(int x, int y) const;
+
+    /**
+     * Calls pixel(x, y, coverage, t) for each pixel with a coverage greater than zero, scanline by scanline,
+     * t is the position of the pixel along the line (see parameter)
+     * \param pixel - a callable with signature void(int x, int y, float coverage, float t)
+     */
+    template<class PixelCallback>
+    void for_each_pixel(PixelCallback &&pixel) const;
+
+private:
+    /**
+     * Fraction of the pixel centered at c, projected on an axis of the line, that is in [b0, b1]
+     */
+    float band(float c, float b0, float b1) const;
+
+    /**
+     * Cumulative distribution of the projection of a pixel on an axis of the line, centered at 0
+     */
+    float cumulative(float t) const;
+
+    /**
+     * Range of x to test in scanline y, it contains every pixel of the scanline which overlaps the line
+     * \return false if no pixel of the scanline overlaps the line
+     */
+    bool scanline_range(int y, int &x_begin, int &x_end) const;
+
+    /**
+     * End points, direction (unit length) and length of the line
+     */
+    glm::vec2 p1;
+    glm::vec2 p2;
+    glm::vec2 dir;
+    float length;
+
+    /**
+     * Half the width of the line, and the distance the caps extend past the end points
+     */
+    float half_width;
+    float cap_extent;
+
+    /**
+     * Shape of the projection of a pixel on the axes of the line: half of its extent, half of the extent of its flat
+     * top, and the scales of its cumulative distribution on the ramps and on the flat top
+     */
+    float spread_h;
+    float spread_k;
+    float ramp_scale;
+    float flat_scale;
+
+    Cap cap;
+
+    /**
+     * Range of scanlines that can overlap the line
+     */
+    int y_begin;
+    int y_end;
+};
+
+template<class PixelCallback>
+void AALineRasterizer::for_each_pixel(PixelCallback &&pixel) const
+{
+    for (int y = this->y_begin; y < this->y_end; ++y) {
+        int x_begin, x_end;
+        if (!this->scanline_range(y, x_begin, x_end))
+            continue;
+        for (int x = x_begin; x < x_end; ++x) {
+            float c = this->coverage(x, y);
+            if (c > 0.f)
+                pixel(x, y, c, this->parameter(x, y));
+        }
+    }
+}
+
+#endif
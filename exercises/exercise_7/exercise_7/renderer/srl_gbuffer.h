@@ -0,0 +1,102 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_SRL_GBUFFER_H
+#define ITU_GRAPHICS_PROGRAMMING_SRL_GBUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+
+namespace srl {
+
+    // geometry buffer of the deferred mode (see Renderer::renderDeferred)
+    // it stores the surface attributes of the closest fragment of each pixel, so that every visible pixel is
+    // shaded exactly once, no matter how many fragments were rasterized on top of each other
+    class GBuffer {
+    public:
+        // primitive index of the pixels that were not covered by any fragment
+        static const uint32_t NO_PRIMITIVE = 0xFFFFFFFF;
+
+        unsigned int W, H;
+        DepthBuffer depth;
+        // index of the primitive that generated the visible fragment, it is fast cleared to NO_PRIMITIVE
+        CustomFrameBuffer<uint32_t> primitive;
+        // normal, uv and color (material) are only valid where primitive != NO_PRIMITIVE,
+        // so they don't need to be cleared
+        std::vector<uint32_t> normal;   // octahedral encoding, two 16 bits snorm
+        std::vector<glm::vec2> uv;
+        std::vector<uint32_t> albedo;   // RGBA, 8 bits per channel
+
+        GBuffer(unsigned int width, unsigned int height, DepthFormat depthFormat = DepthFormat::float32):
+                W(width), H(height), depth(width, height, depthFormat), primitive(width, height),
+                normal(width * height), uv(width * height), albedo(width * height) {}
+
+        void clearBuffer(float clearDepth = 1.0f){
+            depth.clearBuffer(clearDepth);
+            primitive.clearBuffer(NO_PRIMITIVE);
+        }
+
+        // depth test the fragment and store its attributes if it is the closest one so far
+        bool write(const fragment &frag){
+            if (!depth.depthTest(frag.pos.x, frag.pos.y, frag.depth))
+                return false;
+            unsigned int idx = frag.pos.x + frag.pos.y * W;
+            primitive.paintAt(frag.pos.x, frag.pos.y, frag.primitive);
+            normal[idx] = encodeNormal(glm::vec3(frag.norm));
+            uv[idx] = frag.uv;
+            albedo[idx] = Colors::toRGBA32(frag.col);
+            return true;
+        }
+
+        // true and the stored attributes of pixel (x, y) in outFrag, false if no fragment was written there
+        bool read(unsigned int x, unsigned int y, fragment &outFrag){
+            uint32_t prim = primitive.valueAt(x, y);
+            if (prim == NO_PRIMITIVE)
+                return false;
+            unsigned int idx = x + y * W;
+            outFrag.pos = glm::ivec2(x, y);
+            outFrag.depth = depth.valueAt(x, y);
+            outFrag.norm = glm::vec4(decodeNormal(normal[idx]), 0);
+            outFrag.uv = uv[idx];
+            outFrag.col = Colors::fromRGBA32(albedo[idx]);
+            outFrag.primitive = prim;
+            return true;
+        }
+
+        // octahedral normal encoding, the normal is projected on the octahedron |x|+|y|+|z| = 1
+        // and the lower half is folded over the upper half, which leaves two coordinates in [-1, 1]
+        static uint32_t encodeNormal(glm::vec3 n){
+            float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            if (!(l1 > 0))
+                return packSnorm(0, 0); // no normal, decodes to (0, 0, 1)
+            glm::vec2 p = glm::vec2(n.x, n.y) / l1;
+            if (n.z < 0)
+                p = glm::vec2((1.f - std::abs(p.y)) * (p.x >= 0 ? 1.f : -1.f),
+                              (1.f - std::abs(p.x)) * (p.y >= 0 ? 1.f : -1.f));
+            return packSnorm(p.x, p.y);
+        }
+
+        static glm::vec3 decodeNormal(uint32_t value){
+            glm::vec2 p(unpackSnorm(value & 0xFFFF), unpackSnorm(value >> 16));
+            glm::vec3 n(p.x, p.y, 1.f - std::abs(p.x) - std::abs(p.y));
+            if (n.z < 0) {
+                n.x = (1.f - std::abs(p.y)) * (p.x >= 0 ? 1.f : -1.f);
+                n.y = (1.f - std::abs(p.x)) * (p.y >= 0 ? 1.f : -1.f);
+            }
+            return glm::normalize(n);
+        }
+
+    private:
+        static uint32_t packSnorm(float x, float y){
+            uint32_t ix = uint16_t(int16_t(glm::round(glm::clamp(x, -1.f, 1.f) * 32767.f)));
+            uint32_t iy = uint16_t(int16_t(glm::round(glm::clamp(y, -1.f, 1.f) * 32767.f)));
+            return ix | (iy << 16);
+        }
+
+        static float unpackSnorm(uint32_t value){
+            return glm::max(float(int16_t(uint16_t(value))) / 32767.f, -1.f);
+        }
+    };
+}
+
+#endif //ITU_GRAPHICS_PROGRAMMING_SRL_GBUFFER_H
@@ -0,0 +1,218 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_SRL_PROFILER_H
+#define ITU_GRAPHICS_PROGRAMMING_SRL_PROFILER_H
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include "srl_types.h"
+
+namespace srl {
+
+    // the stages of Renderer::render, in the order they are executed
+    enum class PipelineStage {
+        processVertices, assemblePrimitives, clipPrimitives, divideByW, toScreenSpace,
+        backfaceCulling, rasterPrimitives, processFragments, writeToFrameBuffer
+    };
+    const unsigned int PIPELINE_STAGE_COUNT = 9;
+
+    inline const char* stageName(PipelineStage stage) {
+        static const char* names[PIPELINE_STAGE_COUNT] = {
+                "processVertices", "assemblePrimitives", "clipPrimitives", "divideByW", "toScreenSpace",
+                "backfaceCulling", "rasterPrimitives", "processFragments", "writeToFrameBuffer"};
+        return names[(int) stage];
+    }
+
+    // what is counted at the input and at the output of a stage
+    enum class StageItems {vertices, primitives, fragments, fragmentsWritten};
+
+    struct StageStats {
+        PipelineStage stage = PipelineStage::processVertices;
+        double startUs = 0;     // microseconds since the profiler was created
+        double durationUs = 0;
+        // number of vertices, primitives or fragments that entered and left the stage
+        unsigned int itemsIn = 0, itemsOut = 0;
+        // primitives marked as rejected (clipped, culled) or created (split by clipping) by the stage
+        unsigned int primitivesRejected = 0, primitivesAdded = 0;
+        // false for the stages that did not run in the frame (e.g. the vertex stages of the visibility buffer frames)
+        bool recorded = false;
+    };
+
+    struct FrameStats {
+        StageStats stages[PIPELINE_STAGE_COUNT];
+        unsigned int frameWidth = 0, frameHeight = 0;
+        unsigned int fragmentsRasterized = 0;
+        unsigned int fragmentsWritten = 0;   // fragments that passed the depth test
+        unsigned int pixelsCovered = 0;      // distinct pixels touched by at least one fragment
+
+        FrameStats() {
+            for (unsigned int i = 0; i < PIPELINE_STAGE_COUNT; i++)
+                stages[i].stage = PipelineStage(i);
+        }
+
+        const StageStats& operator[](PipelineStage stage) const { return stages[(int) stage]; }
+
+        double totalUs() const {
+            double total = 0;
+            for (const auto &s : stages)
+                total += s.durationUs;
+            return total;
+        }
+        unsigned int primitivesClipped() const { return (*this)[PipelineStage::clipPrimitives].primitivesRejected; }
+        // the start of the first stage recorded in the frame, 0 if none was
+        double startUs() const {
+            for (const auto &s : stages)
+                if (s.recorded)
+                    return s.startUs;
+            return 0;
+        }
+        unsigned int primitivesCulled() const { return (*this)[PipelineStage::backfaceCulling].primitivesRejected; }
+        unsigned int fragmentsRejected() const { return fragmentsRasterized - fragmentsWritten; }
+        // average number of fragments generated per covered pixel
+        float overdraw() const { return pixelsCovered ? float(fragmentsRasterized) / float(pixelsCovered) : 0.f; }
+    };
+
+
+    // collects per stage statistics of Renderer::render, attach it with renderer.profiler = &profiler
+    // nothing is measured (or counted) when no profiler is attached to the renderer
+    class Profiler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        // only the last maxFrames frames are kept
+        explicit Profiler(unsigned int maxFrames = 600) : maxFrames(maxFrames), origin(Clock::now()) {}
+
+        void beginFrame(unsigned int width, unsigned int height) {
+            if (m_frames.size() >= maxFrames)
+                m_frames.pop_front();
+            m_frames.emplace_back();
+            m_frames.back().frameWidth = width;
+            m_frames.back().frameHeight = height;
+        }
+
+        void recordStage(PipelineStage stage, Clock::time_point start, Clock::time_point end,
+                         unsigned int itemsIn, unsigned int itemsOut,
+                         unsigned int primitivesRejected, unsigned int primitivesAdded) {
+            StageStats &s = m_frames.back().stages[(int) stage];
+            s.startUs = std::chrono::duration<double, std::micro>(start - origin).count();
+            s.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+            s.itemsIn = itemsIn;
+            s.itemsOut = itemsOut;
+            s.primitivesRejected = primitivesRejected;
+            s.primitivesAdded = primitivesAdded;
+            s.recorded = true;
+        }
+
+        // fragment counts and overdraw of the current frame
+        void recordFragments(const std::vector<fragment> &frs, unsigned int written) {
+            const FrameStats &frame = m_frames.back();
+            m_coverage.assign(frame.frameWidth * frame.frameHeight, 0);
+            unsigned int covered = 0;
+            for (const auto &f : frs) {
+                if (f.pos.x < 0 || f.pos.y < 0 || f.pos.x >= (int) frame.frameWidth || f.pos.y >= (int) frame.frameHeight)
+                    continue;
+                unsigned char &c = m_coverage[f.pos.x + f.pos.y * frame.frameWidth];
+                covered += c == 0;
+                c = 1;
+            }
+            recordFragments(frs.size(), written, covered);
+        }
+
+        // same, for the modes that count the fragments without storing them (e.g. the visibility buffer)
+        void recordFragments(unsigned int rasterized, unsigned int written, unsigned int covered) {
+            FrameStats &frame = m_frames.back();
+            frame.fragmentsRasterized = rasterized;
+            frame.fragmentsWritten = written;
+            frame.pixelsCovered = covered;
+        }
+
+        const std::deque<FrameStats>& frames() const { return m_frames; }
+
+        const FrameStats& lastFrame() const { return m_frames.back(); }
+
+        // per stage mean of the recorded frames (durations and counts)
+        FrameStats average() const {
+            FrameStats avg;
+            if (m_frames.empty())
+                return avg;
+            double n = m_frames.size();
+            double durations[PIPELINE_STAGE_COUNT] = {}, in[PIPELINE_STAGE_COUNT] = {}, out[PIPELINE_STAGE_COUNT] = {};
+            double rejected[PIPELINE_STAGE_COUNT] = {}, added[PIPELINE_STAGE_COUNT] = {};
+            double rasterized = 0, written = 0, covered = 0;
+            for (const auto &f : m_frames) {
+                for (unsigned int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+                    durations[i] += f.stages[i].durationUs;
+                    in[i] += f.stages[i].itemsIn;
+                    out[i] += f.stages[i].itemsOut;
+                    rejected[i] += f.stages[i].primitivesRejected;
+                    added[i] += f.stages[i].primitivesAdded;
+                    avg.stages[i].recorded = avg.stages[i].recorded || f.stages[i].recorded;
+                }
+                rasterized += f.fragmentsRasterized;
+                written += f.fragmentsWritten;
+                covered += f.pixelsCovered;
+            }
+            for (unsigned int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+                avg.stages[i].durationUs = durations[i] / n;
+                avg.stages[i].itemsIn = (unsigned int) (in[i] / n + .5);
+                avg.stages[i].itemsOut = (unsigned int) (out[i] / n + .5);
+                avg.stages[i].primitivesRejected = (unsigned int) (rejected[i] / n + .5);
+                avg.stages[i].primitivesAdded = (unsigned int) (added[i] / n + .5);
+            }
+            avg.frameWidth = m_frames.back().frameWidth;
+            avg.frameHeight = m_frames.back().frameHeight;
+            avg.fragmentsRasterized = (unsigned int) (rasterized / n + .5);
+            avg.fragmentsWritten = (unsigned int) (written / n + .5);
+            avg.pixelsCovered = (unsigned int) (covered / n + .5);
+            return avg;
+        }
+
+        void clear() { m_frames.clear(); }
+
+        // trace event format, it can be opened in chrome://tracing or https://ui.perfetto.dev
+        void writeChromeTrace(std::ostream &out) const {
+            out << "{\"traceEvents\":[";
+            bool first = true;
+            unsigned int frameIdx = 0;
+            for (const auto &f : m_frames) {
+                for (const auto &s : f.stages) {
+                    if (!s.recorded)
+                        continue;
+                    out << (first ? "\n" : ",\n");
+                    first = false;
+                    out << "{\"name\":\"" << stageName(s.stage) << "\",\"cat\":\"srl\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+                        << ",\"ts\":" << s.startUs << ",\"dur\":" << s.durationUs
+                        << ",\"args\":{\"frame\":" << frameIdx << ",\"in\":" << s.itemsIn << ",\"out\":" << s.itemsOut
+                        << ",\"rejected\":" << s.primitivesRejected << ",\"added\":" << s.primitivesAdded << "}}";
+                }
+                // the fragment statistics are attached to the frame as a counter event
+                out << (first ? "\n" : ",\n");
+                first = false;
+                out << "{\"name\":\"fragments\",\"cat\":\"srl\",\"ph\":\"C\",\"pid\":0"
+                    << ",\"ts\":" << f.startUs()
+                    << ",\"args\":{\"rasterized\":" << f.fragmentsRasterized << ",\"written\":" << f.fragmentsWritten
+                    << ",\"covered\":" << f.pixelsCovered << ",\"overdraw\":" << f.overdraw() << "}}";
+                frameIdx++;
+            }
+            out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        }
+
+        bool writeChromeTrace(const std::string &path) const {
+            std::ofstream file(path);
+            if (!file.is_open())
+                return false;
+            writeChromeTrace(file);
+            return file.good();
+        }
+
+    private:
+        unsigned int maxFrames;
+        Clock::time_point origin;
+        std::deque<FrameStats> m_frames;
+        std::vector<unsigned char> m_coverage;
+    };
+}
+
+#endif //ITU_GRAPHICS_PROGRAMMING_SRL_PROFILER_H
@@ -7,8 +7,12 @@
 
 #include <vector>
 #include <algorithm>
+#include <thread>
 #include "glm/glm.hpp"
 #include "srl_types.h"
+#include "srl_gbuffer.h"
+#include "srl_visibility_buffer.h"
+#include "srl_profiler.h"
 
 
 namespace srl {
@@ -21,7 +25,7 @@ namespace srl {
                             const glm::mat4 &m,
                             const glm::mat4 &vp,
                             CustomFrameBuffer <uint32_t> &fb,
-                            CustomFrameBuffer <float> &db) {
+                            DepthBuffer &db) {
 
             // TODO exercise 7 / assignment 3
             //  to make the Software Render Library work, you have to call all methods
@@ -30,13 +34,185 @@ namespace srl {
             std::vector<vertex> _vts = vts; // copy all vertices from vts to _vts (since vts is a const)
             std::vector<fragment> _frs;    // vector that will store the fragments
             glm::mat4 modelViewProjection = vp * m; // the matrix that transform points from local space to clipping space
+            m_modelViewProjection = modelViewProjection;
 
             //  MIND THAT THE METHODS BELOW ARE NOT DECLARED/DEFINED IN THE RIGHT ORDER!
 
         }
 
+        // deferred mode, the fragments that pass the depth test are stored in the G-buffer gb,
+        // and then each visible pixel is shaded once, in parallel, and written to fb
+        void renderDeferred(const std::vector<vertex> &vts,
+                            const glm::mat4 &m,
+                            const glm::mat4 &vp,
+                            GBuffer &gb,
+                            CustomFrameBuffer <uint32_t> &fb) {
+            renderToGBuffer(vts, m, vp, gb);
+            shadeGBuffer(gb, fb);
+        }
+
+        // geometry pass of the deferred mode, it can be called for several objects before shading the G-buffer
+        void renderToGBuffer(const std::vector<vertex> &vts,
+                             const glm::mat4 &m,
+                             const glm::mat4 &vp,
+                             GBuffer &gb) {
+            std::vector<vertex> _vts = vts;
+            std::vector<fragment> _frs;
+            glm::mat4 modelViewProjection = vp * m;
+            m_modelViewProjection = modelViewProjection;
+
+            // TODO exercise 7 / assignment 3 (optional)
+            //  the same stages as in render, but the fragments are not processed (shaded) here,
+            //  they are written to the G-buffer with writeToGBuffer instead of writeToFrameBuffer
+
+        }
+
+        // shading pass of the deferred mode, the rows of tiles of the frame buffer are distributed among
+        // shadingThreads threads, so that two threads never write to the same tile
+        void shadeGBuffer(GBuffer &gb, CustomFrameBuffer <uint32_t> &fb) {
+            assert (gb.W == fb.W && gb.H == fb.H);
+            Profiler::Clock::time_point start = Profiler::Clock::now();
+            unsigned int shaded = forEachTileRow(fb.H, [&](unsigned int row) { return shadeTileRow(row, gb, fb); });
+            // the shading pass replaces processFragments, each visible pixel is one fragment in and out
+            if (profiler && !profiler->frames().empty())
+                profiler->recordStage(PipelineStage::processFragments, start, Profiler::Clock::now(), shaded, shaded, 0, 0);
+        }
+
+        // visibility buffer mode, only the closest triangle of each pixel is identified during rasterization, and the
+        // vertex attributes are interpolated later, by shadeVisibilityBuffer, for the visible pixels only
+        // every call adds an instance to vb, it is only supported by the triangle renderer
+        void renderToVisibilityBuffer(const std::vector<vertex> &vts,
+                                      const glm::mat4 &m,
+                                      const glm::mat4 &vp,
+                                      VisibilityBuffer &vb) {
+            std::vector<vertex> _vts = vts;
+            std::vector<fragment> _frs;    // stays empty, no fragments are generated in this mode
+            glm::mat4 modelViewProjection = vp * m;
+            m_modelViewProjection = modelViewProjection;
+
+            if (profiler) profiler->beginFrame(vb.W, vb.H);
+            unsigned int written = 0;
+
+            // TODO exercise 7 / assignment 3 (optional)
+            //  the same stages as in render, up to (and including) backfaceCulling
+
+            // rasterization and depth test are a single step, the fragments are never stored
+            Profiler::Clock::time_point start = Profiler::Clock::now();
+            unsigned int rasterized = 0;
+            written = rasterVisibility(vb, rasterized);
+            if (profiler) {
+                Profiler::Clock::time_point end = Profiler::Clock::now();
+                unsigned int total, rejected;
+                countPrimitives(total, rejected);
+                profiler->recordStage(PipelineStage::rasterPrimitives, start, end, total - rejected, rasterized, 0, 0);
+                // the depth test is part of the rasterization, only its counts are recorded
+                profiler->recordStage(PipelineStage::writeToFrameBuffer, end, end, rasterized, written, 0, 0);
+                // the fragments are not stored, the covered pixels are the ones where the instance is visible (all the
+                // covered pixels when the instance is the first one drawn in vb)
+                profiler->recordFragments(rasterized, written, vb.pixelsOf(vb.instancesAdded() - 1));
+            }
+        }
+
+        // reconstruct and shade the visible fragment of each pixel of vb, in parallel like shadeGBuffer
+        void shadeVisibilityBuffer(VisibilityBuffer &vb, CustomFrameBuffer <uint32_t> &fb) {
+            assert (vb.W == fb.W && vb.H == fb.H);
+            Profiler::Clock::time_point start = Profiler::Clock::now();
+            unsigned int shaded = forEachTileRow(fb.H, [&](unsigned int row) { return shadeVisibilityRow(row, vb, fb); });
+            if (profiler && !profiler->frames().empty())
+                profiler->recordStage(PipelineStage::processFragments, start, Profiler::Clock::now(), shaded, shaded, 0, 0);
+        }
+
         virtual ~Renderer(){};
+
+        // optional, when set the duration and the vertex/primitive/fragment counts of every stage are recorded in it
+        Profiler *profiler = nullptr;
+
+        // number of threads of the deferred and visibility buffer shading passes, 0 uses one thread per hardware core
+        unsigned int shadingThreads = 0;
+
+    protected:
+        // the matrix of the vertices being rendered, for the stages that work in local space (e.g. cluster culling)
+        glm::mat4 m_modelViewProjection = glm::mat4(1.0f);
+
+        // fragment shader, shared by the forward, deferred and visibility buffer modes
+        static void shadeFragment(fragment &frg) {
+            (void) frg;
+            // not necessary for now since we are not modifying the color
+            // example: uncomment this to make all fragments darker
+            // frg.col = frg.col * 0.5f;
+        }
+
     private:
+        // run rowTask(row) for every row of tiles of a buffer with the given height, on shadingThreads threads,
+        // and return the sum of the values returned by rowTask
+        template<class RowTask>
+        unsigned int forEachTileRow(unsigned int height, RowTask &&rowTask) {
+            unsigned int tileRows = (height + TILE_SIZE - 1) / TILE_SIZE;
+            unsigned int threadCount = shadingThreads ? shadingThreads : std::max(1u, std::thread::hardware_concurrency());
+            threadCount = std::min(threadCount, tileRows);
+            std::vector<unsigned int> counts(threadCount, 0);
+            auto runRows = [&](unsigned int t) {
+                // interleaved rows of tiles, so that the work is balanced even if the geometry is not
+                for (unsigned int row = t; row < tileRows; row += threadCount)
+                    counts[t] += rowTask(row);
+            };
+            std::vector<std::thread> workers;
+            for (unsigned int t = 1; t < threadCount; t++)
+                workers.emplace_back(runRows, t);
+            if (threadCount > 0)
+                runRows(0);
+            for (auto &w : workers)
+                w.join();
+
+            unsigned int total = 0;
+            for (unsigned int c : counts)
+                total += c;
+            return total;
+        }
+
+        // run one stage of the pipeline, the stage is measured only if there is a profiler attached
+        template<class Stage>
+        void profile(PipelineStage stage, const std::vector<vertex> &vts, const std::vector<fragment> &frs,
+                     const unsigned int &written, Stage &&runStage) {
+            if (!profiler) {
+                runStage();
+                return;
+            }
+            // what goes in and out of each stage, see the order in PipelineStage
+            bool primitivesToPrimitives = stage >= PipelineStage::clipPrimitives && stage <= PipelineStage::backfaceCulling;
+            StageItems itemsIn = stage <= PipelineStage::assemblePrimitives ? StageItems::vertices :
+                                 (stage <= PipelineStage::rasterPrimitives ? StageItems::primitives : StageItems::fragments);
+            StageItems itemsOut = stage == PipelineStage::processVertices ? StageItems::vertices :
+                                  (stage < PipelineStage::rasterPrimitives ? StageItems::primitives :
+                                  (stage < PipelineStage::writeToFrameBuffer ? StageItems::fragments : StageItems::fragmentsWritten));
+
+            unsigned int totalBefore, rejectedBefore, totalAfter, rejectedAfter;
+            countPrimitives(totalBefore, rejectedBefore);
+            unsigned int countIn = itemCount(itemsIn, vts, frs, written, totalBefore - rejectedBefore);
+
+            Profiler::Clock::time_point start = Profiler::Clock::now();
+            runStage();
+            Profiler::Clock::time_point end = Profiler::Clock::now();
+
+            countPrimitives(totalAfter, rejectedAfter);
+            unsigned int countOut = itemCount(itemsOut, vts, frs, written, totalAfter - rejectedAfter);
+            profiler->recordStage(stage, start, end, countIn, countOut,
+                                  primitivesToPrimitives ? rejectedAfter - rejectedBefore : 0,
+                                  primitivesToPrimitives ? totalAfter - totalBefore : 0);
+        }
+
+        static unsigned int itemCount(StageItems items, const std::vector<vertex> &vts, const std::vector<fragment> &frs,
+                                      unsigned int written, unsigned int primitives) {
+            switch (items) {
+                case StageItems::vertices: return vts.size();
+                case StageItems::primitives: return primitives;
+                case StageItems::fragments: return frs.size();
+                default: return written;
+            }
+        }
+
+        // number of primitives currently assembled, and how many of those have been rejected (clipped or culled)
+        virtual void countPrimitives(unsigned int &total, unsigned int &rejected) const = 0;
 
         virtual void assemblePrimitives(const std::vector<vertex> &vts) = 0;
         // performs the perspective division
@@ -46,6 +222,10 @@ namespace srl {
         // test if the surface of the primitive is visible to the camera
         // only used when rendering triangles.
         virtual void backfaceCulling(){};
+        // add the primitives to vb as a new instance, and write the id of the closest primitive of each pixel
+        // rasterized is set to the number of pixels covered and the number of pixels that passed the depth test is
+        // returned. Only supported when rendering triangles.
+        virtual unsigned int rasterVisibility(VisibilityBuffer &/*vb*/, unsigned int &rasterized){ rasterized = 0; return 0; };
 
         // (i.e. transforms from the clipping space to the normalized device coordinates)
         virtual void divideByW() = 0;
@@ -64,16 +244,80 @@ namespace srl {
 
         // perform fragment operations in the fragment stream (i.e. fragment shader)
         static void processFragments(std::vector<fragment>& fInOut) {
-            // fragment shader - not necessary for now since we are not modifying the color
             for (auto &frg : fInOut){
-                // example: uncomment this to make all fragments darker
-                // frg.col = frg.col * 0.5f;
+                shadeFragment(frg);
+            }
+        }
+
+        // shade the pixels of one row of tiles of the G-buffer, returns the number of pixels shaded
+        static unsigned int shadeTileRow(unsigned int row, GBuffer &gb, CustomFrameBuffer <uint32_t> &fb) {
+            unsigned int shaded = 0;
+            unsigned int y1 = std::min((row + 1) * TILE_SIZE, fb.H);
+            for (unsigned int y = row * TILE_SIZE; y < y1; y++) {
+                for (unsigned int x = 0; x < fb.W; x++) {
+                    fragment frg;
+                    if (!gb.read(x, y, frg))
+                        continue;
+                    shadeFragment(frg);
+                    fb.paintAt(x, y, Colors::toRGBA32(frg.col));
+                    shaded++;
+                }
             }
+            return shaded;
+        }
+
+        // reconstruct the fragments of one row of tiles from the triangles in the visibility buffer and shade them
+        static unsigned int shadeVisibilityRow(unsigned int row, VisibilityBuffer &vb, CustomFrameBuffer <uint32_t> &fb) {
+            unsigned int shaded = 0;
+            unsigned int y1 = std::min((row + 1) * TILE_SIZE, fb.H);
+            for (unsigned int y = row * TILE_SIZE; y < y1; y++) {
+                for (unsigned int x = 0; x < fb.W; x++) {
+                    const triangle *tri = vb.triangleAt(x, y);
+                    if (!tri)
+                        continue;
+                    fragment frg = tri->fragmentAt(glm::ivec2(x, y));
+                    shadeFragment(frg);
+                    fb.paintAt(x, y, Colors::toRGBA32(frg.col));
+                    shaded++;
+                }
+            }
+            return shaded;
+        }
+
+        // depth test the fragments and store the closest ones in the G-buffer
+        // returns the number of fragments that passed the depth test
+        static unsigned int writeToGBuffer(const std::vector<fragment> &frs, GBuffer &gb) {
+            unsigned int written = 0;
+            int width = gb.W;
+            int height = gb.H;
+            for (int i = 0, size = frs.size(); i < size; i++) {
+                glm::ivec2 pos = frs[i].pos;
+                if (pos.x < 0 || pos.x >= width || pos.y < 0 || pos.y >= height)
+                    continue;
+                // the G-buffer keeps a single surface per pixel, so it can't blend the fragments that partially
+                // cover the pixel (anti-aliased lines), they are kept only where they cover at least half of it
+                if (frs[i].coverage < .5f)
+                    continue;
+                if (gb.write(frs[i]))
+                    written++;
+            }
+            return written;
+        }
+
+        // "over" blending of the color, weighted by its alpha and by the coverage of the pixel
+        static void blendAt(CustomFrameBuffer <uint32_t> &fb, unsigned int x, unsigned int y, Colors::color col, float coverage) {
+            float alpha = glm::clamp(col.a * coverage, 0.f, 1.f);
+            Colors::color dst = Colors::fromRGBA32(fb.valueAt(x, y));
+            Colors::color res = col * alpha + dst * (1.f - alpha);
+            res.a = alpha + dst.a * (1.f - alpha);
+            fb.paintAt(x, y, Colors::toRGBA32(glm::clamp(res, 0.f, 1.f)));
         }
 
         // fragment operations and copy color to frame buffer
         // blending test and z/depth-buffer can come here
-        static void writeToFrameBuffer(const std::vector<fragment> &frs, CustomFrameBuffer <uint32_t> &fb, CustomFrameBuffer <float> &db) {
+        // returns the number of fragments that passed the depth test
+        static unsigned int writeToFrameBuffer(const std::vector<fragment> &frs, CustomFrameBuffer <uint32_t> &fb, DepthBuffer &db) {
+            unsigned int written = 0;
 			int width = fb.W;
 			int height = fb.H;
             for (int i = 0, size = frs.size(); i < size; i++) {
@@ -83,13 +327,24 @@ namespace srl {
 				if (pos.x < 0 || pos.x >= width || pos.y < 0 || pos.y >= height)
 					continue;
 
+				// fragments that partially cover the pixel (anti-aliased lines) are blended with the color in the
+				// frame buffer, they are depth tested but don't update the depth, so they don't hide what is behind them
+				if (frs[i].coverage < 1.f) {
+					if (db.depthCompare(pos.x, pos.y, frs[i].depth)) {
+						blendAt(fb, pos.x, pos.y, frs[i].col, frs[i].coverage);
+						written++;
+					}
+					continue;
+				}
+
 				// z/depth-test algorithm:
-				if (frs[i].depth < db.valueAt(pos.x, pos.y)) {
-                    // is the new fragment closer? Then update the color and the depth buffer
+				// is the new fragment closer? Then the depth buffer is updated and we update the color
+				if (db.depthTest(pos.x, pos.y, frs[i].depth)) {
 					fb.paintAt(pos.x, pos.y, Colors::toRGBA32(frs[i].col));
-                    db.paintAt(pos.x, pos.y, frs[i].depth);
+					written++;
 				}
             }
+            return written;
         }
     };
 }
@@ -12,6 +12,7 @@
 #include <glm/gtc/matrix_access.hpp>
 #include <iostream>
 #include "srl_types.h"
+#include "meshlets.h"
 
 namespace srl {
 
@@ -19,14 +20,42 @@ namespace srl {
     public:
         bool m_clipToFrustum = true;
 
+        // optional clusters of the triangles of the vertices that are rendered (see meshlets.h, the ranges count
+        // vertices, since the vertices are not indexed). The clusters outside of the view frustum or facing away from
+        // the camera are skipped when the primitives are assembled, before any of their triangles is clipped
+        const std::vector<meshlets::Meshlet> *m_clusters = nullptr;
+        // how many clusters the last render skipped
+        unsigned int m_culledClusters = 0;
+
     private:
 
         // create triangle primitives
         void assemblePrimitives(const std::vector<vertex> &vts) override {
             m_primitives.clear();
             m_primitives.reserve(vts.size()/3);
+            m_culledClusters = 0;
+
+            if (m_clusters) {
+                // the tests are done in local space, where the bounds of the clusters are
+                meshlets::Frustum frustum = meshlets::frustumFromMatrix(&m_modelViewProjection[0][0]);
+                float camera[3];
+                bool perspective = meshlets::cameraFromMatrix(&m_modelViewProjection[0][0], camera);
+                for (const meshlets::Meshlet &cluster : *m_clusters) {
+                    if (!meshlets::isVisible(cluster, frustum, perspective ? camera : nullptr)) {
+                        m_culledClusters++;
+                        continue;
+                    }
+                    assembleTriangles(vts, cluster.firstIndex, cluster.firstIndex + cluster.indexCount);
+                }
+                return;
+            }
+            assembleTriangles(vts, 0, vts.size());
+        }
 
-            for(int i = 0, size = vts.size()-2; i < size; i+=3){
+        // create the triangles of the vertices from first to end
+        void assembleTriangles(const std::vector<vertex> &vts, unsigned int first, unsigned int end) {
+            end = std::min(end, (unsigned int) vts.size());
+            for(unsigned int i = first; i + 2 < end; i+=3){
                 triangle t;
                 t.v1 = vts[i];
                 t.v2 = vts[i+1];
@@ -187,7 +216,8 @@ namespace srl {
         void rasterPrimitives(std::vector<fragment> &outFrs) override {
             outFrs.clear();
 
-            for(auto &tri : m_primitives) {
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                triangle &tri = m_primitives[i];
                 // skip this primitive if it has been rejected during clipping or culling
                 if(tri.rejected)
                     continue;
@@ -196,33 +226,65 @@ namespace srl {
                 glm::ivec2 iv1(tri.v1.pos.x + .5f, tri.v1.pos.y + .5f);
                 glm::ivec2 iv2(tri.v2.pos.x + .5f, tri.v2.pos.y + .5f);
                 glm::ivec2 iv3(tri.v3.pos.x + .5f, tri.v3.pos.y + .5f);
-                // run the rasterization and collect all pixel locations
+                // run the rasterization and create a fragment for each pixel
                 triangle_rasterizer rasterizer(iv1.x, iv1.y, iv2.x, iv2.y, iv3.x, iv3.y);
-                std::vector<glm::ivec2> pixels = rasterizer.all_pixels();
+                tri.prepareBarycentrics();
+                rasterizer.for_each_pixel([&](int x, int y){
+                    fragment frag = tri.fragmentAt(glm::ivec2(x, y));
+                    frag.primitive = i;
 
-                // create a fragment for each pixel
-                for (auto &pxl : pixels){
-                    fragment frag{};
+                    outFrs.push_back(frag);
+                });
+            }
+        }
 
-                    frag.pos = pxl;
 
-                    // barycentric coordinates (in 2D projected space)
-                    glm::vec3 bar = tri.barycentricCoordinatesAt(pxl);
-                    // hyperbolic interpolation correction
-                    float hypInterp = bar.x * tri.v1.hypInterp + bar.y * tri.v2.hypInterp + bar.z * tri.v3.hypInterp;
-                    bar = bar / hypInterp;
-                    frag.depth = bar.x * tri.v1.pos.z + bar.y * tri.v2.pos.z + bar.z * tri.v3.pos.z;
-                    frag.col = bar.x * tri.v1.col + bar.y * tri.v2.col + bar.z * tri.v3.col;
-                    frag.norm = bar.x * tri.v1.norm + bar.y * tri.v2.norm + bar.z * tri.v3.norm;
-                    frag.uv = bar.x * tri.v1.uv + bar.y * tri.v2.uv + bar.z * tri.v3.uv;
+        // rasterize the triangles without generating fragments, only the depth and the id of the closest triangle
+        // are written to the visibility buffer
+        unsigned int rasterVisibility(VisibilityBuffer &vb, unsigned int &rasterized) override {
+            unsigned int written = 0;
+            rasterized = 0;
+            // the barycentric setup is stored with the triangles, so that the shading pass can reuse it
+            for(auto &tri : m_primitives) {
+                if(!tri.rejected)
+                    tri.prepareBarycentrics();
+            }
+            unsigned int instance = vb.addInstance(m_primitives);
 
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                const triangle &tri = m_primitives[i];
+                if(tri.rejected)
+                    continue;
 
-                    outFrs.push_back(frag);
-                }
+                glm::ivec2 iv1(tri.v1.pos.x + .5f, tri.v1.pos.y + .5f);
+                glm::ivec2 iv2(tri.v2.pos.x + .5f, tri.v2.pos.y + .5f);
+                glm::ivec2 iv3(tri.v3.pos.x + .5f, tri.v3.pos.y + .5f);
+                triangle_rasterizer rasterizer(iv1.x, iv1.y, iv2.x, iv2.y, iv3.x, iv3.y);
+
+                // spans are clipped to the buffer once, instead of testing every pixel
+                rasterizer.for_each_span([&](int y, int xBegin, int xEnd){
+                    if (y < 0 || y >= (int) vb.H)
+                        return;
+                    xBegin = std::max(xBegin, 0);
+                    xEnd = std::min(xEnd, (int) vb.W);
+                    for (int x = xBegin; x < xEnd; x++) {
+                        rasterized++;
+                        if (vb.write(x, y, tri.depthAt(glm::ivec2(x, y)), instance, i))
+                            written++;
+                    }
+                });
             }
+            return written;
         }
 
 
+        void countPrimitives(unsigned int &total, unsigned int &rejected) const override {
+            total = m_primitives.size();
+            rejected = 0;
+            for (const auto &p : m_primitives)
+                rejected += p.rejected;
+        }
+
         // lists of triangle primitives, part of the class so that we avoid reallocating memory every frame
         std::vector<triangle> m_primitives;
     };
@@ -5,38 +5,247 @@
 #ifndef ITU_GRAPHICS_PROGRAMMING_SRL_TYPES_H
 #define ITU_GRAPHICS_PROGRAMMING_SRL_TYPES_H
 
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include "glm/glm.hpp"
 
 
 namespace srl {
 
+    // the frame buffers are split in square tiles of TILE_SIZE x TILE_SIZE pixels, clearing a buffer only marks its
+    // tiles as cleared, the memory of a tile is written with the clear value the first time the tile is painted
+    const unsigned int TILE_SIZE = 8;
+
+    // bookkeeping of which tiles are still in the fast cleared state
+    class TileGrid {
+    public:
+        unsigned int tilesX, tilesY;
+
+        TileGrid(unsigned int width, unsigned int height):
+                tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+                cleared(tilesX * tilesY, 1) {}
+
+        unsigned int tileAt(unsigned int x, unsigned int y) const {
+            return x / TILE_SIZE + (y / TILE_SIZE) * tilesX;
+        }
+
+        unsigned int tileCount() const { return tilesX * tilesY; }
+
+        bool isCleared(unsigned int tile) const { return cleared[tile] != 0; }
+        void markCleared(unsigned int tile, bool value) { cleared[tile] = value ? 1 : 0; }
+
+        // a single memset over the flags, instead of a loop over every pixel
+        void markAllCleared() { std::fill(cleared.begin(), cleared.end(), 1); }
+
+    private:
+        std::vector<unsigned char> cleared;
+    };
+
+
     template<class T>
     class CustomFrameBuffer {
     public:
         unsigned int W, H;
         T *buffer;
 
-        CustomFrameBuffer(unsigned int width, unsigned int height): W(width), H(height) {
-            buffer = new T[W * H];
+        CustomFrameBuffer(unsigned int width, unsigned int height): W(width), H(height), tiles(width, height) {
+            buffer = ownMemory = new T[W * H];
         }
 
-        ~CustomFrameBuffer(){delete[] buffer;} // clean our memory
+        ~CustomFrameBuffer(){delete[] ownMemory;} // clean our memory
 
+        // paint to W * H values of memory we don't own (e.g. a mapped pixel buffer, see StreamingTexture),
+        // nullptr goes back to our own memory. What the memory had is ignored, all tiles are (lazily) cleared
+        void attach(T *memory){
+            buffer = memory ? memory : ownMemory;
+            tiles.markAllCleared();
+        }
+
+        // fast clear, the buffer memory is not touched until a tile is painted or the buffer is resolved
         void clearBuffer(T value){
-            int size = W * H;
-            for (int i = 0; i < size; i++)
-                buffer[i] = value;
+            clearValue = value;
+            tiles.markAllCleared();
         }
 
         void paintAt(unsigned int x, unsigned int y, T value){
             assert (x < W && y < H); // ensure valid position, crash if not (sooo dramatic!)
+            unsigned int tile = tiles.tileAt(x, y);
+            if (tiles.isCleared(tile))
+                materializeTile(tile);
             buffer[x + y * W] = value;
         }
 
         T valueAt(unsigned int x, unsigned int y){
             assert (x < W && y < H);
+            if (tiles.isCleared(tiles.tileAt(x, y)))
+                return clearValue;
             return buffer[x + y * W];
         }
 
+        // write the clear value to the tiles that were never painted since the last clear,
+        // call it before reading the buffer memory directly (e.g. before uploading it to a texture)
+        void resolve(){
+            for (unsigned int tile = 0, count = tiles.tileCount(); tile < count; tile++){
+                if (tiles.isCleared(tile))
+                    materializeTile(tile);
+            }
+        }
+
+    private:
+        void materializeTile(unsigned int tile){
+            unsigned int x0 = (tile % tiles.tilesX) * TILE_SIZE, y0 = (tile / tiles.tilesX) * TILE_SIZE;
+            unsigned int x1 = std::min(x0 + TILE_SIZE, W), y1 = std::min(y0 + TILE_SIZE, H);
+            for (unsigned int y = y0; y < y1; y++)
+                std::fill(buffer + x0 + y * W, buffer + x1 + y * W, clearValue);
+            tiles.markCleared(tile, false);
+        }
+
+        TileGrid tiles;
+        T clearValue = T();
+        T *ownMemory;
+    };
+
+
+    // storage formats of the depth buffer, the unorm formats map the [-1, 1] depth range of the normalized device
+    // coordinates to 16 or 24 bits unsigned integers, which reduces the memory read and written by the depth test
+    enum class DepthFormat {float32, unorm24, unorm16};
+
+    class DepthBuffer {
+    public:
+        unsigned int W, H;
+        const DepthFormat format;
+
+        DepthBuffer(unsigned int width, unsigned int height, DepthFormat depthFormat = DepthFormat::float32):
+                W(width), H(height), format(depthFormat), tiles(width, height),
+                tileMin(tiles.tileCount(), 1.0f), tileMax(tiles.tileCount(), 1.0f) {
+            bytesPerTexel = format == DepthFormat::unorm16 ? 2 : (format == DepthFormat::unorm24 ? 3 : 4);
+            buffer = new unsigned char[W * H * bytesPerTexel];
+        }
+
+        ~DepthBuffer(){delete[] buffer;} // clean our memory
+
+        // fast clear, only the tile flags and the tile depth ranges are written
+        void clearBuffer(float value){
+            clearValue = quantize(value);
+            tiles.markAllCleared();
+            std::fill(tileMin.begin(), tileMin.end(), clearValue);
+            std::fill(tileMax.begin(), tileMax.end(), clearValue);
+        }
+
+        void paintAt(unsigned int x, unsigned int y, float value){
+            assert (x < W && y < H);
+            value = quantize(value);
+            unsigned int tile = tiles.tileAt(x, y);
+            if (tiles.isCleared(tile))
+                materializeTile(tile);
+            store(x + y * W, value);
+            tileMin[tile] = std::min(tileMin[tile], value);
+            tileMax[tile] = std::max(tileMax[tile], value);
+        }
+
+        float valueAt(unsigned int x, unsigned int y){
+            assert (x < W && y < H);
+            if (tiles.isCleared(tiles.tileAt(x, y)))
+                return clearValue;
+            return load(x + y * W);
+        }
+
+        // z-test (less than), the depth buffer is updated and true is returned if the fragment is closer
+        bool depthTest(unsigned int x, unsigned int y, float depth){
+            assert (x < W && y < H);
+            depth = quantize(depth);
+            unsigned int tile = tiles.tileAt(x, y);
+            // every depth stored in the tile is within [tileMin, tileMax],
+            // so we can often decide the test without reading the buffer
+            if (depth >= tileMax[tile])
+                return false;
+            if (tiles.isCleared(tile))
+                materializeTile(tile);
+            else if (depth >= tileMin[tile] && depth >= load(x + y * W))
+                return false;
+            store(x + y * W, depth);
+            tileMin[tile] = std::min(tileMin[tile], depth);
+            return true;
+        }
+
+        // z-test (less than) without updating the depth buffer, used by the fragments that are blended
+        bool depthCompare(unsigned int x, unsigned int y, float depth){
+            assert (x < W && y < H);
+            depth = quantize(depth);
+            if (depth >= tileMax[tiles.tileAt(x, y)])
+                return false;
+            return depth < valueAt(x, y);
+        }
+
+        // conservative range of the depth values stored in the tile that contains pixel (x, y)
+        glm::vec2 tileRangeAt(unsigned int x, unsigned int y) const {
+            unsigned int tile = tiles.tileAt(x, y);
+            return glm::vec2(tileMin[tile], tileMax[tile]);
+        }
+
+    private:
+        // round the depth to the precision of the storage format, so that all comparisons match the stored values
+        float quantize(float depth) const {
+            return format == DepthFormat::float32 ? depth : decode(encode(depth));
+        }
+
+        uint32_t maxUnorm() const {
+            return format == DepthFormat::unorm16 ? 0xFFFFu : 0xFFFFFFu;
+        }
+
+        uint32_t encode(float depth) const {
+            // double precision, a float can't hold the 24 bits values plus the rounding offset
+            double unorm = glm::clamp(double(depth) * .5 + .5, 0.0, 1.0);
+            return uint32_t(unorm * double(maxUnorm()) + .5);
+        }
+
+        float decode(uint32_t value) const {
+            return float(double(value) / double(maxUnorm()) * 2.0 - 1.0);
+        }
+
+        void store(unsigned int idx, float depth){
+            unsigned char *texel = buffer + idx * bytesPerTexel;
+            if (format == DepthFormat::float32) {
+                std::memcpy(texel, &depth, sizeof(float));
+                return;
+            }
+            uint32_t value = encode(depth);
+            for (unsigned int i = 0; i < bytesPerTexel; i++)
+                texel[i] = (unsigned char)(value >> (8 * i));
+        }
+
+        float load(unsigned int idx) const {
+            const unsigned char *texel = buffer + idx * bytesPerTexel;
+            if (format == DepthFormat::float32) {
+                float depth;
+                std::memcpy(&depth, texel, sizeof(float));
+                return depth;
+            }
+            uint32_t value = 0;
+            for (unsigned int i = 0; i < bytesPerTexel; i++)
+                value |= uint32_t(texel[i]) << (8 * i);
+            return decode(value);
+        }
+
+        void materializeTile(unsigned int tile){
+            unsigned int x0 = (tile % tiles.tilesX) * TILE_SIZE, y0 = (tile / tiles.tilesX) * TILE_SIZE;
+            unsigned int x1 = std::min(x0 + TILE_SIZE, W), y1 = std::min(y0 + TILE_SIZE, H);
+            for (unsigned int y = y0; y < y1; y++)
+                for (unsigned int x = x0; x < x1; x++)
+                    store(x + y * W, clearValue);
+            tiles.markCleared(tile, false);
+        }
+
+        unsigned char *buffer;
+        unsigned int bytesPerTexel;
+        TileGrid tiles;
+        float clearValue = 1.0f;
+        // per tile depth range, both conservative: every depth stored in the tile is within [tileMin, tileMax], but
+        // neither has to be reached (paintAt() can overwrite the closest or the farthest depth of the tile)
+        std::vector<float> tileMin, tileMax;
     };
 
     namespace Colors {
@@ -59,6 +268,13 @@ namespace srl {
             return (uint32_t(255 * c.r)) + (uint32_t(255 * c.g) << 8) +
                    (uint32_t(255 * c.b) << 16) + (uint32_t(255 * c.a) << 24);
         }
+
+        // inverse of toRGBA32, the value is placed at the center of the 8 bits interval
+        // so that an unmodified color is converted back to the same 32 bits value
+        inline color fromRGBA32(std::uint32_t value) {
+            return color((value & 0xFF) + .5f, ((value >> 8) & 0xFF) + .5f,
+                         ((value >> 16) & 0xFF) + .5f, ((value >> 24) & 0xFF) + .5f) / 255.f;
+        }
     }
 
     // VERTEX AND FRAGMENT
@@ -95,6 +311,10 @@ namespace srl {
         glm::ivec2 pos;
         glm::vec2 uv;
         float depth;
+        // index of the primitive that generated the fragment, in the primitive list of the renderer
+        unsigned int primitive;
+        // fraction of the pixel covered by the primitive, fragments with partial coverage are blended
+        float coverage = 1.f;
     };
 
 
@@ -121,18 +341,57 @@ namespace srl {
         glm::mat2x2 inverse = glm::mat2x2(1.0f);
         bool inverseReady = false;
 
+        // compute the inverse used by barycentricCoordinatesAt, call it once the window positions are final
+        void prepareBarycentrics(){
+            inverse[0] = glm::vec2(v1.pos.x - v3.pos.x, v1.pos.y - v3.pos.y);
+            inverse[1] = glm::vec2(v2.pos.x - v3.pos.x, v2.pos.y - v3.pos.y);
+            inverse = glm::inverse(inverse);
+            inverseReady = true;
+        }
+
         glm::vec3 barycentricCoordinatesAt(glm::vec2 at){
-            if(!inverseReady){
-                // we only need to compute this inverse once per triangle
-                inverse[0] = glm::vec2(v1.pos.x - v3.pos.x, v1.pos.y - v3.pos.y);
-                inverse[1] = glm::vec2(v2.pos.x - v3.pos.x, v2.pos.y - v3.pos.y);
-                inverse = glm::inverse(inverse);
-            }
+            // we only need to compute this inverse once per triangle
+            if(!inverseReady)
+                prepareBarycentrics();
+            return static_cast<const triangle&>(*this).barycentricCoordinatesAt(at);
+        }
+
+        // it does not modify the triangle, so it is safe to call from several threads after prepareBarycentrics
+        glm::vec3 barycentricCoordinatesAt(glm::vec2 at) const {
+            assert(inverseReady);
             glm::vec3 barycentric = glm::vec3(inverse * (at - glm::vec2(v3.pos.x, v3.pos.y)), 0);
             barycentric.z = 1.0f - barycentric.x - barycentric.y;
 
             return barycentric;
         }
+
+        // perspective correct depth at pixel location pxl
+        float depthAt(glm::ivec2 pxl) const {
+            glm::vec3 bar = barycentricCoordinatesAt(pxl);
+            // hyperbolic interpolation correction
+            float hypInterp = bar.x * v1.hypInterp + bar.y * v2.hypInterp + bar.z * v3.hypInterp;
+            bar = bar / hypInterp;
+            return bar.x * v1.pos.z + bar.y * v2.pos.z + bar.z * v3.pos.z;
+        }
+
+        // fragment at pixel location pxl, with the perspective correct interpolation of the vertex attributes
+        fragment fragmentAt(glm::ivec2 pxl) const {
+            fragment frag{};
+
+            frag.pos = pxl;
+
+            // barycentric coordinates (in 2D projected space)
+            glm::vec3 bar = barycentricCoordinatesAt(pxl);
+            // hyperbolic interpolation correction
+            float hypInterp = bar.x * v1.hypInterp + bar.y * v2.hypInterp + bar.z * v3.hypInterp;
+            bar = bar / hypInterp;
+            frag.depth = bar.x * v1.pos.z + bar.y * v2.pos.z + bar.z * v3.pos.z;
+            frag.col = bar.x * v1.col + bar.y * v2.col + bar.z * v3.col;
+            frag.norm = bar.x * v1.norm + bar.y * v2.norm + bar.z * v3.norm;
+            frag.uv = bar.x * v1.uv + bar.y * v2.uv + bar.z * v3.uv;
+
+            return frag;
+        }
     };
 }
 
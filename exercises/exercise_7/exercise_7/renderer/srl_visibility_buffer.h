@@ -0,0 +1,83 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_SRL_VISIBILITY_BUFFER_H
+#define ITU_GRAPHICS_PROGRAMMING_SRL_VISIBILITY_BUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include "srl_types.h"
+
+namespace srl {
+
+    // visibility buffer mode (see Renderer::renderToVisibilityBuffer)
+    // rasterization only writes the depth and a 32 bits id per pixel, the id identifies the closest triangle and the
+    // instance (draw call) it belongs to. The triangles of each instance are kept, in window coordinates, so that the
+    // barycentric coordinates and the vertex attributes can be reconstructed when the buffer is shaded
+    class VisibilityBuffer {
+    public:
+        // the id of a pixel is (instance << TRIANGLE_BITS) | triangle
+        static const unsigned int INSTANCE_BITS = 8;
+        static const unsigned int TRIANGLE_BITS = 32 - INSTANCE_BITS;
+        static const uint32_t MAX_INSTANCES = 1u << INSTANCE_BITS;
+        static const uint32_t TRIANGLE_MASK = (1u << TRIANGLE_BITS) - 1;
+        // id of the pixels that were not covered by any triangle
+        static const uint32_t EMPTY = 0xFFFFFFFF;
+
+        unsigned int W, H;
+        DepthBuffer depth;
+        CustomFrameBuffer<uint32_t> ids;
+
+        VisibilityBuffer(unsigned int width, unsigned int height, DepthFormat depthFormat = DepthFormat::float32):
+                W(width), H(height), depth(width, height, depthFormat), ids(width, height) {}
+
+        // the triangles of the previous instances are dropped, but their memory is kept for the next frame
+        void clearBuffer(float clearDepth = 1.0f){
+            depth.clearBuffer(clearDepth);
+            ids.clearBuffer(EMPTY);
+            instanceCount = 0;
+        }
+
+        // store the triangles of a new instance, the id of the triangle is its index in tris
+        unsigned int addInstance(const std::vector<triangle> &tris){
+            assert (instanceCount < MAX_INSTANCES && tris.size() < TRIANGLE_MASK);
+            if (instanceCount == instances.size())
+                instances.emplace_back();
+            instances[instanceCount] = tris;
+            return instanceCount++;
+        }
+
+        // depth test and store the id if the triangle is the closest one so far
+        bool write(unsigned int x, unsigned int y, float fragDepth, uint32_t instance, uint32_t tri){
+            if (!depth.depthTest(x, y, fragDepth))
+                return false;
+            ids.paintAt(x, y, (instance << TRIANGLE_BITS) | tri);
+            return true;
+        }
+
+        // the closest triangle at pixel (x, y), nullptr if no triangle covers the pixel
+        const triangle* triangleAt(unsigned int x, unsigned int y){
+            uint32_t id = ids.valueAt(x, y);
+            if (id == EMPTY)
+                return nullptr;
+            return &instances[id >> TRIANGLE_BITS][id & TRIANGLE_MASK];
+        }
+
+        unsigned int instancesAdded() const { return instanceCount; }
+
+        // number of pixels where the closest triangle belongs to instance
+        unsigned int pixelsOf(uint32_t instance){
+            unsigned int count = 0;
+            for (unsigned int y = 0; y < H; y++) {
+                for (unsigned int x = 0; x < W; x++) {
+                    uint32_t id = ids.valueAt(x, y);
+                    count += id != EMPTY && id >> TRIANGLE_BITS == instance;
+                }
+            }
+            return count;
+        }
+
+    private:
+        std::vector<std::vector<triangle> > instances;
+        unsigned int instanceCount = 0;
+    };
+}
+
+#endif //ITU_GRAPHICS_PROGRAMMING_SRL_VISIBILITY_BUFFER_H
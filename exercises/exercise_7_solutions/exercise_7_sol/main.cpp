@@ -3,12 +3,16 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
+#include <mutex>
+#include <atomic>
 
 #include "srl_point_renderer.h"
 #include "srl_line_renderer.h"
 #include "srl_triangle_renderer.h"
 #include "primitives.h"
+#include "streaming_texture.h"
+#include "frame_pacer.h"
+#include "frame_pipeline.h"
 
 // glfw callbacks
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -33,6 +37,31 @@ srl::PointRenderer pRenderer;
 srl::LineRenderer lRenderer;
 srl::TriangleRenderer tRenderer;
 srl::Renderer* srlRenderer = &tRenderer;
+srl::Profiler profiler;
+// render every loopInterval seconds
+const float loopInterval = 1.f/60.f;
+FramePacer pacer(loopInterval);
+void printProfile();
+void printFrameTimes();
+// forward shades every fragment, deferred and visibility shade each visible pixel once, after the depth test
+enum class ShadingMode {forward, deferred, visibility};
+ShadingMode shadingMode = ShadingMode::forward;
+bool antialiasedLines = false;
+// the triangle renderer skips the faces of the cube that are outside of the view or facing away, before clipping
+bool clusterCulling = true;
+
+// the frames are rendered on another thread, which reads a copy of the controls taken by the input thread,
+// the copy is protected by the mutex. The renderers and the profiler are only used by the render thread
+struct FrameControls {
+    glm::mat4 model;
+    srl::Renderer* renderer;
+    ShadingMode shadingMode;
+    bool antialiasedLines;
+    bool clusterCulling;
+};
+FrameControls controls;
+std::mutex controlsMutex;
+std::atomic<bool> profileRequested(false);
 
 int main()
 {
@@ -90,6 +119,17 @@ int main()
         vtsCube.push_back(v);
     }
 
+    // every face of the cube (two triangles, 6 vertices) is a cluster, with a bounding sphere and a normal cone
+    std::vector<std::uint32_t> cubeIndices(vtsCube.size());
+    for (unsigned int i = 0; i < cubeIndices.size(); i++)
+        cubeIndices[i] = i;
+    std::vector<meshlets::Meshlet> cubeFaces;
+    for (std::uint32_t i = 0; i + 6 <= vtsCube.size(); i += 6) {
+        meshlets::Meshlet face = {i, 6};
+        meshlets::computeBounds(face, cubeIndices.data(), &vtsCube[0].pos.x, sizeof(srl::vertex));
+        cubeFaces.push_back(face);
+    }
+
 
     // camera
     // ------
@@ -101,87 +141,108 @@ int main()
                                               glm::vec3(.0f, 1.f, .0f));
 
 
-    // initialize our custom frame buffer
-    // ----------------------------------
-    // every frame we will: draw to it, upload it to a texture, and copy the texture to the window frame buffer.
-    srl::CustomFrameBuffer<std::uint32_t> customBuffer(max_W, max_H);
-    srl::CustomFrameBuffer<float> customZBuffer(max_W, max_H);
-
-
-    // initialize texture we will use to upload our buffer to GPU
-    // ----------------------------------------------------------
-    unsigned int bufferTexture;
+    // initialize our custom frame buffers
+    // -----------------------------------
+    // every frame we will: draw to one of them, upload it to a texture, and copy the texture to the window frame buffer.
+    // The frame buffers are drawn by a render thread, while this thread uploads and shows the previous one
+    FramePipeline<srl::CustomFrameBuffer<std::uint32_t>> pipeline(3, max_W, max_H);
+    srl::DepthBuffer customZBuffer(max_W, max_H); // pass srl::DepthFormat::unorm16 or unorm24 for a compact z-buffer
+    srl::GBuffer customGBuffer(max_W, max_H); // used instead of the z-buffer in the deferred mode
+    srl::VisibilityBuffer customVisBuffer(max_W, max_H); // used instead of the z-buffer in the visibility buffer mode
 
-    glGenTextures(1, &bufferTexture);
-    glBindTexture(GL_TEXTURE_2D, bufferTexture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    // initialize openGL frame buffer object
-    // ------------------------------------
-    // this helps handling writing the texture content into the window frame buffer
-    GLuint oglFrameBuffer = 0;
-    glGenFramebuffers(1, &oglFrameBuffer);
+    // initialize the texture we will use to upload our buffer to GPU
+    // ---------------------------------------------------------------
+    // the texture is allocated once, and the custom buffers paint directly in the memory of the pixel buffers that
+    // are uploaded next, so the GPU uploads a frame while we render the next ones
+    StreamingTexture bufferTexture(max_W, max_H, pipeline.frameCount() + 1);
 
     // render loop
     // -----------
-    // render every loopInterval seconds
-    float loopInterval = 1.f/60.f;
-    auto begin = std::chrono::high_resolution_clock::now();
-
     std::cout << "Key mapping:" << std::endl;
     std::cout << "1 - use point renderer" << std::endl;
     std::cout << "2 - use line renderer" << std::endl;
     std::cout << "3 - use triangle renderer" << std::endl;
+    std::cout << "D - toggle deferred shading" << std::endl;
+    std::cout << "V - toggle visibility buffer (triangle renderer only)" << std::endl;
+    std::cout << "C - toggle cluster culling (triangle renderer only)" << std::endl;
+    std::cout << "P - print the pipeline profile and save it to srl_trace.json" << std::endl;
+    std::cout << "S - toggle vsync (the swap waits for the display instead of the frame pacer)" << std::endl;
+
+    pRenderer.profiler = &profiler;
+    lRenderer.profiler = &profiler;
+    tRenderer.profiler = &profiler;
+
+    // render to our custom frame buffers, on the render thread
+    // --------------------------------------------------------
+    controls = FrameControls{storedRotation, srlRenderer, shadingMode, antialiasedLines, clusterCulling};
+    pipeline.start([&](srl::CustomFrameBuffer<std::uint32_t> &customBuffer){
+        FrameControls frame;
+        {
+            std::lock_guard<std::mutex> lock(controlsMutex);
+            frame = controls;
+        }
+        lRenderer.antialiasing = frame.antialiasedLines;
+        tRenderer.m_clusters = frame.clusterCulling ? &cubeFaces : nullptr;
+        customBuffer.clearBuffer(srl::Colors::toRGBA32(srl::Colors::black));
+        if (frame.shadingMode == ShadingMode::deferred) {
+            customGBuffer.clearBuffer(1.0f);
+            frame.renderer->renderDeferred(vtsCube, frame.model, viewProj, customGBuffer, customBuffer);
+        }
+        else if (frame.shadingMode == ShadingMode::visibility && frame.renderer == &tRenderer) {
+            customVisBuffer.clearBuffer(1.0f);
+            frame.renderer->renderToVisibilityBuffer(vtsCube, frame.model, viewProj, customVisBuffer);
+            frame.renderer->shadeVisibilityBuffer(customVisBuffer, customBuffer);
+        }
+        else {
+            customZBuffer.clearBuffer(1.0f);
+            frame.renderer->render(vtsCube, frame.model, viewProj, customBuffer, customZBuffer);
+        }
+        // write the clear color to the tiles we have not painted
+        customBuffer.resolve();
+
+        if (profileRequested.exchange(false))
+            printProfile();
+    }, [&](srl::CustomFrameBuffer<std::uint32_t> &customBuffer){
+        // before the render thread gets it, the frame buffer is pointed to the memory of the next upload
+        customBuffer.attach(static_cast<std::uint32_t*>(bufferTexture.beginFrame()));
+    });
+    float lastFrameTime = 0.f;
 
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
-
-
-        // render to our custom frame buffer
-        // ---------------------------------
-        customBuffer.clearBuffer(srl::Colors::toRGBA32(srl::Colors::black));
-        customZBuffer.clearBuffer(1.0f);
-
-        srlRenderer->render(vtsCube, trackballRotation() * storedRotation, viewProj, customBuffer, customZBuffer);
+        float currentTime = pacer.beginFrame();
+        {
+            std::lock_guard<std::mutex> lock(controlsMutex);
+            controls = FrameControls{trackballRotation() * storedRotation, srlRenderer, shadingMode, antialiasedLines,
+                                     clusterCulling};
+        }
 
         // show our rendered image
         // -----------------------
-        // upload the custom color buffer to the GPU using the texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, bufferTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, max_W, max_H, 0, GL_RGBA, GL_UNSIGNED_BYTE, customBuffer.buffer);
-
-        // set opengl frame buffer object to read from our texture, we will copy from it
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, oglFrameBuffer);
-        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bufferTexture, 0);
-
-        // bind the window frame buffer, where we want to copy the contents of the texture to
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        // if the render thread has finished a frame, upload it to the GPU using the texture,
+        // and give the frame buffer back to the render thread
+        if (srl::CustomFrameBuffer<std::uint32_t> *customBuffer = pipeline.acquire()) {
+            bufferTexture.endFrame();
+            pipeline.release(customBuffer);
+            glfwSetWindowTitle(window, ("Exercise 9 - FPS: " + std::to_string(int(1.0f/(currentTime - lastFrameTime) + .5f))).c_str());
+            lastFrameTime = currentTime;
+        }
 
-        // copy from the frame buffer object (access the texture) to the window frame buffer
+        // copy the texture to the window frame buffer
         int size_W, size_H;
         glfwGetFramebufferSize(window, &size_W, &size_H);
-        glBlitFramebuffer(0,0, max_W, max_H, 0, 0, size_W, size_H, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        bufferTexture.blit(size_W, size_H);
 
         // display frame buffer
         glfwSwapBuffers(window);
         glfwPollEvents();
 
-        // control render loop frequency (busy wait)
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
-        glfwSetWindowTitle(window, ("Exercise 9 - FPS: " + std::to_string(int(1.0f/elapsed.count() + .5f))).c_str());
+        // control render loop frequency
+        pacer.endFrame();
     }
+    pipeline.stop();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -268,6 +329,55 @@ void key_input_callback(GLFWwindow* window, int button, int other,int action, in
     if (button == GLFW_KEY_3 && action == GLFW_PRESS){
         srlRenderer = &tRenderer;
     }
+    if (button == GLFW_KEY_D && action == GLFW_PRESS){
+        shadingMode = shadingMode == ShadingMode::deferred ? ShadingMode::forward : ShadingMode::deferred;
+        std::cout << (shadingMode == ShadingMode::deferred ? "deferred" : "forward") << " shading" << std::endl;
+    }
+    if (button == GLFW_KEY_V && action == GLFW_PRESS){
+        shadingMode = shadingMode == ShadingMode::visibility ? ShadingMode::forward : ShadingMode::visibility;
+        std::cout << (shadingMode == ShadingMode::visibility ? "visibility buffer" : "forward") << " shading" << std::endl;
+    }
+    if (button == GLFW_KEY_A && action == GLFW_PRESS){
+        antialiasedLines = !antialiasedLines;
+        std::cout << "anti-aliased lines " << (antialiasedLines ? "on" : "off") << std::endl;
+    }
+    if (button == GLFW_KEY_C && action == GLFW_PRESS){
+        clusterCulling = !clusterCulling;
+        std::cout << "cluster culling " << (clusterCulling ? "on" : "off") << std::endl;
+    }
+    if (button == GLFW_KEY_P && action == GLFW_PRESS){
+        // the profiler belongs to the render thread, it prints the profile after its current frame
+        profileRequested = true;
+        printFrameTimes();
+    }
+    if (button == GLFW_KEY_S && action == GLFW_PRESS){
+        // the callback runs on the main thread, where the context of the window is current
+        pacer.setVsync(!pacer.vsync());
+        std::cout << "vsync " << (pacer.vsync() ? "on" : "off") << std::endl;
+    }
+}
+
+void printProfile(){
+    srl::FrameStats avg = profiler.average();
+    std::cout << "average of the last " << profiler.frames().size() << " frames:" << std::endl;
+    for (const auto &stage : avg.stages)
+        std::cout << "  " << srl::stageName(stage.stage) << ": " << stage.durationUs << " us, "
+                  << stage.itemsIn << " in, " << stage.itemsOut << " out" << std::endl;
+    std::cout << "  clipped: " << avg.primitivesClipped() << ", culled: " << avg.primitivesCulled()
+              << ", fragments: " << avg.fragmentsRasterized << ", depth rejected: " << avg.fragmentsRejected()
+              << ", overdraw: " << avg.overdraw() << std::endl;
+    std::cout << "  clusters skipped in the last frame: " << tRenderer.m_culledClusters << std::endl;
+
+    if (profiler.writeChromeTrace("srl_trace.json"))
+        std::cout << "trace saved to srl_trace.json (open it in chrome://tracing)" << std::endl;
+    profiler.clear();
+}
+
+void printFrameTimes(){
+    FramePacer::Stats pacing = pacer.stats();
+    std::cout << "frame time of the last " << pacing.frames << " frames: " << pacing.mean * 1000.f << " ms mean, "
+              << pacing.p99 * 1000.f << " ms p99, " << pacing.jitter * 1000.f << " ms jitter"
+              << (pacer.vsync() ? " (vsync)" : "") << std::endl;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -71,6 +71,13 @@ public:
      */
     int y() const;
 
+    /**
+     * Same as x() and y(), but without the validity check (and the exception), for the inner loops of the rasterizers
+     * It is only valid to call these functions if "more_fragments()" returns true
+     */
+    int x_unchecked() const { return this->x_current; }
+    int y_unchecked() const { return this->y_current; }
+
 private:
     /**
      * Initializes an edge, so it is ready to be scanconverted
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/integer.hpp>
@@ -58,6 +59,22 @@ public:
      */
     std::vector<glm::ivec2> all_pixels();
 
+    /**
+     * Calls pixel(x, y) for each pixel of the line, in the same order as all_pixels
+     * Like all_pixels, it consumes the remaining fragments of the rasterizer, but no memory is allocated and
+     * the inner loop is selected once per line, instead of calling it through the innerloop pointer for each pixel
+     * \param pixel - a callable with signature void(int x, int y)
+     */
+    template<class PixelCallback>
+    void for_each_pixel(PixelCallback &&pixel);
+
+    /**
+     * Calls span(y, x_begin, x_end) for each horizontal run of pixels of the line (x_end is exclusive)
+     * x-dominant lines have runs of several pixels per scanline, y-dominant lines have runs of one pixel
+     * \param span - a callable with signature void(int y, int x_begin, int x_end)
+     */
+    template<class SpanCallback>
+    void for_each_span(SpanCallback &&span);
 
 
     /**
@@ -145,4 +162,69 @@ private:
     void (LineRasterizer::*innerloop)();
 };
 
+template<class PixelCallback>
+void LineRasterizer::for_each_pixel(PixelCallback &&pixel)
+{
+    if (!this->valid)
+        return;
+    // the same steps as x_dominant_innerloop and y_dominant_innerloop, with the state in local variables
+    int x = this->x_current;
+    int y = this->y_current;
+    int d = this->d;
+    if (this->innerloop == &LineRasterizer::x_dominant_innerloop) {
+        for (;;) {
+            pixel(x, y);
+            if (x == this->x_stop)
+                break;
+            if (d > 0 || (d == 0 && this->left_right)) {
+                y += this->y_step;
+                d -= this->abs_2dx;
+            }
+            x += this->x_step;
+            d += this->abs_2dy;
+        }
+    }
+    else {
+        for (;;) {
+            pixel(x, y);
+            if (y == this->y_stop)
+                break;
+            if (d > 0 || (d == 0 && this->left_right)) {
+                x += this->x_step;
+                d -= this->abs_2dy;
+            }
+            y += this->y_step;
+            d += this->abs_2dx;
+        }
+    }
+    this->x_current = x;
+    this->y_current = y;
+    this->d = d;
+    this->valid = false;
+}
+
+template<class SpanCallback>
+void LineRasterizer::for_each_span(SpanCallback &&span)
+{
+    if (!this->valid)
+        return;
+    bool first = true;
+    int run_y = 0, run_begin = 0, run_end = 0;
+    this->for_each_pixel([&](int x, int y) {
+        // consecutive pixels in the same scanline extend the current run
+        if (!first && y == run_y && (x == run_end || x == run_begin - 1)) {
+            run_begin = std::min(run_begin, x);
+            run_end = std::max(run_end, x + 1);
+            return;
+        }
+        if (!first)
+            span(run_y, run_begin, run_end);
+        first = false;
+        run_y = y;
+        run_begin = x;
+        run_end = x + 1;
+    });
+    span(run_y, run_begin, run_end);
+}
+
 #endif
@@ -40,6 +40,22 @@ public:
      */
     std::vector<glm::ivec2> all_pixels();
 
+    /**
+     * Calls span(y, x_begin, x_end) for each horizontal span of pixels inside the triangle, from the bottom to the top
+     * x_end is exclusive. Like all_pixels, it consumes the remaining fragments of the rasterizer,
+     * but no memory is allocated and the pixels are not checked one by one
+     * \param span - a callable with signature void(int y, int x_begin, int x_end)
+     */
+    template<class SpanCallback>
+    void for_each_span(SpanCallback &&span);
+
+    /**
+     * Calls pixel(x, y) for each pixel inside the triangle, in the same order as all_pixels
+     * \param pixel - a callable with signature void(int x, int y)
+     */
+    template<class PixelCallback>
+    void for_each_pixel(PixelCallback &&pixel);
+
     /**
      * Checks if there are fragments/pixels inside the triangle ready for use
      * \return true if there are more fragments in the triangle, else false is returned
@@ -81,6 +97,11 @@ private:
      */
     void initialize_triangle(int x1, int y1, int x2, int y2, int x3, int y3);
 
+    /**
+     * Moves to the first pixel of the next scanline that has pixels inside the triangle
+     */
+    void next_scanline();
+
 
     /**
      * Computes the index of the lower left vertex in the array ivertex
@@ -127,4 +148,22 @@ private:
     bool valid;
 };
 
+template<class SpanCallback>
+void triangle_rasterizer::for_each_span(SpanCallback &&span)
+{
+    while (this->valid) {
+        span(this->y_current, this->x_current, this->x_stop + 1);
+        this->next_scanline();
+    }
+}
+
+template<class PixelCallback>
+void triangle_rasterizer::for_each_pixel(PixelCallback &&pixel)
+{
+    this->for_each_span([&pixel](int y, int x_begin, int x_end) {
+        for (int x = x_begin; x < x_end; ++x)
+            pixel(x, y);
+    });
+}
+
 #endif
@@ -9,10 +9,18 @@
 #include <glm/gtx/transform.hpp>
 #include "srl_renderer.h"
 #include "rasterizer/linerasterizer.h"
+#include "rasterizer/aalinerasterizer.h"
 #include "srl_types.h"
 
 namespace srl {
     class LineRenderer : public Renderer {
+    public:
+        // anti-aliased lines, the fragments have the fraction of the pixel covered by the line and are blended
+        // into the frame buffer, the width (in pixels) and the caps are only used by anti-aliased lines
+        bool antialiasing = false;
+        float lineWidth = 1.f;
+        AALineRasterizer::Cap lineCap = AALineRasterizer::Cap::butt;
+
     private:
         // create line primitives
         void assemblePrimitives(const std::vector<vertex> &vts) {
@@ -111,37 +119,76 @@ namespace srl {
         // rasterization (generate fragments)
         void rasterPrimitives(std::vector<fragment> &outFrs) {
             outFrs.clear();
+            if (antialiasing) {
+                rasterAntialiased(outFrs);
+                return;
+            }
 
-            for(auto &line : m_primitives) {
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                line &line = m_primitives[i];
                 // is current primitive visible?
                 if(line.rejected)
                     continue;
 
                 // vertices of the line rounded to the closest integer (aka pixel location)
-                glm::ivec2 iv1(line.v1.pos.x + .5f, line.v1.pos.y + .5f);
-                glm::ivec2 iv2(line.v2.pos.x + .5f, line.v2.pos.y + .5f);
-                // run the rasterization and collect all pixel locations
+                glm::ivec2 iv1 = pixelLocation(line.v1);
+                glm::ivec2 iv2 = pixelLocation(line.v2);
+                // run the rasterization and create a fragment for each pixel
                 LineRasterizer rasterizer(iv1.x, iv1.y, iv2.x, iv2.y);
-                std::vector<glm::ivec2> pixels = rasterizer.all_pixels();
-
-                // create a fragment for each pixel in the rasterization
-                for (auto &pxl : pixels){
-                    fragment frag;
-
-                    frag.pos = pxl;
-                    // screen space interpolation factor
-                    float interp = glm::length(glm::vec2(pxl - iv1)) / glm::length(glm::vec2(iv2 - iv1));
-                    // hyperbolic interpolation correction
-                    float hypInterp = interp * line.v2.hypInterp + (1.f-interp) * line.v1.hypInterp;
-                    // interpolate and then apply the correction
-                    frag.depth = (interp * line.v2.pos.z + (1.f-interp) * line.v1.pos.z) / hypInterp;
-                    frag.col = (interp * line.v2.col + (1.f-interp) *line.v1.col) / hypInterp;
+                rasterizer.for_each_pixel([&](int x, int y){
+                    glm::ivec2 pxl(x, y);
+                    outFrs.push_back(lineFragment(line, i, pxl, screenInterpolation(iv1, iv2, pxl)));
+                });
+            }
+        }
 
+        // the vertices are not rounded, and every pixel touched by the line gets a fragment with its coverage
+        void rasterAntialiased(std::vector<fragment> &outFrs) {
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                line &line = m_primitives[i];
+                if(line.rejected)
+                    continue;
+                AALineRasterizer rasterizer(line.v1.pos.x, line.v1.pos.y, line.v2.pos.x, line.v2.pos.y,
+                                            lineWidth, lineCap);
+                rasterizer.for_each_pixel([&](int x, int y, float coverage, float t){
+                    fragment frag = lineFragment(line, i, glm::ivec2(x, y), t);
+                    frag.coverage = coverage;
                     outFrs.push_back(frag);
-                }
+                });
             }
         }
 
+        // vertex position rounded to the closest integer (aka pixel location)
+        static glm::ivec2 pixelLocation(const vertex &v) {
+            return glm::ivec2(v.pos.x + .5f, v.pos.y + .5f);
+        }
+
+        // screen space interpolation factor of pixel pxl, in a line from iv1 to iv2
+        static float screenInterpolation(glm::ivec2 iv1, glm::ivec2 iv2, glm::ivec2 pxl) {
+            return glm::length(glm::vec2(pxl - iv1)) / glm::length(glm::vec2(iv2 - iv1));
+        }
+
+        // fragment of pixel pxl of line i, interp is the screen space interpolation factor of the pixel
+        static fragment lineFragment(const line &line, unsigned int i, glm::ivec2 pxl, float interp) {
+            fragment frag{};
+
+            frag.pos = pxl;
+            frag.primitive = i;
+            // hyperbolic interpolation correction
+            float hypInterp = interp * line.v2.hypInterp + (1.f-interp) * line.v1.hypInterp;
+            // interpolate and then apply the correction
+            frag.depth = (interp * line.v2.pos.z + (1.f-interp) * line.v1.pos.z) / hypInterp;
+            frag.col = (interp * line.v2.col + (1.f-interp) *line.v1.col) / hypInterp;
+            return frag;
+        }
+
+        void countPrimitives(unsigned int &total, unsigned int &rejected) const override {
+            total = m_primitives.size();
+            rejected = 0;
+            for (const auto &p : m_primitives)
+                rejected += p.rejected;
+        }
+
         // lists of line primitives.
         std::vector<line> m_primitives;
         bool wireframe = true;
@@ -78,13 +78,15 @@ namespace srl {
         void rasterPrimitives(std::vector<fragment> &outFrs) override {
             outFrs.clear();
 
-            for(auto &p : m_primitives) {
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                point &p = m_primitives[i];
                 // is current primitive visible?
                 if(p.rejected)
                     continue;
 
                 fragment frag{};
                 frag.pos = glm::ivec2(p.v1.pos.x + .5f, p.v1.pos.y + .5f);
+                frag.primitive = i;
                 frag.depth = p.v1.pos.z;
                 frag.col = p.v1.col;
                 frag.norm = p.v1.norm;
@@ -95,6 +97,13 @@ namespace srl {
         }
 
 
+        void countPrimitives(unsigned int &total, unsigned int &rejected) const override {
+            total = m_primitives.size();
+            rejected = 0;
+            for (const auto &p : m_primitives)
+                rejected += p.rejected;
+        }
+
         // lists of point primitives, part of the class so that we avoid reallocating memory every frame
         std::vector<point> m_primitives;
     };
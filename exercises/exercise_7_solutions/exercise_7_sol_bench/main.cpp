@@ -0,0 +1,315 @@
+// headless regression and performance harness for the software render library (srl)
+//
+// renders a fixed set of scenes (a cube, and the OBJ models of the models directory next to this source), at several
+// resolutions, with the point, line and triangle renderers, in the forward, deferred and visibility buffer modes.
+// The models are kept with the golden checksums, so that the images they are checked against can't change under them
+// The color buffer of every render is hashed and compared against golden_checksums.txt, and with the forward render
+// of the same scene and renderer, and the throughput of each configuration (million fragments/s and thousand
+// triangles/s) is printed.
+//
+// usage: exercise_7_sol_bench [--update] [--frames N] [--golden path]
+//   --update   write the current checksums as the new golden checksums
+//   --frames   number of frames rendered per configuration to measure performance (default 10)
+//   --golden   golden checksums file (default is the file next to this source)
+// the color buffer of a configuration that does not match its golden checksum is saved as a .ppm image.
+// A configuration without golden checksum fails the run too (run with --update to add it), so that the check cannot
+// pass by checking nothing
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cfloat>
+#include <algorithm>
+
+#include "srl_point_renderer.h"
+#include "srl_line_renderer.h"
+#include "srl_triangle_renderer.h"
+#include "primitives.h"
+#include "obj_parser.h"
+
+#ifndef GOLDEN_FILE
+#define GOLDEN_FILE "golden_checksums.txt"
+#endif
+#ifndef MODELS_DIR
+#define MODELS_DIR "models"
+#endif
+
+struct Scene {
+    std::string name;
+    std::vector<srl::vertex> vts;
+    glm::mat4 model;
+};
+
+// resolutions (square) at which each scene is rendered
+const unsigned int resolutions[] = {64, 256, 1024};
+
+// forward, deferred (G-buffer) and visibility buffer rendering, the three modes produce the same image, except for
+// the anti-aliased lines: the G-buffer keeps one opaque surface per pixel, so the deferred mode can't blend the
+// fragments that partially cover a pixel, it keeps the ones that cover at least half of it and drops the others
+enum class Mode {forward, deferred, visibility};
+const char* modeSuffix[] = {"", "_deferred", "_visibility"};
+
+Scene makeCubeScene();
+bool makeObjScene(const std::string &name, const std::vector<std::string> &paths, Scene &scene);
+uint64_t checksum(const srl::CustomFrameBuffer<uint32_t> &fb);
+bool savePPM(const std::string &path, const srl::CustomFrameBuffer<uint32_t> &fb);
+std::map<std::string, uint64_t> readGolden(const std::string &path);
+bool writeGolden(const std::string &path, const std::map<std::string, uint64_t> &checksums);
+
+
+int main(int argc, char **argv)
+{
+    bool update = false;
+    unsigned int frames = 10;
+    std::string goldenPath = GOLDEN_FILE;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--update") == 0) update = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc) goldenPath = argv[++i];
+        else {
+            std::cout << "usage: " << argv[0] << " [--update] [--frames N] [--golden path]" << std::endl;
+            return 2;
+        }
+    }
+
+    // canonical scenes
+    // ----------------
+    std::vector<Scene> scenes;
+    scenes.push_back(makeCubeScene());
+    std::string models = MODELS_DIR;
+    // a torus knot of quads (v/vt/vn corners) and a height field (v//vn corners, relative indices)
+    for (const char *name : {"knot", "terrain"}) {
+        Scene scene;
+        if (!makeObjScene(name, {models + "/" + name + ".obj"}, scene))
+            return 1;
+        scenes.push_back(scene);
+    }
+
+    srl::PointRenderer pRenderer;
+    srl::LineRenderer lRenderer;
+    srl::LineRenderer aaRenderer;
+    aaRenderer.antialiasing = true;
+    aaRenderer.lineWidth = 1.5f;
+    aaRenderer.lineCap = AALineRasterizer::Cap::round;
+    srl::TriangleRenderer tRenderer;
+    std::pair<const char*, srl::Renderer*> renderers[] = {{"points", &pRenderer}, {"lines", &lRenderer},
+                                                          {"lines_aa", &aaRenderer}, {"triangles", &tRenderer}};
+
+    std::map<std::string, uint64_t> golden = readGolden(goldenPath);
+    std::map<std::string, uint64_t> current;
+    unsigned int mismatches = 0, missing = 0;
+
+    std::cout << std::left << std::setw(36) << "configuration" << std::right
+              << std::setw(12) << "ms/frame" << std::setw(14) << "Mfrags/s" << std::setw(14) << "Ktris/s"
+              << std::setw(20) << "checksum" << "  status" << std::endl;
+
+    for (auto &s : scenes) {
+        for (unsigned int res : resolutions) {
+            // same camera as exercise 7, scenes are scaled to fit in the [-1, 1] cube
+            glm::mat4 viewProj = glm::perspectiveFov<float>(glm::radians(70.0f), (float) res, (float) res, .5f, 5.0f)
+                                 * glm::lookAt<float>(glm::vec3(.0f, .0f, 2.5f),
+                                                      glm::vec3(.0f, .0f, .0f),
+                                                      glm::vec3(.0f, 1.f, .0f));
+            for (auto &r : renderers) {
+                for (Mode mode : {Mode::forward, Mode::deferred, Mode::visibility}) {
+                    // the visibility buffer is only supported by the triangle renderer
+                    if (mode == Mode::visibility && r.second != &tRenderer)
+                        continue;
+                    std::string key = s.name + "_" + std::to_string(res) + "x" + std::to_string(res) + "_" + r.first
+                                      + modeSuffix[(int) mode];
+
+                    srl::CustomFrameBuffer<uint32_t> fb(res, res);
+                    srl::DepthBuffer db(res, res);
+                    srl::GBuffer gb(res, res);
+                    srl::VisibilityBuffer vb(res, res);
+                    srl::Profiler profiler;
+                    r.second->profiler = &profiler;
+
+                    // the first frame is the regression image, all frames are used to measure performance
+                    uint64_t hash = 0;
+                    for (unsigned int f = 0; f < frames; f++) {
+                        fb.clearBuffer(srl::Colors::toRGBA32(srl::Colors::black));
+                        if (mode == Mode::deferred) {
+                            gb.clearBuffer(1.0f);
+                            r.second->renderDeferred(s.vts, s.model, viewProj, gb, fb);
+                        }
+                        else if (mode == Mode::visibility) {
+                            vb.clearBuffer(1.0f);
+                            r.second->renderToVisibilityBuffer(s.vts, s.model, viewProj, vb);
+                            r.second->shadeVisibilityBuffer(vb, fb);
+                        }
+                        else {
+                            db.clearBuffer(1.0f);
+                            r.second->render(s.vts, s.model, viewProj, fb, db);
+                        }
+                        if (f == 0) {
+                            fb.resolve();
+                            hash = checksum(fb);
+                        }
+                    }
+                    r.second->profiler = nullptr;
+                    current[key] = hash;
+
+                    srl::FrameStats avg = profiler.average();
+                    double seconds = avg.totalUs() * 1e-6;
+                    // fragments out of the rasterizer, the visibility buffer mode does not store them but still counts them
+                    double fragsPerSec = seconds > 0 ? avg[srl::PipelineStage::rasterPrimitives].itemsOut / seconds : 0;
+                    // primitives that enter the pipeline, for the point and line renderers the count of triangles
+                    // is the number of vertices / 3
+                    double trisPerSec = seconds > 0 ? (s.vts.size() / 3) / seconds : 0;
+
+                    std::string status;
+                    auto g = golden.find(key);
+                    bool sameAsForward = mode == Mode::forward || r.second == &aaRenderer;
+                    if (!sameAsForward) {
+                        std::string forwardKey = key.substr(0, key.size() - std::strlen(modeSuffix[(int) mode]));
+                        sameAsForward = current[forwardKey] == hash;
+                    }
+                    if (!sameAsForward) {
+                        status = "DIFFERS FROM FORWARD";
+                        mismatches++;
+                    }
+                    else if (update) status = "updated";
+                    else if (g == golden.end()) { status = "no golden"; missing++; }
+                    else if (g->second == hash) status = "ok";
+                    else {
+                        status = "MISMATCH";
+                        mismatches++;
+                        if (savePPM(key + ".ppm", fb))
+                            status += " (saved " + key + ".ppm)";
+                    }
+
+                    std::ostringstream hex;
+                    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+                    std::cout << std::left << std::setw(36) << key << std::right << std::fixed << std::setprecision(3)
+                              << std::setw(12) << avg.totalUs() * 1e-3
+                              << std::setw(14) << fragsPerSec * 1e-6 << std::setw(14) << trisPerSec * 1e-3
+                              << std::setw(20) << hex.str() << "  " << status << std::endl;
+                }
+            }
+        }
+    }
+
+    if (update) {
+        for (auto &c : current)
+            golden[c.first] = c.second;
+        if (!writeGolden(goldenPath, golden)) {
+            std::cout << "could not write " << goldenPath << std::endl;
+            return 1;
+        }
+        std::cout << "golden checksums written to " << goldenPath << std::endl;
+        return 0;
+    }
+
+    std::cout << current.size() << " configurations, " << mismatches << " mismatches, "
+              << missing << " without golden checksum" << std::endl;
+    return mismatches == 0 && missing == 0 ? 0 : 1;
+}
+
+
+Scene makeCubeScene(){
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    Primitives::makeCube(2.f, points, normals, uvs, colors);
+
+    Scene scene;
+    scene.name = "cube";
+    for (unsigned int i = 0; i < points.size(); i++)
+        scene.vts.push_back(srl::vertex{glm::vec4(points[i], 1.0f), glm::vec4(normals[i], 0), colors[i], uvs[i]});
+    // a fixed rotation, so that three faces are visible and some triangles are clipped
+    scene.model = glm::rotate(glm::mat4(1.0f), .6f, glm::vec3(1.f, 1.f, 0.f));
+    return scene;
+}
+
+bool makeObjScene(const std::string &name, const std::vector<std::string> &paths, Scene &scene){
+    scene.name = name;
+    scene.vts.clear();
+    glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+    for (auto &path : paths) {
+        obj::Data data;
+        if (!obj::load(path.c_str(), data)) {
+            std::cout << "could not load scene " << name << ", " << path << ": " << data.error << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < data.corners.size(); i += 3) {
+            const uint32_t *corner = &data.corners[i];
+            const float *p = &data.positions[corner[0] * 3];
+            glm::vec3 point(p[0], p[1], p[2]);
+            // color from the normal, so that the shape is visible without lighting
+            glm::vec3 n(0, 0, 1);
+            if (corner[2] != obj::missing)
+                n = glm::vec3(data.normals[corner[2] * 3], data.normals[corner[2] * 3 + 1],
+                              data.normals[corner[2] * 3 + 2]);
+            glm::vec2 uv(0);
+            if (corner[1] != obj::missing)
+                uv = glm::vec2(data.uvs[corner[1] * 2], data.uvs[corner[1] * 2 + 1]);
+            scene.vts.push_back(srl::vertex{glm::vec4(point, 1.0f), glm::vec4(n, 0), glm::vec4(n * .5f + .5f, 1.0f),
+                                            uv});
+            minPos = glm::min(minPos, point);
+            maxPos = glm::max(maxPos, point);
+        }
+    }
+    // center the model and scale it to fit in the [-1, 1] cube, then rotate it a bit
+    glm::vec3 extent = maxPos - minPos;
+    float size = std::max(extent.x, std::max(extent.y, extent.z));
+    scene.model = glm::rotate(glm::mat4(1.0f), .6f, glm::vec3(1.f, 1.f, 0.f))
+                  * glm::scale(glm::mat4(1.0f), glm::vec3(2.f / size))
+                  * glm::translate(glm::mat4(1.0f), -(minPos + maxPos) * .5f);
+    return true;
+}
+
+// FNV-1a hash of the color buffer
+uint64_t checksum(const srl::CustomFrameBuffer<uint32_t> &fb){
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned int i = 0, size = fb.W * fb.H; i < size; i++) {
+        uint32_t px = fb.buffer[i];
+        for (int b = 0; b < 4; b++) {
+            hash ^= (px >> (8 * b)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+bool savePPM(const std::string &path, const srl::CustomFrameBuffer<uint32_t> &fb){
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file << "P6\n" << fb.W << " " << fb.H << "\n255\n";
+    // the first row of the buffer is the bottom of the image
+    for (int y = (int) fb.H - 1; y >= 0; y--) {
+        for (unsigned int x = 0; x < fb.W; x++) {
+            uint32_t px = fb.buffer[x + y * fb.W];
+            char rgb[3] = {char(px & 0xFF), char((px >> 8) & 0xFF), char((px >> 16) & 0xFF)};
+            file.write(rgb, 3);
+        }
+    }
+    return file.good();
+}
+
+std::map<std::string, uint64_t> readGolden(const std::string &path){
+    std::map<std::string, uint64_t> checksums;
+    std::ifstream file(path);
+    std::string key, value;
+    while (file >> key >> value)
+        checksums[key] = std::stoull(value, nullptr, 16);
+    return checksums;
+}
+
+bool writeGolden(const std::string &path, const std::map<std::string, uint64_t> &checksums){
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+    for (auto &c : checksums)
+        file << c.first << " " << std::hex << std::setw(16) << std::setfill('0') << c.second << std::dec << "\n";
+    return file.good();
+}
@@ -8,12 +8,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "mesh_simplifier.h"
+#include "meshlets.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
 
 struct Vertex {
     // position
@@ -24,6 +30,242 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
+// a level of detail, a range of the indices of the mesh (see buildLods() in mesh_cache.h)
+struct MeshLod {
+    unsigned int firstIndex, indexCount;
+    float error; // how far the surface is from the full mesh, in model units
+    unsigned int firstMeshlet, meshletCount; // the meshlets that split the range, if the mesh has meshlets
+};
+
+
+// vertex and element buffers shared by many meshes, with one vertex array object
+//
+// Every mesh allocates a range of vertices and a range of indices in the arena. The indices of a mesh start at 0 for
+// its first vertex, the draws give the position of that vertex as base vertex, so a mesh can still use 16 bits indices
+// in an arena of millions of vertices. The draws queued with queue() are issued by flush() with one
+// glMultiDrawElementsBaseVertex per index type, instead of binding a vertex array and drawing for every mesh.
+// The buffers grow when they are full (the content is copied on the GPU), the ranges of the meshes stay valid. A Model
+// releases the ranges of its meshes when it is deleted, and the next allocations reuse them.
+class MeshArena {
+public:
+    // where a mesh is in the arena
+    struct Allocation {
+        GLint baseVertex = 0; // first vertex
+        unsigned int vertexCount = 0;
+        size_t indexOffset = 0; // in bytes
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+    };
+
+    // the buffers start with room for initialVertices vertices and 3 32 bits indices per vertex, they are created on
+    // the first allocation (the OpenGL context must be current then)
+    explicit MeshArena(size_t initialVertices = 65536) : initialVertices(initialVertices) {}
+
+    ~MeshArena()
+    {
+        if (VAO == 0)
+            return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    // allocates vertexCount vertices and indexCount indices of indexType (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT),
+    // and uploads vertexData and indexData to them unless they are nullptr (see upload())
+    Allocation allocate(const Vertex *vertexData, unsigned int vertexCount, const void *indexData,
+                        unsigned int indexCount, GLenum indexType)
+    {
+        // the buffers are created by the first allocations, which grow them from 0
+        if (VAO == 0)
+            glGenVertexArrays(1, &VAO);
+        Allocation allocation;
+        allocation.vertexCount = vertexCount;
+        allocation.indexCount = indexCount;
+        allocation.indexType = indexType;
+        size_t vertexOffset = allocateRange(false, vertexCount * sizeof(Vertex));
+        allocation.indexOffset = allocateRange(true, indexBytes(allocation));
+        allocation.baseVertex = (GLint) (vertexOffset / sizeof(Vertex));
+        if (vertexData)
+            upload(allocation, false, 0, vertexCount * sizeof(Vertex), vertexData);
+        if (indexData)
+            upload(allocation, true, 0, indexCount * indexSize(indexType), indexData);
+        return allocation;
+    }
+
+    // frees the ranges of allocation, they are used by the next allocations
+    void release(const Allocation &allocation)
+    {
+        vertexRanges.release(allocation.baseVertex * sizeof(Vertex), allocation.vertexCount * sizeof(Vertex));
+        indexRanges.release(allocation.indexOffset, indexBytes(allocation));
+    }
+
+    // copies size bytes of data at offset in the vertices of allocation, or in its indices if elementBuffer is true
+    void upload(const Allocation &allocation, bool elementBuffer, size_t offset, size_t size, const void *data)
+    {
+        size_t start = elementBuffer ? allocation.indexOffset : allocation.baseVertex * sizeof(Vertex);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer ? EBO : VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, start + offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // adds the draw of allocation to the next flush()
+    void queue(const Allocation &allocation)
+    {
+        Batch &batch = allocation.indexType == GL_UNSIGNED_SHORT ? shortBatch : intBatch;
+        batch.counts.push_back(allocation.indexCount);
+        batch.offsets.push_back(reinterpret_cast<const void*>(allocation.indexOffset));
+        batch.baseVertices.push_back(allocation.baseVertex);
+    }
+
+    // draws the queued allocations as triangles, with the program and uniforms that are in use
+    void flush()
+    {
+        if (shortBatch.counts.empty() && intBatch.counts.empty())
+            return;
+        glBindVertexArray(VAO);
+        draw(shortBatch, GL_UNSIGNED_SHORT);
+        draw(intBatch, GL_UNSIGNED_INT);
+        glBindVertexArray(0);
+    }
+
+    unsigned int getVAO() const { return VAO; }
+
+private:
+    // ranges of a buffer, with the free ones sorted by offset so the neighbours of a freed range are merged with it
+    struct Ranges {
+        size_t capacity = 0;
+        std::map<size_t, size_t> free; // offset -> size
+
+        // first fit, returns false if no free range is big enough
+        bool allocate(size_t size, size_t &offset)
+        {
+            for (auto range = free.begin(); range != free.end(); ++range)
+            {
+                if (range->second < size)
+                    continue;
+                offset = range->first;
+                if (range->second > size)
+                    free[offset + size] = range->second - size;
+                free.erase(range);
+                return true;
+            }
+            return false;
+        }
+
+        void release(size_t offset, size_t size)
+        {
+            if (size == 0)
+                return;
+            auto next = free.lower_bound(offset);
+            if (next != free.end() && offset + size == next->first)
+            {
+                size += next->second;
+                next = free.erase(next);
+            }
+            if (next != free.begin())
+            {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset)
+                {
+                    previous->second += size;
+                    return;
+                }
+            }
+            free[offset] = size;
+        }
+    };
+
+    // the arguments of a glMultiDrawElementsBaseVertex
+    struct Batch {
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+        std::vector<GLint> baseVertices;
+    };
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    size_t initialVertices;
+    Ranges vertexRanges, indexRanges;
+    Batch shortBatch, intBatch;
+
+    static size_t indexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    }
+
+    // the index ranges are multiples of 4 bytes, so the 32 bits indices are aligned
+    static size_t indexBytes(const Allocation &allocation)
+    {
+        return (allocation.indexCount * indexSize(allocation.indexType) + 3) / 4 * 4;
+    }
+
+    // the attributes read the vertex buffer, they must be set again when the buffer is replaced
+    void setupAttributes()
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glBindVertexArray(0);
+    }
+
+    // allocates size bytes in the vertex or the element buffer, which grows (at least doubles) if there is no free
+    // range big enough
+    size_t allocateRange(bool elementBuffer, size_t size)
+    {
+        Ranges &ranges = elementBuffer ? indexRanges : vertexRanges;
+        unsigned int &buffer = elementBuffer ? EBO : VBO;
+        size_t offset = 0;
+        if (size == 0 || ranges.allocate(size, offset))
+            return offset;
+        size_t initialCapacity = initialVertices * (elementBuffer ? 3 * sizeof(unsigned int) : sizeof(Vertex));
+        size_t capacity = std::max(std::max(ranges.capacity * 2, ranges.capacity + size), initialCapacity);
+        unsigned int grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+        if (ranges.capacity > 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, ranges.capacity);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+        if (elementBuffer)
+        {
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBindVertexArray(0);
+        }
+        else
+            setupAttributes();
+        ranges.release(ranges.capacity, capacity - ranges.capacity);
+        ranges.capacity = capacity;
+        ranges.allocate(size, offset);
+        return offset;
+    }
+
+    void draw(Batch &batch, GLenum indexType)
+    {
+        if (batch.counts.size() == 1)
+            glDrawElementsBaseVertex(GL_TRIANGLES, batch.counts[0], indexType, batch.offsets[0], batch.baseVertices[0]);
+        else if (!batch.counts.empty())
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), indexType, batch.offsets.data(),
+                                          (GLsizei) batch.counts.size(), batch.baseVertices.data());
+        batch.counts.clear();
+        batch.offsets.clear();
+        batch.baseVertices.clear();
+    }
+};
+
 
 class Mesh {
 public:
@@ -32,24 +274,170 @@ public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     unsigned int VAO;
+    // type of the indices in the element buffer: GL_UNSIGNED_SHORT if the mesh has few enough vertices, which halves
+    // the size of the buffer, else GL_UNSIGNED_INT
+    GLenum indexType;
+    unsigned int indexCount;
+    // the arena the vertices and indices are in, nullptr if the mesh has buffers of its own
+    MeshArena *arena = nullptr;
+    MeshArena::Allocation allocation;
+    // the levels of detail, from the full mesh, in the element buffer after it. Empty if the mesh has only the full
+    // level, which then uses all the indices
+    std::vector<MeshLod> lods;
+    unsigned int lod = 0; // the level Draw() draws
+    // clusters of triangles of the levels (see meshlets.h), that cull() tests against the view. Empty if the mesh
+    // has none, it is then always drawn whole
+    std::vector<meshlets::Meshlet> meshlets;
 
     /*  Functions  */
-    // constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices)//, vector<Texture> textures)
+    // constructor, the element buffer uses 16 bits indices when the vertices allow it, unless allowShortIndices is false
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool allowShortIndices = true)//, vector<Texture> textures)
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        indexType = allowShortIndices && this->vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        indexCount = this->indices.size();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (indexType == GL_UNSIGNED_SHORT) {
+            std::vector<unsigned short> shortIndices(this->indices.begin(), this->indices.end());
+            setupMesh(this->vertices.data(), this->vertices.size(), shortIndices.data());
+        }
+        else
+            setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data());
+    }
+
+    // constructor that uploads the vertices and indices (of type indexType) from where they are, e.g. a mesh file mapped
+    // in memory (see mesh_cache.h), without copying them: the vertices and indices vectors of the mesh stay empty.
+    // With nullptr data the buffers are only allocated, and upload() fills them later
+    Mesh(const Vertex *vertexData, unsigned int vertexCount, const void *indexData, unsigned int indexCount, GLenum indexType)
+    {
+        this->indexType = indexType;
+        this->indexCount = indexCount;
+        setupMesh(vertexData, vertexCount, indexData);
+    }
+
+    // constructor that puts the vertices and indices in arena (see MeshArena), the same way as the one above
+    Mesh(MeshArena &arena, const Vertex *vertexData, unsigned int vertexCount, const void *indexData,
+         unsigned int indexCount, GLenum indexType)
+    {
+        this->indexType = indexType;
+        this->indexCount = indexCount;
+        this->arena = &arena;
+        allocation = arena.allocate(vertexData, vertexCount, indexData, indexCount, indexType);
+        VAO = arena.getVAO();
+        VBO = EBO = 0;
+    }
+
+    // copies size bytes of data at offset in the vertex buffer, or in the element buffer if elementBuffer is true,
+    // so a big mesh can be uploaded in parts, over several frames
+    void upload(bool elementBuffer, size_t offset, size_t size, const void *data)
+    {
+        if (arena)
+        {
+            arena->upload(allocation, elementBuffer, offset, size, data);
+            return;
+        }
+        // the copy write target does not change the buffers bound to the vertex array
+        glBindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer ? EBO : VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // draws the coarsest level whose error, seen from distance (in model units), covers at most maxPixelError pixels
+    // (pixelScale is meshsimplifier::pixelScale() of the projection)
+    void selectLod(float distance, float pixelScale, float maxPixelError)
+    {
+        lod = lods.empty() ? 0 : (unsigned int) meshsimplifier::selectLevel(lods.data(), lods.size(), distance,
+                                                                            pixelScale, maxPixelError);
+        culled = false;
+    }
+
+    // keeps, for the next draws, only the meshlets of the selected level that are in the view frustum and, with
+    // backfaces, not facing away from the camera (only for closed meshes, or with back face culling on), for the
+    // mesh drawn with modelViewProjection (projection * view * model). The meshlets that are left are drawn as
+    // ranges of indices, the neighbouring ones merged in one range.
+    // Returns the number of meshlets culled. Selecting a level draws it whole again, until the next cull()
+    unsigned int cull(glm::mat4 const &modelViewProjection, bool backfaces = true)
+    {
+        culled = false;
+        if (meshlets.empty() || lods.empty() || lods[lod].meshletCount == 0)
+            return 0;
+        meshlets::Frustum frustum = meshlets::frustumFromMatrix(&modelViewProjection[0][0]);
+        float camera[3];
+        bool coneTest = backfaces && meshlets::cameraFromMatrix(&modelViewProjection[0][0], camera);
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        unsigned int culledCount = 0, end = 0;
+        visibleCounts.clear();
+        visibleOffsets.clear();
+        for (unsigned int i = lods[lod].firstMeshlet; i < lods[lod].firstMeshlet + lods[lod].meshletCount; i++)
+        {
+            const meshlets::Meshlet &meshlet = meshlets[i];
+            if (!meshlets::isVisible(meshlet, frustum, coneTest ? camera : nullptr))
+            {
+                culledCount++;
+                continue;
+            }
+            if (!visibleCounts.empty() && end == meshlet.firstIndex)
+                visibleCounts.back() += meshlet.indexCount;
+            else
+            {
+                visibleCounts.push_back(meshlet.indexCount);
+                visibleOffsets.push_back((const void*) (meshlet.firstIndex * indexSize));
+            }
+            end = meshlet.firstIndex + meshlet.indexCount;
+        }
+        culled = true;
+        return culledCount;
+    }
+
+    // adds the draw of the selected level, or of its visible meshlets, to the next flush() of the arena of the mesh
+    void queue() const
+    {
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        MeshArena::Allocation range = allocation;
+        if (culled)
+        {
+            for (size_t i = 0; i < visibleCounts.size(); i++)
+            {
+                range.indexOffset = allocation.indexOffset + (size_t) visibleOffsets[i];
+                range.indexCount = visibleCounts[i];
+                arena->queue(range);
+            }
+            return;
+        }
+        if (!lods.empty())
+        {
+            range.indexOffset += lods[lod].firstIndex * indexSize;
+            range.indexCount = lods[lod].indexCount;
+        }
+        arena->queue(range);
     }
 
     // render the mesh
     void Draw()
     {
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        if (arena)
+        {
+            queue();
+            arena->flush();
+        }
+        else if (culled)
+        {
+            // the ranges of the visible meshlets, with one draw call
+            glBindVertexArray(VAO);
+            glMultiDrawElements(GL_TRIANGLES, visibleCounts.data(), indexType, visibleOffsets.data(),
+                                (GLsizei) visibleCounts.size());
+            glBindVertexArray(0);
+        }
+        else
+        {
+            unsigned int first = lods.empty() ? 0 : lods[lod].firstIndex;
+            unsigned int count = lods.empty() ? indexCount : lods[lod].indexCount;
+            glBindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, count, indexType, (void*)(first * (indexType == GL_UNSIGNED_SHORT ? 2 : 4)));
+            glBindVertexArray(0);
+        }
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
@@ -58,10 +446,15 @@ public:
 private:
     /*  Render data  */
     unsigned int VBO, EBO;
+    // the ranges of indices drawn when culled is true, set by cull(): counts and offsets in the element buffer (from
+    // the first index of the mesh, in bytes), as glMultiDrawElements takes them
+    bool culled = false;
+    std::vector<GLsizei> visibleCounts;
+    std::vector<const void*> visibleOffsets;
 
     /*  Functions    */
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const void *indexData)
     {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
@@ -74,10 +467,11 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
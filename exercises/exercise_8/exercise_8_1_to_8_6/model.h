@@ -8,17 +8,30 @@
 #include "mesh.h"
 #include "shader.h"
 // NEW! our models are stored in a specific 3D mesh format (i.e. no longer in a header file)
-//  objloader is used to parse those files
-#include "objloader.h"
+//  obj_parser is used to parse those files, and mesh_cache keeps them in a binary format that loads faster
+#include "mesh_cache.h"
+#include "mesh_loader.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <cfloat>
+#include <cstddef>
 #include <vector>
 using namespace std;
 
+// the vertices of the mesh files are uploaded as they are
+static_assert(sizeof(Vertex) == sizeof(meshcache::PackedVertex) &&
+              offsetof(Vertex, Normal) == offsetof(meshcache::PackedVertex, normal) &&
+              offsetof(Vertex, TexCoords) == offsetof(meshcache::PackedVertex, uv), "Vertex must match the mesh files");
+
+
+class ModelLoader;
 
 class Model
 {
@@ -26,71 +39,292 @@ public:
     /*  Model Data */
     std::vector<Mesh> meshes;
     string directory;
+    // the arena the meshes are in (see MeshArena in mesh.h), nullptr if every mesh has buffers of its own
+    MeshArena *arena = nullptr;
+
+    // the files of the model, the mesh of each file is in meshes once it is loaded
+    struct Part {
+        string path;
+        bool loaded = false; // uploaded, or failed to load
+        bool boundsKnown = false;
+        glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+    };
+    std::vector<Part> parts;
 
     /*  Functions   */
-    // constructor, expects a filepath to a 3D model.
-    Model(string const &path)
+    // constructor, expects a filepath to a 3D model. With an arena, the meshes are put in it
+    Model(string const &path, MeshArena *arena = nullptr) : arena(arena)
     {
         loadModel(path);
     }
 
-    Model(std::vector<string> const &paths)
+    Model(std::vector<string> const &paths, MeshArena *arena = nullptr) : arena(arena)
     {
         for(auto path : paths)
             loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
+    // constructor that returns right away, the files are loaded by loader and the meshes appear as they are ready
+    // (in the arena of the loader, if it has one). Until the bounds of a file are known, the model uses the
+    // placeholder bounds
+    Model(std::vector<string> const &paths, ModelLoader &loader,
+          glm::vec3 placeholderMin = glm::vec3(-1.0f), glm::vec3 placeholderMax = glm::vec3(1.0f));
+
+    // frees the ranges of the meshes in their arena, the next meshes put in it use them. The arena must not be
+    // deleted before the model
+    ~Model()
+    {
+        for (Mesh &mesh : meshes)
+            if (mesh.arena)
+                mesh.arena->release(mesh.allocation);
+    }
+
+    // the meshes are copies that share their arena ranges, only one model can free them
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    // draws the model, and thus all its meshes. The meshes in the arena of the model are drawn together, with one
+    // draw call per index type
     void Draw()
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw();
+        {
+            if (arena && meshes[i].arena == arena)
+                meshes[i].queue();
+            else
+                meshes[i].Draw();
+        }
+        if (arena)
+            arena->flush();
+    }
+
+    // picks the level of detail of every mesh for the model drawn with the model matrix, seen from cameraPosition:
+    // the coarsest level whose error covers at most maxPixelError pixels (pixelScale is meshsimplifier::pixelScale()
+    // of the projection). The distance is the one to the bounding sphere of the model
+    void selectLod(glm::mat4 const &model, glm::vec3 const &cameraPosition, float pixelScale, float maxPixelError)
+    {
+        glm::vec3 boundsMin, boundsMax;
+        getBounds(boundsMin, boundsMax);
+        if (boundsMin.x > boundsMax.x)
+            return;
+        glm::vec3 center = glm::vec3(model * glm::vec4((boundsMin + boundsMax) * .5f, 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(model[0])),
+                               glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        float radius = glm::length(boundsMax - boundsMin) * .5f * scale;
+        // in model units, like the errors of the levels
+        float distance = glm::max(glm::length(cameraPosition - center) - radius, 1e-3f) / scale;
+        for (Mesh &mesh : meshes)
+            mesh.selectLod(distance, pixelScale, maxPixelError);
+    }
+
+    // culls the meshlets of every mesh (see Mesh::cull()) for the model drawn with the model matrix, call it after
+    // selectLod(). Returns the number of meshlets culled
+    unsigned int cull(glm::mat4 const &model, glm::mat4 const &viewProjection, bool backfaces = true)
+    {
+        glm::mat4 modelViewProjection = viewProjection * model;
+        unsigned int culled = 0;
+        for (Mesh &mesh : meshes)
+            culled += mesh.cull(modelViewProjection, backfaces);
+        return culled;
+    }
+
+    // the levels of detail and meshlets of a mesh file
+    static void setLods(Mesh &mesh, const meshcache::MeshFile &file)
+    {
+        mesh.lods.clear();
+        for (uint32_t i = 0; i < file.header().lodCount; i++)
+        {
+            const meshcache::Lod &lod = file.lods()[i];
+            mesh.lods.push_back(MeshLod{lod.firstIndex, lod.indexCount, lod.error, lod.firstMeshlet, lod.meshletCount});
+        }
+        mesh.meshlets.assign(file.meshlets(), file.meshlets() + file.header().meshletCount);
+    }
+
+    // true once every file is loaded (or failed to load)
+    bool isLoaded() const
+    {
+        for (const Part &part : parts)
+            if (!part.loaded)
+                return false;
+        return true;
+    }
+
+    // axis aligned bounding box of the model, the files that are still loading count as the placeholder bounds, the
+    // files that failed to load do not count (if no file counts, boundsMin is bigger than boundsMax)
+    void getBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const
+    {
+        boundsMin = glm::vec3(FLT_MAX);
+        boundsMax = glm::vec3(-FLT_MAX);
+        for (const Part &part : parts)
+        {
+            if (part.loaded && !part.boundsKnown)
+                continue;
+            boundsMin = glm::min(boundsMin, part.boundsKnown ? part.boundsMin : placeholderMin);
+            boundsMax = glm::max(boundsMax, part.boundsKnown ? part.boundsMax : placeholderMax);
+        }
     }
 
 private:
+    glm::vec3 placeholderMin = glm::vec3(-1.0f), placeholderMax = glm::vec3(1.0f);
+
     /*  Functions   */
     // loads a model
     void loadModel(string const &path)
     {
+        // the OBJ file is only parsed the first time, the next times the mesh is loaded from a binary cache of the file
+        // that is mapped in memory, and the vertices and indices are uploaded from there
+        printf("Loading OBJ file %s...\n", path.c_str());
+        Part part;
+        part.path = path;
+        part.loaded = true;
+        meshcache::MeshFile file;
+        if (!meshcache::loadOrBuild(path, file))
+        {
+            printf("%s\n", file.error.c_str());
+            parts.push_back(part);
+            return;
+        }
+        const meshcache::Header &header = file.header();
+        part.boundsKnown = true;
+        part.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        part.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        parts.push_back(part);
+        const Vertex *vertices = reinterpret_cast<const Vertex*>(file.vertices());
+        GLenum indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        if (arena)
+            meshes.push_back(Mesh(*arena, vertices, header.vertexCount, file.indices(), header.indexCount, indexType));
+        else
+            meshes.push_back(Mesh(vertices, header.vertexCount, file.indices(), header.indexCount, indexType));
+        setLods(meshes.back(), file);
+    }
+};
 
-        std::vector<glm::vec3> vertices;
-        std::vector<glm::vec2> uvs;
-        std::vector<glm::vec3> normals;
 
-        loadOBJ(path.c_str(), vertices, uvs, normals);
-        meshes.push_back(processMesh(vertices, uvs, normals));
+// loads models without stopping the render loop
+//
+// The files are parsed (or their cache is mapped) by a MeshLoader, on worker threads. update(), called every frame by
+// the thread that owns the OpenGL context, uploads the finished meshes to the GPU in parts, for at most budget seconds,
+// so even a big model only makes the frames it is uploaded in a little longer.
+// The models must not be deleted before the loader.
+class ModelLoader
+{
+public:
+    // threads workers parse the files, 0 is one per core but one. With an arena, the meshes are put in it
+    explicit ModelLoader(unsigned int threads = 0, MeshArena *arena = nullptr) : arena(arena), loader(threads) {}
 
+    // the meshes that are not uploaded yet belong to no model, their ranges are freed here
+    ~ModelLoader()
+    {
+        for (const std::unique_ptr<Upload> &upload : uploads)
+            if (upload->mesh && upload->mesh->arena)
+                upload->mesh->arena->release(upload->mesh->allocation);
     }
 
+    ModelLoader(const ModelLoader &) = delete;
+    ModelLoader &operator=(const ModelLoader &) = delete;
 
-    Mesh processMesh(const std::vector<glm::vec3> & inVertices,
-                     const std::vector<glm::vec2> & inUvs,
-                     const std::vector<glm::vec3> & inNormals)
+    // loads the file at path as a new part of model
+    void load(Model &model, string const &path)
     {
-        // data to fill
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
+        Model::Part part;
+        part.path = path;
+        model.parts.push_back(part);
+        model.arena = arena;
+        targets[loader.request(path)] = Target{&model, model.parts.size() - 1};
+    }
 
-        // Walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < inVertices.size(); i++)
+    // uploads the meshes that are ready, for about budget seconds (at least one part of one mesh)
+    void update(float budget)
+    {
+        // the bounds of a mesh are known as soon as it is loaded, before it is uploaded
+        MeshLoader::Result result;
+        while (loader.poll(result))
         {
-            Vertex vertex;
-            glm::vec3 vector;
-            // positions
-            vertex.Position = inVertices[i];
-            // normals
-            vertex.Normal = inNormals[i];
-            // texture coordinates
-            vertex.TexCoords = i < inUvs.size() ? inUvs[i] : glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
-            indices.push_back(i);
+            Target target = targets[result.id];
+            targets.erase(result.id);
+            Model::Part &part = target.model->parts[target.part];
+            if (!result.file)
+            {
+                printf("%s\n", result.error.c_str());
+                part.loaded = true;
+                continue;
+            }
+            const meshcache::Header &header = result.file->header();
+            part.boundsKnown = true;
+            part.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+            part.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+            uploads.emplace_back(new Upload{target, std::move(result.file)});
         }
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices);//, textures);
+        auto start = std::chrono::steady_clock::now();
+        while (!uploads.empty())
+        {
+            Upload &upload = *uploads.front();
+            const meshcache::MeshFile &file = *upload.file;
+            const meshcache::Header &header = file.header();
+            size_t vertexBytes = (size_t) header.vertexCount * header.vertexStride;
+            size_t indexBytes = (size_t) header.indexCount * header.indexSize;
+            GLenum indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            if (!upload.mesh)
+            {
+                if (arena)
+                    upload.mesh.reset(new Mesh(*arena, nullptr, header.vertexCount, nullptr, header.indexCount,
+                                               indexType));
+                else
+                    upload.mesh.reset(new Mesh(nullptr, header.vertexCount, nullptr, header.indexCount, indexType));
+                Model::setLods(*upload.mesh, file);
+            }
+
+            // the vertices, then the indices, one part at a time
+            bool elementBuffer = upload.uploaded >= vertexBytes;
+            size_t offset = elementBuffer ? upload.uploaded - vertexBytes : upload.uploaded;
+            size_t size = std::min(uploadPartSize, (elementBuffer ? indexBytes : vertexBytes) - offset);
+            const char *data = static_cast<const char*>(elementBuffer ? file.indices() : (const void*) file.vertices());
+            if (size > 0)
+                upload.mesh->upload(elementBuffer, offset, size, data + offset);
+            upload.uploaded += size;
+
+            if (upload.uploaded == vertexBytes + indexBytes)
+            {
+                upload.target.model->meshes.push_back(*upload.mesh);
+                upload.target.model->parts[upload.target.part].loaded = true;
+                uploads.pop_front();
+            }
+            if (std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >= budget)
+                break;
+        }
     }
 
+    // true once every requested file is uploaded (or failed to load)
+    bool isDone() const { return loader.pending() == 0 && uploads.empty(); }
+
+private:
+    // bytes uploaded at once, the budget is checked between the parts
+    const size_t uploadPartSize = 256 * 1024;
+
+    struct Target {
+        Model *model;
+        size_t part;
+    };
+    struct Upload {
+        Target target;
+        std::unique_ptr<meshcache::MeshFile> file;
+        std::unique_ptr<Mesh> mesh;
+        size_t uploaded = 0; // bytes of the vertices, then of the indices
+    };
+
+    MeshArena *arena;
+    MeshLoader loader;
+    std::map<unsigned int, Target> targets;
+    std::deque<std::unique_ptr<Upload>> uploads;
 };
 
+
+inline Model::Model(std::vector<string> const &paths, ModelLoader &loader, glm::vec3 placeholderMin, glm::vec3 placeholderMax) :
+        placeholderMin(placeholderMin), placeholderMax(placeholderMax)
+{
+    for (auto path : paths)
+        loader.load(*this, path);
+}
+
 #endif
\ No newline at end of file
@@ -5,97 +5,69 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_features.h"
+#include "program_cache.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 class Shader
 {
 public:
     unsigned int ID;
+    // #define keys added to the sources of the shaders, after the #version line, e.g. {{"NUM_LIGHTS", "2"}}
+    typedef std::vector<std::pair<std::string, std::string>> Defines;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : Shader(vertexPath, fragmentPath, Defines(), geometryPath)
+    {
+    }
+    // the same, with defines added to each stage (see ShaderPermutations below). Each stage also gets VERTEX_SHADER,
+    // FRAGMENT_SHADER or GEOMETRY_SHADER defined, so one file can hold the code of all the stages
+    Shader(const char* vertexPath, const char* fragmentPath, const Defines &defines, const char* geometryPath = nullptr)
+        : defines(defines)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-            // if geometry shader path is present, also load a geometry shader
-            if (geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure e)
+        if (!readFile(vertexPath, vertexCode) || !readFile(fragmentPath, fragmentCode) ||
+            (geometryPath != nullptr && !readFile(geometryPath, geometryCode)))
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        vertexCode = addDefines(vertexCode, "VERTEX_SHADER");
+        fragmentCode = addDefines(fragmentCode, "FRAGMENT_SHADER");
         if (geometryPath != nullptr)
+            geometryCode = addDefines(geometryCode, "GEOMETRY_SHADER");
+        // 2. load the program linked by an earlier run (see program_cache.h) if the sources and the driver are the
+        // same, else compile and link it, and cache it for the next runs
+        ID = glCreateProgram();
+        cachePath = programcache::cachePath(vertexPath, fragmentPath, geometryPath, definesText(defines));
+        const uint64_t cacheKey = programcache::programKey({vertexCode, fragmentCode, geometryCode});
+        if (!programcache::load(ID, cachePath, cacheKey))
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            const std::string *geometry = geometryPath != nullptr ? &geometryCode : nullptr;
+            checkProgram(ID, buildProgram(ID, vertexCode, fragmentCode, geometry));
+            programcache::store(ID, cachePath, cacheKey);
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
 
+        // the locations of the uniforms are looked up once, here, and not every time a uniform is set
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -103,69 +75,315 @@ public:
     {
         glUseProgram(ID);
     }
-    // utility uniform functions
+    // a uniform name resolved once, that the setters take instead of the name, e.g.
+    //   const Shader::Uniform modelUniform = Shader::uniform("model");
+    //   shader->setMat4(modelUniform, model);
+    // the location of the uniform in each program is then found with an array lookup, without comparing strings.
+    // The same handle works with every program (the uniform is set if the program uses it)
+    struct Uniform {
+        unsigned int id;
+    };
+    static Uniform uniform(const std::string &name)
+    {
+        std::vector<std::string> &names = uniformNames();
+        auto found = std::find(names.begin(), names.end(), name);
+        if (found == names.end())
+            found = names.insert(names.end(), name);
+        return Uniform{(unsigned int)(found - names.begin())};
+    }
+    // location of a uniform of the program, -1 (which glUniform ignores) if the program does not use it
+    GLint getLocation(const std::string &name) const
+    {
+        auto byName = [](const std::pair<std::string, GLint> &u, const std::string &n){ return u.first < n; };
+        auto found = std::lower_bound(uniforms.begin(), uniforms.end(), name, byName);
+        if (found != uniforms.end() && found->first == name)
+            return found->second;
+        // the elements of arrays after the first are not listed by the reflection
+        return name.find('[') != std::string::npos ? glGetUniformLocation(ID, name.c_str()) : -1;
+    }
+    GLint getLocation(Uniform uniform) const
+    {
+        if (uniform.id >= locations.size())
+            locations.resize(uniform.id + 1, unresolved);
+        if (locations[uniform.id] == unresolved)
+            locations[uniform.id] = getLocation(uniformNames()[uniform.id]);
+        return locations[uniform.id];
+    }
+    // connects the std140 uniform block blockName of the program to the uniform buffer at binding (see UniformBuffer
+    // in uniform_buffer.h), returns false if the program does not use the block
+    bool bindUniformBlock(const std::string &blockName, GLuint binding)
+    {
+        // kept to connect the block again when the program is reloaded
+        auto byName = [&blockName](const std::pair<std::string, GLuint> &b){ return b.first == blockName; };
+        blockBindings.erase(std::remove_if(blockBindings.begin(), blockBindings.end(), byName), blockBindings.end());
+        blockBindings.emplace_back(blockName, binding);
+        GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(ID, index, binding);
+        return true;
+    }
+    // hot reload: starts building the program again from new sources (as read from the files, the defines are added
+    // here), ID stays the program in use until the new one is linked, see finishReload(). A reload that was not
+    // finished is dropped
+    void beginReload(const std::string &vertexCode, const std::string &fragmentCode,
+                     const std::string *geometryCode = nullptr)
+    {
+        dropReload();
+        std::string sources[3] = {addDefines(vertexCode, "VERTEX_SHADER"), addDefines(fragmentCode, "FRAGMENT_SHADER"),
+                                  geometryCode ? addDefines(*geometryCode, "GEOMETRY_SHADER") : std::string()};
+        pendingKey = programcache::programKey({sources[0], sources[1], sources[2]});
+        pending = glCreateProgram();
+        pendingShaders = buildProgram(pending, sources[0], sources[1], geometryCode ? &sources[2] : nullptr);
+    }
+    // returns true once the reload started by beginReload() is over: ID is then the new program if it linked, or
+    // still the old one if the new sources have errors (they are printed). If the driver compiles on threads of its
+    // own (GL_KHR_parallel_shader_compile) it returns false while the driver is not done, instead of waiting for it.
+    // Without the extension the first call waits for the driver
+    bool finishReload()
+    {
+        if (pending == 0)
+            return true;
+        GLint completed = GL_TRUE;
+        if (parallelCompile())
+            glGetProgramiv(pending, GL_COMPLETION_STATUS_KHR, &completed);
+        if (completed != GL_TRUE)
+            return false;
+        if (checkProgram(pending, pendingShaders))
+        {
+            glDeleteProgram(ID);
+            ID = pending;
+            uniforms.clear();
+            locations.clear();
+            reflectUniforms();
+            for (const auto &binding : std::vector<std::pair<std::string, GLuint>>(blockBindings))
+                bindUniformBlock(binding.first, binding.second);
+            programcache::store(ID, cachePath, pendingKey);
+        }
+        else
+            glDeleteProgram(pending);
+        pending = 0;
+        pendingShaders.clear();
+        return true;
+    }
+    bool isReloading() const
+    {
+        return pending != 0;
+    }
+    // drops the reload started by beginReload() if it is not finished, ID stays the program in use
+    void dropReload()
+    {
+        if (pending == 0)
+            return;
+        for (GLuint shader : pendingShaders)
+            glDeleteShader(shader);
+        glDeleteProgram(pending);
+        pending = 0;
+        pendingShaders.clear();
+    }
+    // reads the file at path in code, returns false if it can not be read
+    static bool readFile(const std::string &path, std::string &code)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        code = stream.str();
+        return !file.bad();
+    }
+    // the defines as #define lines, in order
+    static std::string definesText(const Defines &defines)
+    {
+        std::string text;
+        for (const auto &define : defines)
+            text += "#define " + define.first + " " + define.second + "\n";
+        return text;
+    }
+    // true if the driver compiles and links on threads of its own, see finishReload(). It is checked on the context
+    // (once, the exercises have one), the glad header of the repo is only for GL 3.3 and has no such extension
+    static bool parallelCompile()
+    {
+        static const bool supported = GLFeatures::hasExtension("GL_KHR_parallel_shader_compile") ||
+                                      GLFeatures::hasExtension("GL_ARB_parallel_shader_compile");
+        return supported;
+    }
+    // utility uniform functions, name is a std::string or a Uniform
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    template <class Name>
+    void setBool(const Name &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    template <class Name>
+    void setInt(const Name &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    template <class Name>
+    void setFloat(const Name &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    template <class Name>
+    void setVec2(const Name &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getLocation(name), 1, &value[0]);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    template <class Name>
+    void setVec2(const Name &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    template <class Name>
+    void setVec3(const Name &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getLocation(name), 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    template <class Name>
+    void setVec3(const Name &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    template <class Name>
+    void setVec4(const Name &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getLocation(name), 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w)
+    template <class Name>
+    void setVec4(const Name &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    template <class Name>
+    void setMat2(const Name &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    template <class Name>
+    void setMat3(const Name &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    template <class Name>
+    void setMat4(const Name &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // the active uniforms of the program (outside of uniform blocks), sorted by name, with their location
+    std::vector<std::pair<std::string, GLint>> uniforms;
+    // the location of each Uniform handle in this program, filled as they are used
+    enum { unresolved = -2 };
+    mutable std::vector<GLint> locations;
+    // the uniform blocks connected by bindUniformBlock(), with their binding
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+    // how the program was built, to build it again
+    Defines defines;
+    std::string cachePath;
+    // the program being built by beginReload(), 0 if none, its shaders, and its key in the program cache
+    GLuint pending = 0;
+    std::vector<GLuint> pendingShaders;
+    uint64_t pendingKey = 0;
+
+    static std::vector<std::string> &uniformNames()
+    {
+        static std::vector<std::string> names;
+        return names;
+    }
+
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+            std::string uniformName(name.data(), length);
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location < 0)
+                continue; // a member of a uniform block
+            uniforms.emplace_back(uniformName, location);
+            // an array is listed as "name[0]", and can be set as "name"
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniforms.emplace_back(uniformName.substr(0, uniformName.size() - 3), location);
+        }
+        std::sort(uniforms.begin(), uniforms.end());
+    }
+
+    // the source with the defines of the program and stage defined, after the #version line (which must be first).
+    // A #line directive after them keeps the line numbers of the errors those of the file
+    std::string addDefines(const std::string &source, const char *stage) const
+    {
+        size_t version = source.find("#version");
+        size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+        insert = insert == std::string::npos ? source.size() : insert + (version == std::string::npos ? 0 : 1);
+        size_t line = std::count(source.begin(), source.begin() + insert, '\n') + 1;
+        std::string added = "#define " + std::string(stage) + "\n" + definesText(defines) +
+                            "#line " + std::to_string(line) + "\n";
+        return source.substr(0, insert) + (insert > 0 && source[insert - 1] != '\n' ? "\n" : "") + added +
+               source.substr(insert);
+    }
+
+    // compiles the shaders and links them in program, geometryCode is null if there is no geometry shader. It does
+    // not wait for the driver to be done: the shaders are returned, for checkProgram() to print their errors and
+    // delete them
+    // ------------------------------------------------------------------------
+    std::vector<GLuint> buildProgram(GLuint program, const std::string &vertexCode, const std::string &fragmentCode,
+                                     const std::string *geometryCode)
+    {
+        const std::string *codes[3] = {&vertexCode, &fragmentCode, geometryCode};
+        const GLenum types[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+        std::vector<GLuint> shaders;
+        for (int i = 0; i < 3; i++)
+        {
+            if (codes[i] == nullptr)
+                continue;
+            const char *code = codes[i]->c_str();
+            GLuint shader = glCreateShader(types[i]);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+        programcache::prepare(program);
+        glLinkProgram(program);
+        return shaders;
+    }
+
+    // prints the errors of the shaders and of the program built by buildProgram(), and deletes the shaders (they're
+    // linked into our program now and no longer necessery), returns true if the program is linked
+    bool checkProgram(GLuint program, const std::vector<GLuint> &shaders)
+    {
+        for (GLuint shader : shaders)
+        {
+            GLint type = 0;
+            glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+            checkCompileErrors(shader, type == GL_VERTEX_SHADER ? "VERTEX" :
+                                       type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "GEOMETRY");
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        return checkCompileErrors(program, "PROGRAM");
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -187,6 +405,166 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
+    }
+};
+
+// the programs built from the same shader files with different #define keys (the permutations of the shaders, e.g.
+// the number of lights), built the first time they are asked for, and rebuilt when the files are edited
+//
+// get() returns the program of some defines, every frame: the first call builds it (from the program cache if it was
+// built before, see program_cache.h), the others find it in a map. With watch(), a thread reads the files again a few
+// times per second, and update() rebuilds the programs if they changed, without stopping the frames to wait for the
+// driver: while the new program is built the old one is still drawn with, and if the new sources have errors they
+// are printed and the old program is kept
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
+    {
     }
+    ~ShaderPermutations()
+    {
+        if (watcher.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            watcher.join();
+        }
+        for (auto &program : programs)
+        {
+            program.second->dropReload();
+            glDeleteProgram(program.second->ID);
+        }
+    }
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations&) = delete;
+
+    // the program built with defines, built now if it is the first time
+    Shader *get(const Shader::Defines &defines)
+    {
+        std::unique_ptr<Shader> &program = programs[Shader::definesText(defines)];
+        if (!program)
+        {
+            program.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines,
+                                     geometryPath.empty() ? nullptr : geometryPath.c_str()));
+            for (const auto &binding : blockBindings)
+                program->bindUniformBlock(binding.first, binding.second);
+        }
+        return program.get();
+    }
+    // like Shader::bindUniformBlock(), for the programs built so far and the ones built later
+    void bindUniformBlock(const std::string &blockName, GLuint binding)
+    {
+        blockBindings.emplace_back(blockName, binding);
+        for (auto &program : programs)
+            program.second->bindUniformBlock(blockName, binding);
+    }
+    // starts watching the files for changes, every interval seconds
+    void watch(float interval = 0.25f)
+    {
+        if (watcher.joinable())
+            return;
+        Sources last = read();
+        watcher = std::thread([this, interval, last]() mutable {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, std::chrono::duration<float>(interval), [this]{ return stopping; }))
+            {
+                // the files are read without the lock, update() is not kept waiting for the disk
+                lock.unlock();
+                Sources sources = read();
+                lock.lock();
+                if (sources.read && !(sources == last))
+                {
+                    last = edited = sources;
+                    hasEdit = true;
+                }
+            }
+        });
+    }
+    // call it once per frame (with the context current), it starts rebuilding the programs after the files are
+    // edited, and swaps in the ones that are built. Returns true if the ID of a program changed
+    bool update()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hasEdit)
+            {
+                sources = edited;
+                hasEdit = false;
+                queue.clear();
+                for (auto &program : programs)
+                    queue.push_back(program.second.get());
+            }
+        }
+        bool changed = false;
+        for (auto it = reloading.begin(); it != reloading.end();)
+        {
+            GLuint previous = (*it)->ID;
+            if ((*it)->finishReload())
+            {
+                changed = changed || (*it)->ID != previous;
+                it = reloading.erase(it);
+            }
+            else
+                ++it;
+        }
+        // if the driver builds programs on threads of its own they are all started at once, else one per frame, so
+        // that a frame is not stopped for the whole list
+        while (!queue.empty() && (Shader::parallelCompile() || reloading.empty()))
+        {
+            Shader *program = queue.front();
+            queue.pop_front();
+            program->beginReload(sources.vertex, sources.fragment, geometryPath.empty() ? nullptr : &sources.geometry);
+            if (std::find(reloading.begin(), reloading.end(), program) == reloading.end())
+                reloading.push_back(program);
+        }
+        return changed;
+    }
+    // the number of programs built so far
+    size_t size() const
+    {
+        return programs.size();
+    }
+
+private:
+    struct Sources
+    {
+        std::string vertex, fragment, geometry;
+        bool read = false;
+        bool operator==(const Sources &other) const
+        {
+            return vertex == other.vertex && fragment == other.fragment && geometry == other.geometry;
+        }
+    };
+
+    Sources read() const
+    {
+        Sources sources;
+        sources.read = Shader::readFile(vertexPath, sources.vertex) &&
+                       Shader::readFile(fragmentPath, sources.fragment) &&
+                       (geometryPath.empty() || Shader::readFile(geometryPath, sources.geometry));
+        return sources;
+    }
+
+    const std::string vertexPath, fragmentPath, geometryPath;
+    // the programs by the text of their defines
+    std::map<std::string, std::unique_ptr<Shader>> programs;
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+    // the sources the programs are rebuilt from, the programs waiting to be rebuilt and the ones being rebuilt
+    Sources sources;
+    std::deque<Shader*> queue;
+    std::vector<Shader*> reloading;
+    // the watching thread, the sources it read after an edit are passed to update() in edited
+    std::thread watcher;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool hasEdit = false;
+    Sources edited;
 };
-#endif
\ No newline at end of file
+#endif
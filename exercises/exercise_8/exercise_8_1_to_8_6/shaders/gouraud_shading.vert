@@ -5,9 +5,12 @@ layout (location = 2) in vec2 textCoord; // here for completness, but we are not
 
 uniform mat4 model; // represents model coordinates in the world coord space
 uniform mat4 invTransposeModel; // inverse of the transpose of  model (used to multiply vectors while preserving angles)
-uniform mat4 view;  // represents the world coordinates in the camera coord space
-uniform mat4 projection; // camera projection matrix
-uniform vec3 camPosition; // so we can compute the view vector (could be extracted from view matrix, but let's make our life easier :) )
+// the camera, the same for every draw of a frame, uploaded once for all the programs (see uniform_buffer.h)
+layout (std140) uniform Camera {
+   mat4 projection; // camera projection matrix
+   mat4 view;  // represents the world coordinates in the camera coord space
+   vec3 camPosition; // so we can compute the view vector (could be extracted from view matrix, but let's make our life easier :) )
+};
 
 // send shaded color to the fragment shader
 out vec4 shadedColor;
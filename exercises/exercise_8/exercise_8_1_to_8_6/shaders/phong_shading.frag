@@ -1,6 +1,11 @@
 #version 330 core
 
-uniform vec3 camPosition; // so we can compute the view vector
+// the camera, the same for every draw of a frame, uploaded once for all the programs (see uniform_buffer.h)
+layout (std140) uniform Camera {
+   mat4 projection; // camera projection matrix
+   mat4 view;  // represents the world coordinates in the camera coord space
+   vec3 camPosition; // so we can compute the view vector (could be extracted from view matrix, but let's make our life easier :) )
+};
 out vec4 FragColor; // the output color of this fragment
 
 // TODO exercise 8.4 setup the 'uniform' variables needed for lighting
@@ -10,6 +10,8 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "uniform_buffer.h"
+#include "render_queue.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -18,6 +20,7 @@
 // function declarations
 // ---------------------
 void drawObjects();
+void setMaterial(unsigned int program, uint32_t material);
 void drawGui();
 
 // glfw and input functions
@@ -33,22 +36,68 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
+// the shader files are read from the source directory when the build gives it, so editing them there reloads the
+// programs while the exercise runs, else from the copy next to the executable
+#ifdef SHADER_SOURCE_DIR
+#define shaderDirectory SHADER_SOURCE_DIR
+#else
+#define shaderDirectory "shaders/"
+#endif
+
 // global variables used for rendering
 // -----------------------------------
 Shader* shader;
-Shader* gouraud_shading;
-Shader* phong_shading;
+// every lighting program is built from shaders/lighting.glsl, with the #define keys of the settings in the gui
+// (see ShaderPermutations in shader.h and lightingDefines() below), and built again when the file is saved
+ShaderPermutations* lighting;
 Model* carModel;
 Model* carWheel;
 Model* floorModel;
+ModelLoader* modelLoader;
+MeshArena* meshArena;
 Camera camera(glm::vec3(0.0f, 1.6f, 5.0f));
 
+// the uniforms that are the same for every draw of a frame are uploaded once per frame, to uniform buffers that both
+// programs read (see uniform_buffer.h), the members follow the std140 layout of the blocks in the shaders
+struct CameraBlock {
+    alignas(16) glm::mat4 projection;
+    alignas(16) glm::mat4 view;
+    alignas(16) glm::vec3 camPosition;
+};
+CameraBlock cameraBlock;
+UniformBuffer<CameraBlock>* cameraBuffer;
+const int maxLights = 2; // MAX_LIGHTS in the shaders
+struct LightsBlock {
+    alignas(16) glm::vec3 ambientLightColor;
+    float attenuationC0;
+    float attenuationC1;
+    float attenuationC2;
+    alignas(16) glm::vec4 lightPositions[maxLights];
+    alignas(16) glm::vec4 lightColors[maxLights];
+};
+LightsBlock lightsBlock;
+UniformBuffer<LightsBlock>* lightsBuffer;
+
+// the uniforms set for every material, looked up by name once and not in every draw (see Shader::uniform), the
+// matrices of each draw are set by the render queue below
+struct Uniforms {
+    Shader::Uniform reflectionColor = Shader::uniform("reflectionColor");
+    Shader::Uniform model = Shader::uniform("model");
+    Shader::Uniform invTransposeModel = Shader::uniform("invTransposeModel");
+} uniforms;
+
+// the draws of the frame, sorted by program and material before they are issued (see render_queue.h), the queue sets
+// model and invTransposeModel (at the locations the shader keeps), and calls setMaterial() when the material changes
+RenderQueue renderQueue;
+enum Material : uint32_t { carMaterial, floorMaterial };
+
 // global variables used for control
 // ---------------------------------
 float lastX = (float)SCR_WIDTH / 2.0;
 float lastY = (float)SCR_HEIGHT / 2.0;
 float deltaTime;
 bool isPaused = false; // stop camera movement when GUI is open
+unsigned int culledMeshlets = 0; // in the last frame
 
 
 // structure to hold lighting info
@@ -81,8 +130,29 @@ struct Config {
     float attenuationC1 = 0.1;
     float attenuationC2 = 0.1;
 
+    // the lighting program: Phong or Gouraud shading, how many of the lights are lit, and with attenuation or not
+    bool phongShading = true;
+    int lightCount = maxLights;
+    bool attenuation = true;
+
+    // levels of detail: the error of the level drawn covers at most this many pixels
+    float lodPixelError = 1.0f;
+
+    // meshlets: skip the ones outside of the view, and the ones facing away from the camera (the models are not all
+    // closed, e.g. the floor, so that one is off by default)
+    bool cullMeshlets = true;
+    bool cullMeshletBackfaces = false;
+
 } config;
 
+// the #define keys of the lighting program that draws with the current config
+Shader::Defines lightingDefines(){
+    return {{"SHADING", config.phongShading ? "PHONG_SHADING" : "GOURAUD_SHADING"},
+            {"NUM_LIGHTS", std::to_string(config.lightCount)},
+            {"ATTENUATION", config.attenuation ? "1" : "0"},
+            {"MAX_LIGHTS", std::to_string(maxLights)}};
+}
+
 
 
 int main()
@@ -125,12 +195,21 @@ int main()
 
     // load the shaders and the 3D models
     // ----------------------------------
-    gouraud_shading = new Shader("shaders/gouraud_shading.vert", "shaders/gouraud_shading.frag");
-    phong_shading = new Shader("shaders/phong_shading.vert", "shaders/phong_shading.frag");
-    shader = phong_shading;//gouraud_shading;
-    carModel = new Model(std::vector<string>{"car/Body_LOD0.obj", "car/Interior_LOD0.obj", "car/Paint_LOD0.obj", "car/Light_LOD0.obj", "car/Windows_LOD0.obj"});
-    carWheel = new Model("car/Wheel_LOD0.obj");
-    floorModel = new Model("floor/floor.obj");
+    cameraBuffer = new UniformBuffer<CameraBlock>(0);
+    lightsBuffer = new UniformBuffer<LightsBlock>(1);
+    lighting = new ShaderPermutations(shaderDirectory "lighting.glsl", shaderDirectory "lighting.glsl");
+    lighting->bindUniformBlock("Camera", cameraBuffer->getBinding());
+    lighting->bindUniformBlock("Lights", lightsBuffer->getBinding());
+    lighting->watch();
+    renderQueue.setMaterials(setMaterial);
+    // the models are loaded on worker threads and uploaded a bit every frame (see ModelLoader in model.h),
+    // so the window shows up right away, and each model appears when it is ready
+    // all the meshes share the buffers of one arena, so each model is drawn with one draw call per index type
+    meshArena = new MeshArena();
+    modelLoader = new ModelLoader(0, meshArena);
+    carModel = new Model(std::vector<string>{"car/Body_LOD0.obj", "car/Interior_LOD0.obj", "car/Paint_LOD0.obj", "car/Light_LOD0.obj", "car/Windows_LOD0.obj"}, *modelLoader);
+    carWheel = new Model(std::vector<string>{"car/Wheel_LOD0.obj"}, *modelLoader);
+    floorModel = new Model(std::vector<string>{"floor/floor.obj"}, *modelLoader);
 
     // set up the z-buffer
     // -------------------
@@ -161,9 +240,15 @@ int main()
 
         processInput(window);
 
+        // upload the models that finished loading, for at most 2 ms per frame
+        modelLoader->update(0.002f);
+
         glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // swap in the lighting programs rebuilt after an edit of the shader file, and pick the one of the settings
+        lighting->update();
+        shader = lighting->get(lightingDefines());
         shader->use();
         drawObjects();
 
@@ -181,11 +266,14 @@ int main()
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    delete modelLoader;
     delete carModel;
     delete floorModel;
     delete carWheel;
-    delete gouraud_shading;
-    delete phong_shading;
+    delete meshArena;
+    delete lighting;
+    delete cameraBuffer;
+    delete lightsBuffer;
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -238,11 +326,24 @@ void drawGui(){
         ImGui::SliderFloat("attenuation c2", &config.attenuationC2, 0.0f, 1.0f);
         ImGui::Separator();
 
+        ImGui::Text("Level of detail: ");
+        ImGui::SliderFloat("max error (pixels)", &config.lodPixelError, 0.0f, 20.0f);
+        ImGui::Separator();
+
+        ImGui::Text("Meshlet culling: ");
+        ImGui::Checkbox("view frustum", &config.cullMeshlets);
+        ImGui::Checkbox("back faces", &config.cullMeshletBackfaces);
+        ImGui::Text("%u meshlets culled", culledMeshlets);
+        ImGui::Separator();
+
         ImGui::Text("Shading model: ");
         {
-            if (ImGui::RadioButton("Gouraud Shading", shader == gouraud_shading)) { shader = gouraud_shading; }
-            if (ImGui::RadioButton("Phong Shading", shader == phong_shading)) { shader = phong_shading; }
+            if (ImGui::RadioButton("Gouraud Shading", !config.phongShading)) { config.phongShading = false; }
+            if (ImGui::RadioButton("Phong Shading", config.phongShading)) { config.phongShading = true; }
         }
+        ImGui::SliderInt("lights", &config.lightCount, 0, maxLights);
+        ImGui::Checkbox("attenuation", &config.attenuation);
+        ImGui::Text("%zu lighting programs built", lighting->size());
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
         ImGui::End();
     }
@@ -255,28 +356,25 @@ void drawGui(){
 
 void drawObjects(){
 
-    // camera position
-    shader->setVec3("camPosition", camera.Position);
-
     // TODO exercise 8 - set the missing uniform variables here
-    // light uniforms
-    shader->setVec3("ambientLightColor", config.ambientLightColor * config.ambientLightIntensity);
-    shader->setVec3("light1Position", config.light1Position);
-    shader->setVec3("light1Color", config.light1Color * config.light1Intensity);
-    shader->setVec3("light2Position", config.light2Position);
-    shader->setVec3("light2Color", config.light2Color * config.light2Intensity);
-
-    // material uniforms
-    shader->setVec3("reflectionColor", config.reflectionColor);
+    // light uniforms, in the Lights uniform buffer
+    lightsBlock.ambientLightColor = config.ambientLightColor * config.ambientLightIntensity;
+    lightsBlock.lightPositions[0] = glm::vec4(config.light1Position, 1.0f);
+    lightsBlock.lightColors[0] = glm::vec4(config.light1Color * config.light1Intensity, 1.0f);
+    lightsBlock.lightPositions[1] = glm::vec4(config.light2Position, 1.0f);
+    lightsBlock.lightColors[1] = glm::vec4(config.light2Color * config.light2Intensity, 1.0f);
+
+    // material uniforms (the reflection color is the one of the material of each draw, see setMaterial())
     shader->setFloat("ambientReflectance", config.ambientReflectance);
     shader->setFloat("diffuseReflectance", config.diffuseReflectance);
     shader->setFloat("specularReflectance", config.specularReflectance);
     shader->setFloat("specularExponent", config.specularExponent);
 
-    // attenuation uniforms
-    shader->setFloat("attenuationC0", config.attenuationC0);
-    shader->setFloat("attenuationC1", config.attenuationC1);
-    shader->setFloat("attenuationC2", config.attenuationC2);
+    // attenuation uniforms, in the Lights uniform buffer as well
+    lightsBlock.attenuationC0 = config.attenuationC0;
+    lightsBlock.attenuationC1 = config.attenuationC1;
+    lightsBlock.attenuationC2 = config.attenuationC2;
+    lightsBuffer->update(lightsBlock);
 
 
     // the typical transformation uniforms are already set for you, these are:
@@ -290,58 +388,66 @@ void drawObjects(){
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 viewProjection = projection * view;
+    float lodPixelScale = meshsimplifier::pixelScale(glm::radians(camera.Zoom), (float)SCR_HEIGHT);
+    culledMeshlets = 0;
 
-    // set projection and view matrix uniforms
-    shader->setMat4("projection", projection);
-    shader->setMat4("view", view);
+    // set projection and view matrix uniforms, and the camera position, in the Camera uniform buffer
+    cameraBlock.projection = projection;
+    cameraBlock.view = view;
+    cameraBlock.camPosition = camera.Position;
+    cameraBuffer->update(cameraBlock);
 
     // NEW! we use the Model class to load the geometry and dispatch the render commands to OpenGL
+    // the models are added to the render queue with their material and model matrix, and submit() draws them, each
+    // with the coarsest level of detail that looks the same within config.lodPixelError pixels, and its meshlets
+    // outside of the view culled
+    renderQueue.begin(viewProjection);
+    renderQueue.setLocations(shader->ID, shader->getLocation(uniforms.model),
+                             shader->getLocation(uniforms.invTransposeModel));
+    auto queueModel = [&](Model *object, Material material, const glm::mat4 &model){
+        renderQueue.add(shader->ID, 0, material, renderQueue.transform(model), [&, object](const glm::mat4 &model){
+            object->selectLod(model, camera.Position, lodPixelScale, config.lodPixelError);
+            if (config.cullMeshlets)
+                culledMeshlets += object->cull(model, viewProjection, config.cullMeshletBackfaces);
+            object->Draw();
+        });
+    };
+
     // draw car
-    glm::mat4 model = glm::mat4(1.0f);
-    shader->setMat4("model", model);
-    glm::mat4 invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    carModel->Draw();
+    queueModel(carModel, carMaterial, glm::mat4(1.0f));
 
     // draw wheel
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(-.7432, .328, 1.39));
-    shader->setMat4("model", model);
-    invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    carWheel->Draw();
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(-.7432, .328, 1.39));
+    queueModel(carWheel, carMaterial, model);
 
     // draw wheel
     model = glm::translate(glm::mat4(1.0f), glm::vec3(-.7432, .328, -1.39));
-    shader->setMat4("model", model);
-    invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    carWheel->Draw();
+    queueModel(carWheel, carMaterial, model);
 
     // draw wheel
     model = glm::rotate(glm::mat4(1.0f), glm::pi<float>(), glm::vec3(0.0, 1.0, 0.0));
     model = glm::translate(model, glm::vec3(-.7432, .328, 1.39));
-    shader->setMat4("model", model);
-    invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    carWheel->Draw();
+    queueModel(carWheel, carMaterial, model);
 
     // draw wheel
     model = glm::rotate(glm::mat4(1.0f), glm::pi<float>(), glm::vec3(0.0, 1.0, 0.0));
     model = glm::translate(model, glm::vec3(-.7432, .328, -1.39));
-    shader->setMat4("model", model);
-    invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    carWheel->Draw();
+    queueModel(carWheel, carMaterial, model);
 
     // draw floor,
-    // NEW! notice that we overwrite the value of one of the uniform variables to set a different floor color
-    shader->setVec3("reflectionColor", .2, .5, .2);
+    // NEW! notice that the floor has a material of its own, with a different color (see setMaterial())
     model = glm::scale(glm::mat4(1.0), glm::vec3(5.f, 5.f, 5.f));
-    shader->setMat4("model", model);
-    invTransposeModel = glm::inverse(glm::transpose(model));
-    shader->setMat4("invTransposeModel", invTransposeModel);
-    floorModel->Draw();
+    queueModel(floorModel, floorMaterial, model);
+
+    renderQueue.submit();
+}
+
 
+void setMaterial(unsigned int program, uint32_t material){
+    if (material == floorMaterial)
+        shader->setVec3(uniforms.reflectionColor, .2, .5, .2);
+    else
+        shader->setVec3(uniforms.reflectionColor, config.reflectionColor);
 }
 
 
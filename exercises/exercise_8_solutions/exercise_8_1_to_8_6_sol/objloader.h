@@ -7,141 +7,70 @@
 #include <vector>
 #include <stdio.h>
 #include <string>
-#include <cstring>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 
-#include "objloader.h"
+#include "obj_parser.h"
 
-// Very, VERY simple OBJ loader.
+// Simple OBJ loader.
+// The file is parsed by obj_parser.h (memory mapped, multithreaded for big files), and the triangles are returned as
+// three arrays with one element per triangle corner (positions, texture coordinates and normals), not indexed.
 // Here is a short list of features a real function would provide :
 // - Binary files. Reading a model should be just a few memcpy's away, not parsing a file at runtime. In short : OBJ is not very great.
 // - Animations & bones (includes bones weights)
 // - Multiple UVs
 // - All attributes should be optional, not "forced"
-// - More stable. Change a line in the OBJ file and it crashes.
-// - More secure. Change another line and you can inject code.
 // - Loading from memory, stream, etc
 
 
-
-bool loadOBJ(
-        const char * path,
-        std::vector<float> & out_vertices,
-        std::vector<float> & out_uvs,
-        std::vector<float> & out_normals
-){
+// parses the file at path, returns false (after printing why) if it can't be opened or read
+bool loadOBJData(const char * path, obj::Data & data){
     printf("Loading OBJ file %s...\n", path);
 
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<float> temp_vertices;
-    std::vector<float> temp_uvs;
-    std::vector<float> temp_normals;
-
-
-    FILE * file = fopen(path, "r");
-    if( file == NULL ){
+    obj::MappedFile file(path);
+    if( !file.isOpen() ){
         printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
         getchar();
         return false;
     }
-
-    while( 1 ){
-
-        char lineHeader[128];
-        // read the first word of the line
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
-            break; // EOF = End Of File. Quit the loop.
-
-        // else : parse lineHeader
-
-        if ( strcmp( lineHeader, "v" ) == 0 ){
-            float x, y, z;
-            fscanf(file, "%f %f %f\n", &x, &y, &z );
-            temp_vertices.push_back(x);
-            temp_vertices.push_back(y);
-            temp_vertices.push_back(z);
-        }else if ( strcmp( lineHeader, "vt" ) == 0 ){
-            float u, v;
-            fscanf(file, "%f %f\n", &u, &v );
-            v = -v; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-            temp_uvs.push_back(u);
-            temp_uvs.push_back(v);
-        }else if ( strcmp( lineHeader, "vn" ) == 0 ){
-            float nx, ny, nz;
-            fscanf(file, "%f %f %f\n", &nx, &ny, &nz );
-            temp_normals.push_back(nx);
-            temp_normals.push_back(ny);
-            temp_normals.push_back(nz);
-        }else if ( strcmp( lineHeader, "f" ) == 0 ){
-            std::string vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[4], uvIndex[4], normalIndex[4];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
-                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2],
-                                 &vertexIndex[3], &uvIndex[3], &normalIndex[3]);
-            if (matches != 9 && matches != 12){
-                printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-                fclose(file);
-                return false;
-            }
-            // triangle info
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
-            if (matches == 12){
-                // if a quad is defined, load as a second triangle
-                vertexIndices.push_back(vertexIndex[0]);
-                vertexIndices.push_back(vertexIndex[2]);
-                vertexIndices.push_back(vertexIndex[3]);
-                uvIndices    .push_back(uvIndex[0]);
-                uvIndices    .push_back(uvIndex[2]);
-                uvIndices    .push_back(uvIndex[3]);
-                normalIndices.push_back(normalIndex[0]);
-                normalIndices.push_back(normalIndex[2]);
-                normalIndices.push_back(normalIndex[3]);
-            }
-        }else{
-            // Probably a comment, eat up the rest of the line
-            char stupidBuffer[1000];
-            fgets(stupidBuffer, 1000, file);
-        }
-
+    if( !obj::parse(file.data(), file.data() + file.size(), data) ){
+        printf("%s: %s\n", path, data.error.c_str());
+        return false;
     }
+    // every corner needs a texture coordinate and a normal (faces must be v/t/n)
+    if( !data.hasUvsAndNormals() ){
+        printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+        return false;
+    }
+    return true;
+}
 
-    // For each vertex of each triangle
-    for( unsigned int i=0; i<vertexIndices.size(); i++ ){
-
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
 
-        // Get the attributes thanks to the index
-        float x = temp_vertices[ (vertexIndex-1) * 3 ];
-        float y = temp_vertices[ (vertexIndex-1) * 3 +1 ];
-        float z = temp_vertices[ (vertexIndex-1) * 3 +2 ];
-        float u = temp_uvs[ (uvIndex-1) * 2 ];
-        float v = temp_uvs[ (uvIndex-1) * 2 +1 ];
-        float nx = temp_normals[ (normalIndex-1) * 3 ];
-        float ny = temp_normals[ (normalIndex-1) * 3 +1 ];
-        float nz = temp_normals[ (normalIndex-1) * 3 +2 ];
 
-        // Put the attributes in buffers
-        out_vertices.push_back(x); out_vertices.push_back(y); out_vertices.push_back(z);
-        out_uvs.push_back(u); out_uvs.push_back(v);
-        out_normals.push_back(nx); out_normals.push_back(ny); out_normals.push_back(nz);
+bool loadOBJ(
+        const char * path,
+        std::vector<float> & out_vertices,
+        std::vector<float> & out_uvs,
+        std::vector<float> & out_normals
+){
+    obj::Data data;
+    if( !loadOBJData(path, data) )
+        return false;
 
+    // For each vertex of each triangle, put the attributes in buffers
+    size_t first = out_vertices.size() / 3, count = data.corners.size() / 3;
+    out_vertices.resize((first + count) * 3);
+    out_uvs.resize((first + count) * 2);
+    out_normals.resize((first + count) * 3);
+    for( size_t i=0; i<count; i++ ){
+        const uint32_t * corner = &data.corners[i * 3];
+        std::copy_n(&data.positions[corner[0] * 3], 3, &out_vertices[(first + i) * 3]);
+        out_uvs[(first + i) * 2] = data.uvs[corner[1] * 2];
+        // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
+        out_uvs[(first + i) * 2 + 1] = -data.uvs[corner[1] * 2 + 1];
+        std::copy_n(&data.normals[corner[2] * 3], 3, &out_normals[(first + i) * 3]);
     }
-    fclose(file);
     return true;
 }
 
@@ -153,106 +82,25 @@ bool loadOBJ(
         std::vector<glm::vec2> & out_uvs,
         std::vector<glm::vec3> & out_normals
 ){
-    printf("Loading OBJ file %s...\n", path);
-
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> temp_vertices;
-    std::vector<glm::vec2> temp_uvs;
-    std::vector<glm::vec3> temp_normals;
-
-
-    FILE * file = fopen(path, "r");
-    if( file == NULL ){
-        printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
-        getchar();
+    obj::Data data;
+    if( !loadOBJData(path, data) )
         return false;
-    }
-
-    while( 1 ){
-
-        char lineHeader[128];
-        // read the first word of the line
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
-            break; // EOF = End Of File. Quit the loop.
-
-        // else : parse lineHeader
-
-        if ( strcmp( lineHeader, "v" ) == 0 ){
-            glm::vec3 vertex;
-            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z );
-            temp_vertices.push_back(vertex);
-        }else if ( strcmp( lineHeader, "vt" ) == 0 ){
-            glm::vec2 uv;
-            fscanf(file, "%f %f\n", &uv.x, &uv.y );
-            uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-            temp_uvs.push_back(uv);
-        }else if ( strcmp( lineHeader, "vn" ) == 0 ){
-            glm::vec3 normal;
-            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z );
-            temp_normals.push_back(normal);
-        }else if ( strcmp( lineHeader, "f" ) == 0 ){
-            unsigned int vertexIndex[4], uvIndex[4], normalIndex[4];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
-                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2],
-                                 &vertexIndex[3], &uvIndex[3], &normalIndex[3]);
-            if (matches != 9 && matches != 12){
-                printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-                fclose(file);
-                return false;
-            }
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
-
-            if (matches == 12){
-                // if a quad is defined, load as a second triangle
-                vertexIndices.push_back(vertexIndex[0]);
-                vertexIndices.push_back(vertexIndex[2]);
-                vertexIndices.push_back(vertexIndex[3]);
-                uvIndices    .push_back(uvIndex[0]);
-                uvIndices    .push_back(uvIndex[2]);
-                uvIndices    .push_back(uvIndex[3]);
-                normalIndices.push_back(normalIndex[0]);
-                normalIndices.push_back(normalIndex[2]);
-                normalIndices.push_back(normalIndex[3]);
-            }
-        }else{
-            // Probably a comment, eat up the rest of the line
-            char stupidBuffer[1000];
-            fgets(stupidBuffer, 1000, file);
-        }
-
-    }
-
-    // For each vertex of each triangle
-    for( unsigned int i=0; i<vertexIndices.size(); i++ ){
-
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-
-        // Get the attributes thanks to the index
-        glm::vec3 vertex = temp_vertices[ vertexIndex-1 ];
-        glm::vec2 uv = temp_uvs[ uvIndex-1 ];
-        glm::vec3 normal = temp_normals[ normalIndex-1 ];
-
-        // Put the attributes in buffers
-        out_vertices.push_back(vertex);
-        out_uvs     .push_back(uv);
-        out_normals .push_back(normal);
 
+    // For each vertex of each triangle, put the attributes in buffers
+    size_t first = out_vertices.size(), count = data.corners.size() / 3;
+    out_vertices.resize(first + count);
+    out_uvs.resize(first + count);
+    out_normals.resize(first + count);
+    for( size_t i=0; i<count; i++ ){
+        const uint32_t * corner = &data.corners[i * 3];
+        const float * position = &data.positions[corner[0] * 3];
+        const float * uv = &data.uvs[corner[1] * 2];
+        const float * normal = &data.normals[corner[2] * 3];
+        out_vertices[first + i] = glm::vec3(position[0], position[1], position[2]);
+        // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
+        out_uvs[first + i] = glm::vec2(uv[0], -uv[1]);
+        out_normals[first + i] = glm::vec3(normal[0], normal[1], normal[2]);
     }
-    fclose(file);
     return true;
 }
 
@@ -0,0 +1,136 @@
+#version 330 core
+// the vertex and the fragment shader of all the lighting programs, the program in use is chosen with #define keys
+// (see ShaderPermutations in shader.h), each program only has the code it runs:
+//   SHADING      GOURAUD_SHADING (lighting computed per vertex) or PHONG_SHADING (per fragment)
+//   NUM_LIGHTS   the number of lights that are lit, from 0 to MAX_LIGHTS
+//   ATTENUATION  1 if the light decreases with the distance, else 0
+//   MAX_LIGHTS   the size of the arrays of lights in the Lights block, the same for every program
+#define GOURAUD_SHADING 0
+#define PHONG_SHADING 1
+#ifndef SHADING
+#define SHADING PHONG_SHADING
+#endif
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 2
+#endif
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS MAX_LIGHTS
+#endif
+#ifndef ATTENUATION
+#define ATTENUATION 1
+#endif
+
+// the camera, the same for every draw of a frame, uploaded once for all the programs (see uniform_buffer.h)
+layout (std140) uniform Camera {
+   mat4 projection; // camera projection matrix
+   mat4 view;  // represents the world coordinates in the camera coord space
+   vec3 camPosition; // so we can compute the view vector (could be extracted from view matrix, but let's make our life easier :) )
+};
+
+// the lights, the same for every draw of a frame, uploaded once for all the programs (see uniform_buffer.h)
+layout (std140) uniform Lights {
+   vec3 ambientLightColor;
+   // attenuation
+   float attenuationC0;
+   float attenuationC1;
+   float attenuationC2;
+   // xyz only, vec4 because std140 puts the elements of an array 16 bytes apart anyway
+   vec4 lightPositions[MAX_LIGHTS];
+   vec4 lightColors[MAX_LIGHTS];
+};
+
+// material properties
+uniform vec3 reflectionColor;
+uniform float ambientReflectance;
+uniform float diffuseReflectance;
+uniform float specularReflectance;
+uniform float specularExponent;
+
+// Phong reflection model of the point P with normal N in world space, summed over the lights
+vec3 shade(vec3 P, vec3 N) {
+   // ambient
+   vec3 color = ambientLightColor * ambientReflectance * reflectionColor;
+   for (int i = 0; i < NUM_LIGHTS; i++) {
+      vec3 lightPosition = lightPositions[i].xyz;
+      vec3 lightColor = lightColors[i].rgb;
+
+      // diffuse
+      vec3 L = normalize(lightPosition - P);
+      float diffuseModulation = max(dot(N, L), 0.0);
+      vec3 diffuse = lightColor * diffuseReflectance * diffuseModulation * reflectionColor;
+
+      // specular
+      vec3 R =  -L - 2 * dot(-L, N) * N; // the same as reflect(-L_eye, normal)
+      float specModulation = pow(max(dot(R, normalize(camPosition - P)), 0.0), specularExponent);
+      vec3 specular = lightColor * specularReflectance * specModulation;
+      // notice that I did not use the material color (reflectionColor) in the specular, that is because most
+      // materials do not affect the specular highlight color, with exception of metals (you can play with that)
+
+#if ATTENUATION
+      float distance = length(lightPosition - P);
+      float attenuation =  1.0 / (attenuationC0 + attenuationC1 * distance + attenuationC2 * distance * distance);
+#else
+      float attenuation = 1.0;
+#endif
+      color += (diffuse + specular) * attenuation;
+   }
+   return color;
+}
+
+
+#ifdef VERTEX_SHADER
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 textCoord; // here for completness, but we are not using it just yet
+
+uniform mat4 model; // represents model coordinates in the world coord space
+uniform mat4 invTransposeModel; // inverse of the transpose of model (used to multiply vectors while preserving angles)
+
+#if SHADING == GOURAUD_SHADING
+// send shaded color to the fragment shader
+out vec4 shadedColor;
+#else
+// the position and normal in world space, interpolated for the fragment shader
+out vec3 P_frag;
+out vec3 N_frag;
+#endif
+
+void main() {
+   // vertex in world space (for lighting computation)
+   vec4 P = model * vec4(vertex, 1.0);
+   // normal in world space (for lighting computation)
+   vec3 N = normalize((invTransposeModel * vec4(normal, 0.0)).xyz);
+
+   // final vertex transform (for opengl rendering, not for lighting)
+   gl_Position = projection * view * P;
+
+#if SHADING == GOURAUD_SHADING
+   shadedColor = vec4(shade(P.xyz, N), 1);
+#else
+   P_frag = P.xyz;
+   N_frag = N;
+#endif
+}
+#endif
+
+
+#ifdef FRAGMENT_SHADER
+out vec4 FragColor; // the output color of this fragment
+
+#if SHADING == GOURAUD_SHADING
+in vec4 shadedColor;
+#else
+in vec3 P_frag;
+in vec3 N_frag;
+#endif
+
+void main()
+{
+#if SHADING == GOURAUD_SHADING
+   // we pass through the interpolated color since lighting was already computed in the vertex shader
+   FragColor = shadedColor;
+#else
+   FragColor = vec4(shade(P_frag, N_frag), 1);
+#endif
+}
+#endif
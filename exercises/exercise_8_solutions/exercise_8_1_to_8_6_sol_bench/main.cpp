@@ -0,0 +1,214 @@
+// load time benchmark and regression check of the OBJ loader of exercise 8 (objloader.h, obj_parser.h)
+//
+// every model is loaded with the scanf based loader exercise 8 used before (objloader_reference.h) and with loadOBJ,
+// the results must be the same, bit for bit. The parse time of obj_parser.h is measured with one thread and with all
+// the threads, and the chunked parse must give the same result as the single threaded one.
+// Besides the models of the repository, a big model is generated (a grid of quads, with numbers written in several
+// formats), to measure the speed on multi-million triangle files.
+// The number parser is also compared to strtof on random numbers, and on numbers close to the halfway point between
+// two floats.
+//
+// usage: exercise_8_1_to_8_6_sol_bench [--runs N] [--threads N] [--triangles N] [model.obj ...]
+//   --runs       number of loads measured per configuration, the fastest is reported (default 3)
+//   --threads    threads of the multithreaded parse (default is one per core)
+//   --triangles  triangles of the generated model (default 2000000, 0 to skip it)
+// the exit code is 1 if any result is different
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+#include "objloader.h"
+#include "objloader_reference.h"
+
+#ifndef MODELS_DIR
+#define MODELS_DIR "models"
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+bool benchmarkModel(const std::string &path, unsigned int runs, unsigned int threads);
+bool writeGeneratedModel(const std::string &path, unsigned int triangles);
+bool checkNumberParser(unsigned int count);
+
+template<class T>
+bool sameBits(const std::vector<T> &a, const std::vector<T> &b){
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool sameData(const obj::Data &a, const obj::Data &b){
+    return sameBits(a.positions, b.positions) && sameBits(a.uvs, b.uvs) &&
+           sameBits(a.normals, b.normals) && sameBits(a.corners, b.corners);
+}
+
+// runs f runs times and returns the fastest time, in ms
+template<class F>
+double fastest(unsigned int runs, F f){
+    double best = 1e30;
+    for (unsigned int i = 0; i < runs; i++) {
+        Clock::time_point start = Clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned int runs = 3;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int triangles = 2000000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = std::max(0, std::atoi(argv[++i]));
+        else if (argv[i][0] != '-') paths.push_back(argv[i]);
+        else {
+            std::cout << "usage: " << argv[0] << " [--runs N] [--threads N] [--triangles N] [model.obj ...]" << std::endl;
+            return 2;
+        }
+    }
+
+    // the models exercise 8 loads
+    if (paths.empty()) {
+        std::string models = MODELS_DIR;
+        for (const char *name : {"Body", "Interior", "Paint", "Light", "Windows", "Wheel"})
+            paths.push_back(models + "/car/" + name + "_LOD0.obj");
+        paths.push_back(models + "/floor/floor.obj");
+    }
+    std::string generated;
+    if (triangles > 0) {
+        generated = "exercise_8_bench_generated.obj";
+        if (!writeGeneratedModel(generated, triangles)) {
+            std::cout << "can not write " << generated << std::endl;
+            return 1;
+        }
+        paths.push_back(generated);
+    }
+
+    bool ok = checkNumberParser(1000000);
+    for (const std::string &path : paths)
+        ok &= benchmarkModel(path, runs, threads);
+
+    if (!generated.empty())
+        std::remove(generated.c_str());
+    std::cout << (ok ? "all results match" : "RESULTS DIFFER") << std::endl;
+    return ok ? 0 : 1;
+}
+
+
+bool benchmarkModel(const std::string &path, unsigned int runs, unsigned int threads)
+{
+    obj::MappedFile file(path.c_str());
+    if (!file.isOpen()) {
+        std::cout << path << ": not found, skipped" << std::endl;
+        return true;
+    }
+    double megabytes = file.size() / (1024.0 * 1024.0);
+
+    // the reference is slow, it is only loaded once
+    std::vector<glm::vec3> refVertices, vertices;
+    std::vector<glm::vec2> refUvs, uvs;
+    std::vector<glm::vec3> refNormals, normals;
+    double reference = fastest(1, [&]{ loadOBJReference(path.c_str(), refVertices, refUvs, refNormals); });
+    bool loaded = loadOBJ(path.c_str(), vertices, uvs, normals);
+    bool same = loaded && sameBits(vertices, refVertices) && sameBits(uvs, refUvs) && sameBits(normals, refNormals);
+
+    obj::Data single, multi;
+    double singleTime = fastest(runs, [&]{ obj::parse(file.data(), file.data() + file.size(), single, 1); });
+    double multiTime = fastest(runs, [&]{ obj::parse(file.data(), file.data() + file.size(), multi, threads); });
+    same &= sameData(single, multi);
+
+    printf("%s: %.1f MB, %zu triangles\n", path.c_str(), megabytes, single.triangleCount());
+    printf("  scanf reference     %10.1f ms %8.1f MB/s\n", reference, megabytes * 1000.0 / reference);
+    printf("  obj_parser 1 thread %10.1f ms %8.1f MB/s  x%.1f\n", singleTime, megabytes * 1000.0 / singleTime, reference / singleTime);
+    printf("  obj_parser %2u threads %8.1f ms %8.1f MB/s  x%.1f\n", threads, multiTime, megabytes * 1000.0 / multiTime, reference / multiTime);
+    if (!same)
+        printf("  RESULT DIFFERS from the reference (%zu / %zu corners)\n", vertices.size(), refVertices.size());
+    return same;
+}
+
+
+// a grid of quads, with a vertex, uv and normal per grid point, the numbers are written in the formats exporters use
+bool writeGeneratedModel(const std::string &path, unsigned int triangles)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    unsigned int side = std::max(2u, (unsigned int) std::sqrt(triangles / 2.0) + 1);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> jitter(-1.f, 1.f);
+    const char *formats[] = {"%f", "%.6f", "%g", "%.9g", "%e"};
+    auto number = [&](float value){
+        char text[64];
+        snprintf(text, sizeof(text), formats[random() % 5], value);
+        return std::string(text);
+    };
+    fprintf(file, "# generated by exercise_8_1_to_8_6_sol_bench\no grid\n");
+    for (unsigned int y = 0; y < side; y++)
+        for (unsigned int x = 0; x < side; x++)
+            fprintf(file, "v %s %s %s\n", number(x + jitter(random) * .25f).c_str(),
+                    number(jitter(random) * 1e-3f).c_str(), number(y * -1.5f).c_str());
+    for (unsigned int y = 0; y < side; y++)
+        for (unsigned int x = 0; x < side; x++)
+            fprintf(file, "vt %s %s\n", number(x / float(side - 1)).c_str(), number(y / float(side - 1)).c_str());
+    for (unsigned int y = 0; y < side; y++)
+        for (unsigned int x = 0; x < side; x++)
+            fprintf(file, "vn %s %s %s\n", number(jitter(random)).c_str(), number(1.f).c_str(), number(jitter(random)).c_str());
+    fprintf(file, "usemtl grid\ns 1\n");
+    // quads and triangles, like the exporters write them
+    for (unsigned int y = 0; y + 1 < side; y++)
+        for (unsigned int x = 0; x + 1 < side; x++) {
+            unsigned int a = y * side + x + 1, b = a + 1, c = a + side + 1, d = a + side;
+            if ((x + y) % 2)
+                fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d);
+            else
+                fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                        a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+        }
+    return fclose(file) == 0;
+}
+
+
+// obj::detail::parseFloat must round every number like strtof
+bool checkNumberParser(unsigned int count)
+{
+    std::mt19937_64 random(11);
+    unsigned int differences = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        char text[64];
+        uint64_t bits = random();
+        switch (i % 6) {
+            // any float, written with enough digits to be exact, or as it is printed by %f and %e
+            case 0: { uint32_t b = (uint32_t) bits; float f; std::memcpy(&f, &b, 4); if (f != f || std::isinf(f)) f = 1.f;
+                      snprintf(text, sizeof(text), "%.9g", f); break; }
+            case 1: snprintf(text, sizeof(text), "%f", (double) (int64_t) bits / (double) (1ull << (bits % 60))); break;
+            case 2: snprintf(text, sizeof(text), "%e", (double) (int64_t) bits * 1e-20); break;
+            // long mantissas, and numbers close to the halfway point between two floats
+            case 3: snprintf(text, sizeof(text), "%.25f", (double) (bits % 100000000) / 16777216.0); break;
+            // the halfway point between a float and the next one, with 15 to 17 digits: the closest double is often
+            // the halfway point itself, and a parser that rounds to a double first then rounds it to the wrong float
+            default: { uint32_t b = 0x20000000u + (uint32_t) (bits % 0x3E000000u); float f; std::memcpy(&f, &b, 4);
+                       double halfway = ((double) f + (double) std::nextafter(f, INFINITY)) * .5;
+                       snprintf(text, sizeof(text), "%.*g", 15 + (int) ((bits >> 32) % 3), halfway); break; }
+        }
+        float expected = strtof(text, nullptr), parsed = 0.f;
+        const char *end = obj::detail::parseFloat(text, text + std::strlen(text), parsed);
+        if (!end || *end != '\0' || std::memcmp(&expected, &parsed, 4) != 0) {
+            if (differences++ < 5)
+                printf("  %s: parsed %.9g, strtof %.9g\n", text, parsed, expected);
+        }
+    }
+    printf("number parser: %u numbers, %u different from strtof\n", count, differences);
+    return differences == 0;
+}
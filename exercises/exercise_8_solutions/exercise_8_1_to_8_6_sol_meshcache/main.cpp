@@ -0,0 +1,208 @@
+// converts OBJ files to mesh files (see include/mesh_cache.h), the binary format exercise 8 loads its models from
+//
+// exercise 8 builds the mesh file of a model the first time it loads it, this tool builds them ahead of time (e.g. to
+// ship them with the models), and prints what a mesh file contains.
+// The vertex cache efficiency of the triangle order (see include/mesh_optimizer.h) is printed before and after the
+// optimization, and for the meshlets the file stores, as ACMR (vertex shader runs per triangle) and ATVR (runs per
+// vertex) of FIFO caches of 16 and 32 vertices, then the levels of detail with their triangles and error, and the
+// meshlets (see include/meshlets.h) each level is split in.
+//
+// usage: exercise_8_1_to_8_6_sol_meshcache [--threads N] [--no-optimize] [--lods N] [-o output.mesh] model.obj ...
+//        exercise_8_1_to_8_6_sol_meshcache --info file.mesh ...
+//   -o             where the mesh file is written, only with one OBJ file (default is model.obj.mesh, the cache
+//                  exercise 8 looks for)
+//   --threads      threads used to parse the OBJ files (default is one per core)
+//   --no-optimize  keeps the triangles and vertices in the order of the OBJ file, so the file has no meshlets (they
+//                  reorder the triangles) and exercise 8 draws the levels whole
+//   --lods         levels of detail built after the full mesh (default 4, 0 for none)
+//   --info         prints the header, the submeshes, the vertex cache efficiency, the levels of detail and the
+//                  meshlets of mesh files
+// the exit code is 1 if a file can not be converted or read
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "mesh_cache.h"
+
+typedef std::chrono::steady_clock Clock;
+
+bool convert(const std::string &path, const std::string &output, unsigned int threads, bool optimize,
+             unsigned int lodCount);
+bool printInfo(const std::string &path);
+
+double milliseconds(Clock::time_point start){
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printCacheStats(const char *label, const uint32_t *indices, size_t indexCount, size_t vertexCount){
+    using meshoptimizer::analyzeVertexCache;
+    meshoptimizer::CacheStats fifo16 = analyzeVertexCache(indices, indexCount, vertexCount, 16);
+    meshoptimizer::CacheStats fifo32 = analyzeVertexCache(indices, indexCount, vertexCount, 32);
+    printf("  %-10s ACMR %.3f / %.3f, ATVR %.3f / %.3f (FIFO 16 / 32)\n", label, fifo16.acmr, fifo32.acmr,
+           fifo16.atvr, fifo32.atvr);
+}
+
+void printLods(const meshcache::Lod *lods, uint32_t lodCount){
+    for (uint32_t i = 1; i < lodCount; i++)
+        printf("  LOD %u: %u triangles (%.1f%%) from index %u, error %g\n", i, lods[i].indexCount / 3,
+               100.0 * lods[i].indexCount / std::max(1u, lods[0].indexCount), lods[i].firstIndex, lods[i].error);
+}
+
+// how many meshlets each level has, how full they are, and how many have a normal cone narrow enough to be culled
+// when facing away from the camera
+void printMeshlets(const meshcache::Lod *lods, uint32_t lodCount, const meshlets::Meshlet *meshlets){
+    for (uint32_t i = 0; i < lodCount; i++) {
+        uint32_t cones = 0;
+        float radius = 0.f;
+        for (uint32_t j = lods[i].firstMeshlet; j < lods[i].firstMeshlet + lods[i].meshletCount; j++) {
+            cones += meshlets[j].coneCutoff < 1.f;
+            radius += meshlets[j].radius;
+        }
+        if (lods[i].meshletCount == 0)
+            continue;
+        printf("  LOD %u: %u meshlets, %.1f triangles and %g radius on average, %.1f%% with a normal cone\n", i,
+               lods[i].meshletCount, lods[i].indexCount / 3.0 / lods[i].meshletCount, radius / lods[i].meshletCount,
+               100.0 * cones / lods[i].meshletCount);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    bool info = false, optimize = true;
+    unsigned int threads = 0, lodCount = meshcache::defaultLodCount;
+    std::string output;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--info") == 0) info = true;
+        else if (std::strcmp(argv[i], "--no-optimize") == 0) optimize = false;
+        else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc) lodCount = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (argv[i][0] != '-') paths.push_back(argv[i]);
+        else paths.clear(), i = argc;
+    }
+    if (paths.empty() || (!output.empty() && (paths.size() > 1 || info))) {
+        std::cout << "usage: " << argv[0] << " [--threads N] [--no-optimize] [--lods N] [-o output.mesh]"
+                  << " model.obj ..."
+                  << std::endl;
+        std::cout << "       " << argv[0] << " --info file.mesh ..." << std::endl;
+        return 2;
+    }
+
+    bool ok = true;
+    for (const std::string &path : paths) {
+        if (info)
+            ok &= printInfo(path);
+        else
+            ok &= convert(path, output.empty() ? meshcache::cachePath(path) : output, threads, optimize, lodCount);
+    }
+    return ok ? 0 : 1;
+}
+
+
+bool convert(const std::string &path, const std::string &output, unsigned int threads, bool optimize,
+             unsigned int lodCount)
+{
+    meshcache::SourceKey source = {};
+    Clock::time_point start = Clock::now();
+    obj::MappedFile text(path.c_str());
+    if (!text.isOpen() || !meshcache::fileStatus(path.c_str(), source.size, source.modified)) {
+        printf("%s: can not open\n", path.c_str());
+        return false;
+    }
+    source.hash = meshcache::hashBytes(text.data(), text.size());
+    obj::Data data;
+    if (!obj::parse(text.data(), text.data() + text.size(), data, threads)) {
+        printf("%s: %s\n", path.c_str(), data.error.c_str());
+        return false;
+    }
+    double parseTime = milliseconds(start);
+
+    start = Clock::now();
+    meshcache::IndexedMesh mesh;
+    meshcache::buildIndexedMesh(data, mesh, false);
+    double buildTime = milliseconds(start);
+    std::vector<uint32_t> originalIndices = mesh.indices;
+    start = Clock::now();
+    if (optimize)
+        meshcache::optimizeIndexedMesh(mesh);
+    double optimizeTime = milliseconds(start);
+    std::vector<uint32_t> optimizedIndices = mesh.indices;
+    start = Clock::now();
+    meshcache::buildLods(mesh, lodCount);
+    double lodTime = milliseconds(start);
+    start = Clock::now();
+    if (optimize)
+        meshcache::buildMeshlets(mesh);
+    double meshletTime = milliseconds(start);
+    std::vector<char> bytes = meshcache::serialize(mesh, source);
+    if (!meshcache::writeFile(output, bytes)) {
+        printf("%s: can not write %s\n", path.c_str(), output.c_str());
+        return false;
+    }
+
+    // loading it back is what exercise 8 does at startup
+    start = Clock::now();
+    meshcache::MeshFile file;
+    if (!file.open(output)) {
+        printf("%s: %s\n", output.c_str(), file.error.c_str());
+        return false;
+    }
+    double loadTime = milliseconds(start);
+
+    printf("%s -> %s\n", path.c_str(), output.c_str());
+    printf("  %zu triangles, %zu corners -> %zu vertices (%.2f corners per vertex), %zu submeshes\n",
+           data.triangleCount(), mesh.indices.size(), mesh.vertices.size(),
+           mesh.vertices.empty() ? 0.0 : (double) mesh.indices.size() / mesh.vertices.size(), mesh.submeshes.size());
+    printf("  %.1f MB of OBJ text -> %.1f MB, parsed in %.1f ms, indexed in %.1f ms, optimized in %.1f ms, "
+           "levels of detail in %.1f ms, meshlets in %.1f ms, loaded back in %.1f ms\n", text.size() / 1048576.0,
+           bytes.size() / 1048576.0, parseTime, buildTime, optimizeTime, lodTime, meshletTime, loadTime);
+    printCacheStats("OBJ order", originalIndices.data(), originalIndices.size(), mesh.vertices.size());
+    if (optimize) {
+        printCacheStats("optimized", optimizedIndices.data(), optimizedIndices.size(), mesh.vertices.size());
+        // what the file stores: the meshlets start the cache over, in overdraw order
+        printCacheStats("meshlets", mesh.indices.data(), mesh.lods[0].indexCount, mesh.vertices.size());
+    }
+    printLods(mesh.lods.data(), (uint32_t) mesh.lods.size());
+    printMeshlets(mesh.lods.data(), (uint32_t) mesh.lods.size(), mesh.meshlets.data());
+    return true;
+}
+
+
+bool printInfo(const std::string &path)
+{
+    meshcache::MeshFile file;
+    if (!file.open(path)) {
+        printf("%s: %s\n", path.c_str(), file.error.c_str());
+        return false;
+    }
+    const meshcache::Header &header = file.header();
+    printf("%s: version %u, %llu bytes\n", path.c_str(), header.version, (unsigned long long) header.fileSize);
+    printf("  source: %llu bytes, modified %lld, hash %016llx\n", (unsigned long long) header.source.size,
+           (long long) header.source.modified, (unsigned long long) header.source.hash);
+    printf("  %u vertices (%u bytes each) at %llu, %u indices (%u bytes each) at %llu\n",
+           header.vertexCount, header.vertexStride, (unsigned long long) header.vertexOffset,
+           header.indexCount, header.indexSize, (unsigned long long) header.indexOffset);
+    printf("  bounds (%g %g %g) (%g %g %g)\n", header.boundsMin[0], header.boundsMin[1], header.boundsMin[2],
+           header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    std::vector<uint32_t> indices(file.lods()[0].indexCount);
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = file.index(file.lods()[0].firstIndex + i);
+    printCacheStats("triangles", indices.data(), indices.size(), header.vertexCount);
+    for (uint32_t i = 0; i < header.submeshCount; i++) {
+        const meshcache::Submesh &submesh = file.submeshes()[i];
+        printf("  submesh \"%s\": %u indices from %u, bounds (%g %g %g) (%g %g %g)\n", submesh.name,
+               submesh.indexCount, submesh.firstIndex, submesh.boundsMin[0], submesh.boundsMin[1], submesh.boundsMin[2],
+               submesh.boundsMax[0], submesh.boundsMax[1], submesh.boundsMax[2]);
+    }
+    printLods(file.lods(), header.lodCount);
+    printMeshlets(file.lods(), header.lodCount, file.meshlets());
+    return true;
+}
@@ -0,0 +1,307 @@
+// headless check of the on disk cache of linked shader programs (see include/program_cache.h)
+//
+// a hidden window gives an OpenGL context, so it runs without a display server with a software implementation
+// (e.g. Mesa llvmpipe: LIBGL_ALWAYS_SOFTWARE=1, under xvfb-run on Linux). A small program is built like Shader does:
+//  - cold: compiled and linked, then stored in the cache, the time of both is printed
+//  - warm: loaded from the cache in a new program object, the time is printed, and it must draw what the compiled
+//    program draws
+//  - the files the cache must refuse (truncated, with a corrupted binary, with a wrong magic) are refused, and the
+//    program they were loaded in can still be compiled and linked as usual
+//  - an edited source has another key, so the cached program is not used for it: it is compiled, stored over the old
+//    file, and then loaded, and it draws what the edited source draws
+// The programs are kept in a directory of their own, which is emptied at the end.
+//
+// usage: exercise_8_1_to_8_6_sol_programcache [--dir path] [--runs N]
+//   --dir    cache directory (default programcache_check, in the working directory)
+//   --runs   number of cold builds and warm loads measured, the fastest is reported, and the first build (default 5)
+// the exit code is 1 if a check fails, 2 if the context can not cache programs (no OpenGL 4.1 or
+// ARB_get_program_binary, or no binary format)
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "program_cache.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// a triangle that covers the viewport, with the color of a uniform
+const std::string vertexSource =
+        "#version 330 core\n"
+        "void main() {\n"
+        "    vec2 corner = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);\n"
+        "    gl_Position = vec4(corner, 0.0, 1.0);\n"
+        "}\n";
+const std::string fragmentSource =
+        "#version 330 core\n"
+        "uniform vec4 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = color;\n"
+        "}\n";
+// the same program, edited: the channels are swapped
+const std::string editedFragmentSource =
+        "#version 330 core\n"
+        "uniform vec4 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = color.bgra;\n"
+        "}\n";
+
+const float drawColor[4] = {1.f, .5f, 0.f, 1.f};
+const unsigned char expectedColor[4] = {255, 128, 0, 255};
+const unsigned char expectedEditedColor[4] = {0, 128, 255, 255};
+
+bool compileAndLink(GLuint program, const std::string &vertex, const std::string &fragment);
+bool draws(GLuint program, const unsigned char expected[4]);
+bool writeFile(const std::string &path, const std::vector<char> &bytes);
+std::vector<char> readFile(const std::string &path);
+
+double milliseconds(Clock::time_point start){
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+unsigned int failures = 0;
+
+void check(bool passed, const std::string &what){
+    std::cout << (passed ? "  ok    " : "  FAIL  ") << what << std::endl;
+    failures += !passed;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::string directory = "programcache_check";
+    unsigned int runs = 5;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc) directory = argv[++i];
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cout << "usage: " << argv[0] << " [--dir path] [--runs N]" << std::endl;
+            return 2;
+        }
+    }
+
+    // glfw: a hidden window, only for its context
+    // -------------------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    GLFWwindow* window = glfwCreateWindow(16, 16, "program cache check", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return 2;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return 2;
+    }
+    std::cout << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << std::endl;
+    if (!programcache::detail::supported()) {
+        std::cout << "the context can not cache programs, nothing was checked" << std::endl;
+        glfwTerminate();
+        return 2;
+    }
+
+    // the programs draw to a 1x1 framebuffer, and the pixel is read back
+    GLuint framebuffer, renderbuffer, vertexArray;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+    glViewport(0, 0, 1, 1);
+    // the core profile needs a vertex array to draw, even without attributes
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    programcache::directory() = directory;
+    const std::string path = programcache::cachePath("check.vert", "check.frag");
+    const uint64_t key = programcache::programKey({vertexSource, fragmentSource});
+    std::remove(path.c_str());
+
+    // cold: compiled, linked and stored, as Shader does the first time
+    // ----------------------------------------------------------------
+    std::cout << "cold build" << std::endl;
+    double firstColdMs = 0., coldMs = 1e30, storeMs = 1e30;
+    bool built = true, stored = true, coldDraws = true;
+    for (unsigned int run = 0; run < runs; run++) {
+        GLuint program = glCreateProgram();
+        Clock::time_point start = Clock::now();
+        built = compileAndLink(program, vertexSource, fragmentSource) && built;
+        double buildMs = milliseconds(start);
+        firstColdMs = run == 0 ? buildMs : firstColdMs;
+        coldMs = std::min(coldMs, buildMs);
+        start = Clock::now();
+        stored = programcache::store(program, path, key) && stored;
+        storeMs = std::min(storeMs, milliseconds(start));
+        coldDraws = draws(program, expectedColor) && coldDraws;
+        glDeleteProgram(program);
+    }
+    check(built, "the program compiles and links");
+    check(coldDraws, "the compiled program draws its color");
+    check(stored, "the program is stored in " + path);
+    std::vector<char> original = readFile(path);
+    check(original.size() > sizeof(programcache::Header), "the file has a header and a binary");
+
+    // warm: loaded from the cache, as Shader does at the next starts
+    // --------------------------------------------------------------
+    std::cout << "warm load" << std::endl;
+    double warmMs = 1e30;
+    bool loaded = true, warmDraws = true;
+    for (unsigned int run = 0; run < runs; run++) {
+        GLuint program = glCreateProgram();
+        Clock::time_point start = Clock::now();
+        loaded = programcache::load(program, path, key) && loaded;
+        warmMs = std::min(warmMs, milliseconds(start));
+        warmDraws = draws(program, expectedColor) && warmDraws;
+        glDeleteProgram(program);
+    }
+    check(loaded, "the program is loaded from the cache");
+    check(warmDraws, "the loaded program draws what the compiled one draws");
+    // drivers can keep compiled shaders themselves (Mesa does, in its own shader cache), so the first build is given
+    // too: it is the one a cold start pays when that cache does not have the program either
+    std::cout << "  compile and link " << firstColdMs << " ms the first time, " << coldMs << " ms, store " << storeMs
+              << " ms, load " << warmMs << " ms (fastest of " << runs << ")" << std::endl;
+
+    // files the cache must refuse, the program is then compiled as if there was no cache
+    // ------------------------------------------------------------------------------------
+    std::cout << "fallbacks" << std::endl;
+    // cut in the middle of the binary
+    size_t half = (original.size() + sizeof(programcache::Header)) / 2;
+    std::vector<char> truncated(original.begin(), original.begin() + half);
+    std::vector<char> corrupted = original;
+    for (size_t i = sizeof(programcache::Header); i < corrupted.size(); i += 7)
+        corrupted[i] = (char) ~corrupted[i];
+    std::vector<char> wrongMagic = original;
+    wrongMagic[0] = 'X';
+    std::pair<const char*, std::vector<char>*> badFiles[] = {{"a truncated file", &truncated},
+                                                             {"a corrupted binary", &corrupted},
+                                                             {"a wrong magic", &wrongMagic}};
+    for (auto &bad : badFiles) {
+        if (!writeFile(path, *bad.second)) {
+            check(false, std::string("write ") + bad.first);
+            continue;
+        }
+        GLuint program = glCreateProgram();
+        check(!programcache::load(program, path, key), std::string(bad.first) + " is refused");
+        check(compileAndLink(program, vertexSource, fragmentSource) && draws(program, expectedColor),
+              std::string("the program is compiled after ") + bad.first);
+        glDeleteProgram(program);
+    }
+    writeFile(path, original);
+    GLuint missing = glCreateProgram();
+    check(!programcache::load(missing, directory + "/missing.program", key), "a missing file is refused");
+    glDeleteProgram(missing);
+
+    // an edited source: the key changes, so the edited program is compiled and replaces the old one in the cache
+    // -------------------------------------------------------------------------------------------------------------
+    std::cout << "edited source" << std::endl;
+    const uint64_t editedKey = programcache::programKey({vertexSource, editedFragmentSource});
+    check(editedKey != key, "the edited source has another key");
+    GLuint edited = glCreateProgram();
+    check(!programcache::load(edited, path, editedKey), "the program cached for the old source is not used");
+    check(compileAndLink(edited, vertexSource, editedFragmentSource) && draws(edited, expectedEditedColor),
+          "the edited program is compiled");
+    check(programcache::store(edited, path, editedKey), "the edited program replaces the old one");
+    glDeleteProgram(edited);
+    GLuint reloaded = glCreateProgram();
+    check(programcache::load(reloaded, path, editedKey) && draws(reloaded, expectedEditedColor),
+          "the edited program is loaded and draws the edited color");
+    glDeleteProgram(reloaded);
+    GLuint old = glCreateProgram();
+    check(!programcache::load(old, path, key), "the old source is not served the edited program");
+    glDeleteProgram(old);
+
+    // the cache directory is left empty
+    std::remove(path.c_str());
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteRenderbuffers(1, &renderbuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glfwTerminate();
+
+    std::cout << failures << " failed checks" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+
+// builds the program like Shader does (prepare() before linking, so the driver keeps the binary)
+bool compileAndLink(GLuint program, const std::string &vertex, const std::string &fragment){
+    const std::string *sources[2] = {&vertex, &fragment};
+    GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    GLuint shaders[2];
+    bool compiled = true;
+    for (int i = 0; i < 2; i++) {
+        const char *code = sources[i]->c_str();
+        shaders[i] = glCreateShader(types[i]);
+        glShaderSource(shaders[i], 1, &code, NULL);
+        glCompileShader(shaders[i]);
+        GLint success = GL_FALSE;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+        compiled = compiled && success == GL_TRUE;
+        glAttachShader(program, shaders[i]);
+    }
+    programcache::prepare(program);
+    glLinkProgram(program);
+    for (GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return compiled && linked == GL_TRUE;
+}
+
+// draws with program to the 1x1 framebuffer, and compares the pixel with expected (within 1, for the rounding)
+bool draws(GLuint program, const unsigned char expected[4]){
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(program);
+    glUniform4fv(glGetUniformLocation(program, "color"), 1, drawColor);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glUseProgram(0);
+    unsigned char pixel[4] = {};
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    for (int i = 0; i < 4; i++)
+        if (std::abs(pixel[i] - expected[i]) > 1)
+            return false;
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool writeFile(const std::string &path, const std::vector<char> &bytes){
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && written;
+}
+
+std::vector<char> readFile(const std::string &path){
+    std::vector<char> bytes;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return bytes;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    fclose(file);
+    return bytes;
+}
@@ -3,13 +3,16 @@
 #include <iostream>
 
 #include <vector>
-#include <chrono>
 #include <string>
+#include <mutex>
 #include <glm/gtx/transform.hpp>
 #include "rt_renderer.h"
 #include "primitives.h"
 
 #include "camera.h"
+#include "streaming_texture.h"
+#include "frame_pacer.h"
+#include "frame_pipeline.h"
 
 // glfw callbacks
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -30,6 +33,15 @@ rt::Renderer renderer;
 float deltaTime = 0;
 unsigned int rtDepth = 2;
 
+// the frames are rendered on another thread, which reads a copy of the camera and ray tracing depth taken by the
+// input thread, the copy is protected by the mutex
+struct FrameControls {
+    glm::mat4 view;
+    unsigned int depth;
+};
+FrameControls controls;
+std::mutex controlsMutex;
+
 int main()
 {
     using namespace std;
@@ -102,36 +114,24 @@ int main()
 
 
 
-    // initialize our custom frame buffer
-    // ----------------------------------
-    // every frame we will: draw to it, upload it to a texture, and copy the texture to the window frame buffer.
-    FrameBuffer<uint32_t> customBuffer(max_W, max_H);
-
+    // initialize our custom frame buffers
+    // -----------------------------------
+    // every frame we will: draw to one of them, upload it to a texture, and copy the texture to the window frame buffer.
+    // The frame buffers are drawn by a render thread, while this thread uploads and shows the previous one
+    FramePipeline<FrameBuffer<uint32_t>> pipeline(3, max_W, max_H);
 
-    // initialize texture we will use to upload our buffer to GPU
-    // ----------------------------------------------------------
-    unsigned int bufferTexture;
 
-    glGenTextures(1, &bufferTexture);
-    glBindTexture(GL_TEXTURE_2D, bufferTexture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // initialize openGL frame buffer object
-    // ------------------------------------
-    // this helps handling writing the texture content into the window frame buffer
-    GLuint oglFrameBuffer = 0;
-    glGenFramebuffers(1, &oglFrameBuffer);
+    // initialize the texture we will use to upload our buffer to GPU
+    // ---------------------------------------------------------------
+    // the texture is allocated once, and the custom buffers paint directly in the memory of the pixel buffers that
+    // are uploaded next, so the GPU uploads a frame while we render the next ones
+    StreamingTexture bufferTexture(max_W, max_H, pipeline.frameCount() + 1);
 
     // render loop
     // -----------
     // render every loopInterval seconds
     float loopInterval = 1.f/60.f;
-    auto begin = chrono::high_resolution_clock::now();
+    FramePacer pacer(loopInterval);
 
     std::cout << "Key mapping:" << std::endl;
     std::cout << "1 - one intersection (aka ray-casting rendering)" << std::endl;
@@ -140,53 +140,58 @@ int main()
     std::cout << "4 - three reflections" << std::endl;
     std::cout << "5 - four reflections" << std::endl;
 
+    // render to our custom frame buffers, on the render thread
+    // --------------------------------------------------------
+    controls = FrameControls{camera.GetViewMatrix(), rtDepth};
+    pipeline.start([&](FrameBuffer<uint32_t> &customBuffer){
+        FrameControls frameControls;
+        {
+            std::lock_guard<std::mutex> lock(controlsMutex);
+            frameControls = controls;
+        }
+        customBuffer.clearBuffer(rt::Colors::toRGBA32(rt::Colors::black));
+        renderer.render(vts, glm::mat4(1), frameControls.view, 70.0f, frameControls.depth, customBuffer);
+    }, [&](FrameBuffer<uint32_t> &customBuffer){
+        // before the render thread gets it, the frame buffer is pointed to the memory of the next upload
+        customBuffer.attach(static_cast<uint32_t*>(bufferTexture.beginFrame()));
+    });
+    float lastFrameTime = 0.f;
+
     while (!glfwWindowShouldClose(window))
     {
         // update current time
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float> appTime = frameStart - begin;
+        float currentTime = pacer.beginFrame();
 
         processInput(window);
-
-        // render to our custom frame buffer
-        // ---------------------------------
-        customBuffer.clearBuffer(rt::Colors::toRGBA32(rt::Colors::black));
-
-        glm::mat4 scale = glm::scale(glm::vec3(.5f,.5f,.5f));
-
-        renderer.render(vts, glm::mat4(1), camera.GetViewMatrix(), 70.0f, rtDepth, customBuffer);
+        {
+            std::lock_guard<std::mutex> lock(controlsMutex);
+            controls = FrameControls{camera.GetViewMatrix(), rtDepth};
+        }
 
         // show our rendered image
         // -----------------------
-        // upload the custom color buffer to the GPU using the texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, bufferTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, max_W, max_H, 0, GL_RGBA, GL_UNSIGNED_BYTE, customBuffer.buffer);
-
-        // set opengl frame buffer object to read from our texture, we will copy from it
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, oglFrameBuffer);
-        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bufferTexture, 0);
-
-        // bind the window frame buffer, where we want to copy the contents of the texture to
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        // if the render thread has finished a frame, upload it to the GPU using the texture,
+        // and give the frame buffer back to the render thread
+        if (FrameBuffer<uint32_t> *customBuffer = pipeline.acquire()) {
+            bufferTexture.endFrame();
+            pipeline.release(customBuffer);
+            glfwSetWindowTitle(window, ("Exercise 9 - FPS: " + std::to_string(int(1.0f/(currentTime - lastFrameTime) + .5f))).c_str());
+            lastFrameTime = currentTime;
+        }
 
-        // copy from the frame buffer object (access the texture) to the window frame buffer
+        // copy the texture to the window frame buffer
         int size_W, size_H;
         glfwGetFramebufferSize(window, &size_W, &size_H);
-        glBlitFramebuffer(0,0, max_W, max_H, 0, 0, size_W, size_H, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        bufferTexture.blit(size_W, size_H);
 
         // display frame buffer
         glfwSwapBuffers(window);
         glfwPollEvents();
 
-        // control render loop frequency (busy wait)
-        std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now()-frameStart;
-        while (loopInterval > elapsed.count()) {
-            elapsed = std::chrono::high_resolution_clock::now() - frameStart;
-        }
-        deltaTime = elapsed.count();
-        glfwSetWindowTitle(window, ("Exercise 9 - FPS: " + std::to_string(int(1.0f/deltaTime + .5f))).c_str());
+        // control render loop frequency
+        deltaTime = pacer.endFrame();
     }
+    pipeline.stop();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -13,10 +13,16 @@ public:
     T *buffer;
 
     FrameBuffer(unsigned int width, unsigned int height) : W(width), H(height) {
-        buffer = new T[W * H];
+        buffer = ownMemory = new T[W * H];
     }
 
-    ~FrameBuffer() { delete[] buffer; } // clean our memory
+    ~FrameBuffer() { delete[] ownMemory; } // clean our memory
+
+    // paint to W * H values of memory we don't own (e.g. a mapped pixel buffer, see StreamingTexture),
+    // nullptr goes back to our own memory
+    void attach(T *memory) {
+        buffer = memory ? memory : ownMemory;
+    }
 
     void clearBuffer(T value) {
         int size = W * H;
@@ -34,6 +40,8 @@ public:
         return buffer[x + y * W];
     }
 
+private:
+    T *ownMemory;
 };
 
 
@@ -0,0 +1,179 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_FRAME_PACER_H
+#define ITU_GRAPHICS_PROGRAMMING_FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+
+// keeps the render loop at one frame every interval seconds, without keeping a core busy while it waits
+//
+//  while (!glfwWindowShouldClose(window)) {
+//      currentTime = pacer.beginFrame();
+//      ... render, swap buffers, poll events ...
+//      pacer.endFrame();
+//  }
+//
+// endFrame() sleeps for most of the time that is left, and only spins (yielding the core) for the last part, which is
+// as long as the sleep has been observed to overshoot, so the frames are as regular as with a busy wait.
+// With setVsync(true) the swap waits for the display instead, every as many refreshes as are closest to interval, and
+// endFrame() does not wait on top of it, unless the swap is seen to return without waiting (some drivers and
+// compositors ignore the swap interval).
+class FramePacer {
+public:
+    // statistics of the time between the start of consecutive frames, in seconds
+    struct Stats {
+        float mean = 0.f;
+        float p99 = 0.f; // 99% of the frames were as long or shorter
+        float jitter = 0.f; // standard deviation
+        unsigned int frames = 0; // number of frames in the statistics
+    };
+
+    // one frame every interval seconds, the statistics are kept for the last historySize frames
+    explicit FramePacer(float interval, unsigned int historySize = 240) :
+            interval(interval), history(std::max(historySize, 1u), 0.f) {
+        start = clock::now();
+        frameStart = start;
+    }
+
+    // call it when the frame starts, returns the time since the pacer was created, in seconds
+    float beginFrame(){
+        clock::time_point now = clock::now();
+        if (frameCount > 0) {
+            delta = seconds(now - frameStart);
+            // the delta between frames n-1 and n goes in slot n-1, so the first frames fill slots 0, 1, ...
+            history[(frameCount - 1) % history.size()] = delta;
+        }
+        frameCount++;
+        frameStart = now;
+        return time();
+    }
+
+    // call it when the frame ends, waits until interval seconds have passed since beginFrame(),
+    // returns the time from beginFrame() to the end of the wait, in seconds
+    float endFrame(){
+        // the last frame took about a swap period without our wait, so the swap is pacing the frames
+        bool swapPaced = vsyncOn && frameCount > 1 && delta - waited >= .75f * swapPeriod;
+        clock::time_point now = clock::now();
+        if (interval > 0.f && !swapPaced)
+            waitUntil(frameStart + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(interval)));
+        clock::time_point end = clock::now();
+        waited = seconds(end - now);
+        return seconds(end - frameStart);
+    }
+
+    // turns vsync on or off for the OpenGL context of the calling thread (call it after glfwMakeContextCurrent).
+    // With vsync the buffers are swapped every round(interval * refresh rate) refreshes of the primary monitor, at
+    // least 1, so the frames come at the refresh rate of the display when interval is shorter than a refresh
+    void setVsync(bool on){
+        vsyncOn = on;
+        int swapInterval = 0;
+        swapPeriod = interval;
+        if (on) {
+            const GLFWvidmode *mode = glfwGetPrimaryMonitor() ? glfwGetVideoMode(glfwGetPrimaryMonitor()) : nullptr;
+            int refreshRate = mode ? mode->refreshRate : 0;
+            swapInterval = refreshRate > 0 ? std::max(1, (int) std::lround(interval * refreshRate)) : 1;
+            if (refreshRate > 0)
+                swapPeriod = (float) swapInterval / (float) refreshRate;
+        }
+        glfwSwapInterval(swapInterval);
+    }
+
+    bool vsync() const { return vsyncOn; }
+
+    // time since the pacer was created, at the start of the current frame, in seconds
+    float time() const { return seconds(frameStart - start); }
+
+    // time between the start of the previous frame and the start of the current frame, in seconds
+    float deltaTime() const { return delta; }
+
+    // fixed timestep updates: returns how many updates of step seconds the simulation must run this frame,
+    // the time that is left over is carried to the next frames. Call it once per frame, after beginFrame().
+    // If the simulation is more than maxSteps updates behind (e.g. after a pause) the extra time is dropped,
+    // so a slow simulation can not fall further behind every frame
+    unsigned int fixedSteps(float step, unsigned int maxSteps = 8){
+        accumulator += delta;
+        unsigned int steps = (unsigned int) (accumulator / step);
+        if (steps > maxSteps) {
+            accumulator = 0.f;
+            return maxSteps;
+        }
+        accumulator -= (float) steps * step;
+        return steps;
+    }
+
+    // fraction of a fixed step that is left over, to interpolate between the last two simulation states
+    float fixedAlpha(float step) const { return accumulator / step; }
+
+    Stats stats() const {
+        Stats result;
+        // the last frames are in the first slots until the history wraps, then in all of them
+        result.frames = (unsigned int) std::min<unsigned long long>(frameCount > 0 ? frameCount - 1 : 0, history.size());
+        if (result.frames == 0)
+            return result;
+        std::vector<float> frames(history.begin(), history.begin() + result.frames);
+        double sum = 0.0, sumSquares = 0.0;
+        for (float frame : frames) {
+            sum += frame;
+            sumSquares += (double) frame * frame;
+        }
+        result.mean = float(sum / result.frames);
+        result.jitter = (float) std::sqrt(std::max(0.0, sumSquares / result.frames - (double) result.mean * result.mean));
+        unsigned int p99 = std::min(result.frames - 1, (unsigned int) std::ceil(.99f * result.frames) - 1);
+        std::nth_element(frames.begin(), frames.begin() + p99, frames.end());
+        result.p99 = frames[p99];
+        return result;
+    }
+
+    // seconds between frames
+    float interval;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static float seconds(clock::duration duration){
+        return std::chrono::duration<float>(duration).count();
+    }
+
+    void waitUntil(clock::time_point target){
+        for (;;) {
+            clock::time_point now = clock::now();
+            if (now >= target)
+                return;
+            clock::duration remaining = target - now;
+            if (remaining <= spinTime) {
+                std::this_thread::yield();
+                continue;
+            }
+            // sleep, and measure how late it wakes up to know how long to spin before the next deadlines
+            clock::duration sleep = remaining - spinTime;
+            std::this_thread::sleep_for(sleep);
+            clock::duration overshoot = clock::now() - now - sleep;
+            oversleep = std::max(overshoot, clock::duration(oversleep * 15 / 16));
+            spinTime = std::min(std::max(oversleep + std::chrono::microseconds(100),
+                                         clock::duration(std::chrono::microseconds(200))),
+                                std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(interval)));
+        }
+    }
+
+    clock::time_point start, frameStart;
+    unsigned long long frameCount = 0;
+    float delta = 0.f;
+    float accumulator = 0.f;
+    // vsync, the time between swaps it gives, and how long endFrame() waited in the last frame
+    bool vsyncOn = false;
+    float swapPeriod = 0.f;
+    float waited = 0.f;
+    std::vector<float> history;
+    // how late sleep_for wakes up (a decaying maximum), and how long we spin at the end of a wait
+    clock::duration oversleep = std::chrono::milliseconds(1);
+    clock::duration spinTime = std::chrono::milliseconds(2);
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_FRAME_PACER_H
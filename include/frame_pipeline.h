@@ -0,0 +1,133 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_FRAME_PIPELINE_H
+#define ITU_GRAPHICS_PROGRAMMING_FRAME_PIPELINE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// a thread safe FIFO queue, pop() waits for an element until the queue is closed
+template<class T>
+class FrameQueue {
+public:
+    void push(T value){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            values.push_back(std::move(value));
+        }
+        changed.notify_one();
+    }
+
+    // waits until there is an element and returns true, or returns false once the queue is closed
+    bool pop(T &value){
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]{ return closed || !values.empty(); });
+        if (closed)
+            return false;
+        value = std::move(values.front());
+        values.pop_front();
+        return true;
+    }
+
+    // returns false right away if the queue is empty
+    bool tryPop(T &value){
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed || values.empty())
+            return false;
+        value = std::move(values.front());
+        values.pop_front();
+        return true;
+    }
+
+    // wakes up and fails every pop(), now and later
+    void close(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        changed.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<T> values;
+    bool closed = false;
+};
+
+
+// renders frames on a thread of its own while the thread that owns the OpenGL context presents them
+//
+// A fixed number of frames (e.g. frame buffers) go around: the render thread takes a free frame, renders it and
+// queues it as ready; the presenting thread takes the ready frames in order, uploads them and gives them back.
+// When all frames are rendered and not yet presented the render thread waits (back-pressure), so it is at most
+// frameCount - 1 frames ahead of the screen, and the upload, the swap and the input polling of frame N happen while
+// frame N + 1 is rendered. The render function runs only on the render thread: anything it reads that the
+// presenting thread changes (e.g. the camera) must be handed over with a lock, as a copy taken when the frame starts.
+// The optional prepare function runs on the presenting thread before a frame is handed to the render thread, e.g. to
+// point the frame buffer to the memory of the next StreamingTexture frame, so the frame is rendered in place.
+template<class Frame>
+class FramePipeline {
+public:
+    // creates count frames (at least 2) with Frame(args...)
+    template<class... Args>
+    explicit FramePipeline(unsigned int count, const Args&... args){
+        for (unsigned int i = 0; i < std::max(count, 2u); i++)
+            frames.emplace_back(new Frame(args...));
+    }
+
+    ~FramePipeline(){ stop(); }
+
+    // the number of frames that go around
+    unsigned int frameCount() const { return (unsigned int) frames.size(); }
+
+    // starts the render thread, which calls render(frame) for every frame, until stop()
+    void start(std::function<void(Frame &)> render, std::function<void(Frame &)> prepare = nullptr){
+        prepareFrame = prepare;
+        for (const std::unique_ptr<Frame> &frame : frames)
+            release(frame.get());
+        renderThread = std::thread([this, render]{
+            Frame *frame;
+            while (freeFrames.pop(frame)) {
+                render(*frame);
+                readyFrames.push(frame);
+            }
+        });
+    }
+
+    // the oldest rendered frame, or nullptr if there is none yet (so the presenting thread keeps polling the input),
+    // the frame must be given back with release() once it is presented
+    Frame *acquire(){
+        Frame *frame = nullptr;
+        readyFrames.tryPop(frame);
+        return frame;
+    }
+
+    // gives a presented frame back to the render thread
+    void release(Frame *frame){
+        if (prepareFrame)
+            prepareFrame(*frame);
+        freeFrames.push(frame);
+    }
+
+    // waits for the frame being rendered and stops the render thread
+    void stop(){
+        freeFrames.close();
+        if (renderThread.joinable())
+            renderThread.join();
+    }
+
+private:
+    std::vector<std::unique_ptr<Frame>> frames;
+    FrameQueue<Frame *> freeFrames, readyFrames;
+    std::function<void(Frame &)> prepareFrame;
+    std::thread renderThread;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_FRAME_PIPELINE_H
@@ -0,0 +1,85 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_GL_FEATURES_H
+#define ITU_GRAPHICS_PROGRAMMING_GL_FEATURES_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+
+
+// the OpenGL features above the 3.3 core profile that the repo uses when the context has them
+//
+// The glad header of the repo is generated for OpenGL 3.3 core, without extensions, so the enums and the functions of
+// later versions and extensions are not in it, and #ifdef on their names compiles the feature out. A glad header
+// generated for a later version has them, but its function pointers are null on a context that does not support
+// them. So the support is always checked at run time, on the current context, and the functions are loaded with
+// glfwGetProcAddress (which returns nullptr when the context does not have them).
+
+// buffer storage (OpenGL 4.4, ARB_buffer_storage)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+// program binaries (OpenGL 4.1, ARB_get_program_binary)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+// parallel shader compilation (KHR_parallel_shader_compile)
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace GLFeatures {
+
+    typedef void (APIENTRYP TexStorage2D)(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height);
+    typedef void (APIENTRYP BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    typedef void (APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *format,
+                                              void *binary);
+    typedef void (APIENTRYP ProgramBinary)(GLuint program, GLenum format, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteri)(GLuint program, GLenum name, GLint value);
+    typedef void (APIENTRYP MaxShaderCompilerThreads)(GLuint count);
+
+    // the version of the current context, as major * 10 + minor (e.g. 33 for OpenGL 3.3)
+    inline int version() {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        return major * 10 + minor;
+    }
+
+    inline bool hasExtension(const char *name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (extension && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // the function name of the current context, nullptr if the context has neither the version (if minVersion is not
+    // 0) nor the extension (if extension is not nullptr) that has it
+    template <class Function>
+    Function load(const char *name, int minVersion, const char *extension) {
+        bool supported = (minVersion > 0 && version() >= minVersion) || (extension && hasExtension(extension));
+        return supported ? (Function) glfwGetProcAddress(name) : nullptr;
+    }
+}
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_GL_FEATURES_H
@@ -0,0 +1,655 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MESH_CACHE_H
+#define ITU_GRAPHICS_PROGRAMMING_MESH_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlets.h"
+#include "obj_parser.h"
+
+
+// a binary file format for indexed triangle meshes, that is loaded without parsing
+//
+// The file is a Header followed by five sections, each one starting at a multiple of 64 bytes:
+//  - vertices: vertexCount PackedVertex (position, normal, uv, the layout of Vertex in the exercises' mesh.h)
+//  - indices: indexCount indices of indexSize bytes, 16 bits if there are at most 65536 vertices, else 32 bits
+//  - submeshes: submeshCount Submesh, the ranges of indices of each object/group of the OBJ file
+//  - levels of detail: lodCount Lod, the ranges of indices of the full mesh (the first one) and of simplified versions
+//    of it (see mesh_simplifier.h), that use the same vertices. The submeshes are ranges of the first one
+//  - meshlets: meshletCount meshlets::Meshlet, the triangles of each level split in clusters that are culled as a
+//    whole (see meshlets.h). The meshlets of a level are consecutive, and split its triangles in consecutive ranges
+// The triangles of each submesh are ordered for the vertex cache and overdraw, then split in meshlets that are drawn in
+// overdraw order, each one ordered for the vertex cache, and the vertices are numbered in the order the triangles use
+// them (see mesh_optimizer.h), so the GPU and the CPU code that reads the indices both get that order.
+// The numbers are stored little endian. A MeshFile maps the file in memory and the sections are used where they are,
+// e.g. given directly to glBufferData.
+//
+// loadOrBuild(path) keeps a cache of an OBJ file next to it (path + ".mesh"): the first time the OBJ file is parsed
+// and the cache is written, after that the cache is loaded. The cache stores the size, modification time and hash of
+// the OBJ file it was built from, and it is built again when the OBJ file changes.
+namespace meshcache {
+
+const char magic[8] = {'I', 'T', 'U', 'M', 'E', 'S', 'H', '\0'};
+// increase it when the format changes, files of another version are built again
+const uint32_t version = 4;
+// written as a number, so a file written on a big endian machine is not read as little endian
+const uint32_t byteOrderMark = 0x01020304u;
+const uint64_t sectionAlignment = 64;
+
+struct PackedVertex {
+    float position[3];
+    float normal[3];
+    float uv[2]; // V inverted, like loadOBJ does
+};
+
+struct Submesh {
+    uint32_t firstIndex, indexCount;
+    float boundsMin[3], boundsMax[3];
+    char name[40]; // null terminated, longer names are cut
+};
+
+struct Lod {
+    uint32_t firstIndex, indexCount;
+    float error; // how far, at most, the simplified surface is from the full one (estimated), in model units
+    uint32_t firstMeshlet, meshletCount; // the meshlets of the level, none until buildMeshlets() is called
+    uint32_t reserved;
+};
+
+// levels of detail built by buildLods(), each one with about half the triangles of the previous one
+const unsigned int defaultLodCount = 4;
+const float lodReduction = .5f;
+
+// the OBJ file a mesh file was built from
+struct SourceKey {
+    uint64_t size;
+    int64_t modified; // modification time, in nanoseconds
+    uint64_t hash; // of the content, see hashBytes()
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    SourceKey source;
+    uint32_t vertexCount, vertexStride;
+    uint32_t indexCount, indexSize;
+    uint32_t submeshCount, submeshStride;
+    uint64_t vertexOffset, indexOffset, submeshOffset;
+    uint64_t fileSize;
+    float boundsMin[3], boundsMax[3];
+    uint32_t lodCount, lodStride;
+    uint64_t lodOffset;
+    uint32_t meshletCount, meshletStride;
+    uint64_t meshletOffset;
+};
+
+static_assert(sizeof(PackedVertex) == 32, "PackedVertex must be 8 tightly packed floats");
+static_assert(sizeof(Submesh) == 72, "Submesh must not have padding");
+static_assert(sizeof(Lod) == 24, "Lod must not have padding");
+static_assert(sizeof(meshlets::Meshlet) == 40, "Meshlet must not have padding");
+static_assert(sizeof(Header) == 152, "Header must not have padding");
+
+
+// an indexed mesh in memory, what a mesh file stores
+struct IndexedMesh {
+    std::vector<PackedVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Submesh> submeshes;
+    // empty until buildLods() is called, the mesh file then has one level with all the indices
+    std::vector<Lod> lods;
+    // empty until buildMeshlets() is called
+    std::vector<meshlets::Meshlet> meshlets;
+    float boundsMin[3] = {0.f, 0.f, 0.f}, boundsMax[3] = {0.f, 0.f, 0.f};
+};
+
+
+// a fast hash of bytes, to know if a file changed (it is not meant to resist someone making collisions on purpose)
+inline uint64_t hashBytes(const char *data, size_t size){
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ (unsigned char) data[i]) * 0x100000001B3ull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    return hash ^ (hash >> 33);
+}
+
+// size and modification time (in nanoseconds) of a file, returns false if it does not exist. Whole seconds would miss
+// an edit made in the same second as the cache was built, so the time is as precise as the system keeps it (on
+// Windows stat only has seconds)
+inline bool fileStatus(const char *path, uint64_t &size, int64_t &modified){
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false;
+    size = (uint64_t) info.st_size;
+#if defined(__APPLE__)
+    modified = (int64_t) info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(__unix__)
+    modified = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    modified = (int64_t) info.st_mtime * 1000000000;
+#endif
+    return true;
+}
+
+
+namespace detail {
+
+// the indices of a submesh with its vertices numbered from 0, in the order the indices use them, so the work done on
+// a submesh is proportional to its size, not the mesh's
+struct LocalSubmesh {
+    std::vector<uint32_t> global; // the vertex of the mesh of each local vertex
+    std::vector<uint32_t> indices;
+    std::vector<float> positions; // 3 floats per local vertex
+};
+
+// local must have an element per vertex of the mesh, all unused (0xFFFFFFFF), they are left that way
+inline void localize(const IndexedMesh &mesh, const Submesh &submesh, std::vector<uint32_t> &local,
+                     LocalSubmesh &result){
+    const uint32_t unused = 0xFFFFFFFFu;
+    result.global.clear();
+    result.positions.clear();
+    result.indices.resize(submesh.indexCount);
+    for (uint32_t i = 0; i < submesh.indexCount; i++) {
+        uint32_t vertex = mesh.indices[submesh.firstIndex + i];
+        if (local[vertex] == unused) {
+            local[vertex] = (uint32_t) result.global.size();
+            result.global.push_back(vertex);
+            const float *position = mesh.vertices[vertex].position;
+            result.positions.insert(result.positions.end(), position, position + 3);
+        }
+        result.indices[i] = local[vertex];
+    }
+    for (uint32_t vertex : result.global)
+        local[vertex] = unused;
+}
+
+} // namespace detail
+
+
+// reorders the triangles of each submesh for the vertex cache and then for overdraw, and numbers the vertices in the
+// order the triangles use them. The submeshes keep their ranges of indices and bounds. Call it before buildLods()
+inline void optimizeIndexedMesh(IndexedMesh &mesh){
+    std::vector<uint32_t> local(mesh.vertices.size(), 0xFFFFFFFFu);
+    detail::LocalSubmesh submeshVertices;
+    for (const Submesh &submesh : mesh.submeshes) {
+        detail::localize(mesh, submesh, local, submeshVertices);
+        std::vector<uint32_t> &indices = submeshVertices.indices;
+        size_t vertexCount = submeshVertices.global.size();
+        meshoptimizer::optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        meshoptimizer::optimizeOverdraw(indices.data(), indices.size(), submeshVertices.positions.data(),
+                                        3 * sizeof(float), vertexCount);
+        for (uint32_t i = 0; i < submesh.indexCount; i++)
+            mesh.indices[submesh.firstIndex + i] = submeshVertices.global[indices[i]];
+    }
+    std::vector<uint32_t> remap = meshoptimizer::optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(),
+                                                                     mesh.vertices.size());
+    meshoptimizer::remapVertices(mesh.vertices, remap);
+}
+
+// adds up to lodCount levels of detail after the full mesh, each one with about reduction times the triangles of the
+// previous one. Each submesh is simplified on its own, so the groups keep their borders, and the levels are ordered
+// for the vertex cache. The chain stops at the first level that does not remove at least a tenth of the triangles
+// (e.g. a mesh made of seams only)
+inline void buildLods(IndexedMesh &mesh, unsigned int lodCount = defaultLodCount, float reduction = lodReduction){
+    if (!mesh.lods.empty())
+        mesh.indices.resize(mesh.lods[0].indexCount);
+    mesh.lods.assign(1, Lod{0, (uint32_t) mesh.indices.size(), 0.f, 0, 0, 0});
+    mesh.meshlets.clear();
+
+    std::vector<std::vector<uint32_t>> levelIndices(lodCount);
+    std::vector<float> levelErrors(lodCount, 0.f);
+    std::vector<uint32_t> local(mesh.vertices.size(), 0xFFFFFFFFu);
+    detail::LocalSubmesh submeshVertices;
+    for (const Submesh &submesh : mesh.submeshes) {
+        detail::localize(mesh, submesh, local, submeshVertices);
+        const std::vector<uint32_t> &indices = submeshVertices.indices;
+        std::vector<size_t> targets(lodCount);
+        double triangles = indices.size() / 3;
+        for (unsigned int level = 0; level < lodCount; level++)
+            targets[level] = (size_t) (triangles *= reduction);
+        std::vector<meshsimplifier::Level> levels = meshsimplifier::simplify(
+                submeshVertices.positions.data(), 3 * sizeof(float), submeshVertices.global.size(), indices.data(),
+                indices.size(), targets);
+
+        // a submesh that can not be simplified as much as the targets stays at its last level
+        for (unsigned int level = 0; level < lodCount; level++) {
+            std::vector<uint32_t> simplified = indices;
+            float error = 0.f;
+            if (!levels.empty()) {
+                const meshsimplifier::Level &source = levels[std::min<size_t>(level, levels.size() - 1)];
+                simplified = source.indices;
+                error = source.error;
+            }
+            meshoptimizer::optimizeVertexCache(simplified.data(), simplified.size(), submeshVertices.global.size());
+            for (uint32_t &index : simplified)
+                index = submeshVertices.global[index];
+            levelIndices[level].insert(levelIndices[level].end(), simplified.begin(), simplified.end());
+            levelErrors[level] = std::max(levelErrors[level], error);
+        }
+    }
+
+    for (unsigned int level = 0; level < lodCount; level++) {
+        if (levelIndices[level].empty() || levelIndices[level].size() > mesh.lods.back().indexCount * 9 / 10)
+            break;
+        mesh.lods.push_back(Lod{(uint32_t) mesh.indices.size(), (uint32_t) levelIndices[level].size(),
+                                levelErrors[level], 0, 0, 0});
+        mesh.indices.insert(mesh.indices.end(), levelIndices[level].begin(), levelIndices[level].end());
+    }
+}
+
+// splits the triangles of each level of detail in meshlets, reordering them within the level: the meshlets are in
+// overdraw order (see meshoptimizer::overdrawOrder), the triangles of each one in vertex cache order, and then the
+// vertices are numbered again in the order the triangles use them. The submeshes of the first level are split on
+// their own, so they keep their ranges of indices. Call it after buildLods()
+inline void buildMeshlets(IndexedMesh &mesh){
+    if (mesh.lods.empty())
+        mesh.lods.push_back(Lod{0, (uint32_t) mesh.indices.size(), 0.f, 0, 0, 0});
+    mesh.meshlets.clear();
+    std::vector<uint32_t> local(mesh.vertices.size(), 0xFFFFFFFFu), inMeshlet;
+    detail::LocalSubmesh rangeVertices;
+    std::vector<uint32_t> meshletVertices, meshletIndices, reordered;
+    std::vector<size_t> meshletStarts;
+    for (size_t level = 0; level < mesh.lods.size(); level++) {
+        Lod &lod = mesh.lods[level];
+        Submesh whole = {};
+        whole.firstIndex = lod.firstIndex;
+        whole.indexCount = lod.indexCount;
+        std::vector<Submesh> ranges(1, whole);
+        if (level == 0 && !mesh.submeshes.empty())
+            ranges = mesh.submeshes;
+        lod.firstMeshlet = (uint32_t) mesh.meshlets.size();
+        for (const Submesh &range : ranges) {
+            detail::localize(mesh, range, local, rangeVertices);
+            std::vector<uint32_t> &indices = rangeVertices.indices;
+            std::vector<meshlets::Meshlet> split = meshlets::buildMeshlets(
+                    indices.data(), indices.size(), rangeVertices.positions.data(), 3 * sizeof(float),
+                    rangeVertices.global.size());
+            // the vertices of a meshlet are numbered from 0 to optimize it, in inMeshlet
+            inMeshlet.assign(rangeVertices.global.size(), 0xFFFFFFFFu);
+            for (const meshlets::Meshlet &meshlet : split) {
+                meshletVertices.clear();
+                meshletIndices.resize(meshlet.indexCount);
+                for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                    uint32_t &vertex = inMeshlet[indices[meshlet.firstIndex + i]];
+                    if (vertex == 0xFFFFFFFFu) {
+                        vertex = (uint32_t) meshletVertices.size();
+                        meshletVertices.push_back(indices[meshlet.firstIndex + i]);
+                    }
+                    meshletIndices[i] = vertex;
+                }
+                meshoptimizer::optimizeVertexCache(meshletIndices.data(), meshletIndices.size(),
+                                                   meshletVertices.size());
+                for (uint32_t i = 0; i < meshlet.indexCount; i++)
+                    indices[meshlet.firstIndex + i] = meshletVertices[meshletIndices[i]];
+                for (uint32_t vertex : meshletVertices)
+                    inMeshlet[vertex] = 0xFFFFFFFFu;
+            }
+            // the meshlets are the clusters of the overdraw order, the cache starts over at each one anyway
+            meshletStarts.clear();
+            for (const meshlets::Meshlet &meshlet : split)
+                meshletStarts.push_back(meshlet.firstIndex / 3);
+            meshletStarts.push_back(indices.size() / 3);
+            reordered.clear();
+            for (size_t m : meshoptimizer::overdrawOrder(indices.data(), meshletStarts,
+                                                         rangeVertices.positions.data(), 3 * sizeof(float))) {
+                meshlets::Meshlet meshlet = split[m];
+                const uint32_t *first = indices.data() + meshlet.firstIndex;
+                meshlet.firstIndex = range.firstIndex + (uint32_t) reordered.size();
+                reordered.insert(reordered.end(), first, first + meshlet.indexCount);
+                mesh.meshlets.push_back(meshlet);
+            }
+            for (uint32_t i = 0; i < range.indexCount; i++)
+                mesh.indices[range.firstIndex + i] = rangeVertices.global[reordered[i]];
+        }
+        lod.meshletCount = (uint32_t) mesh.meshlets.size() - lod.firstMeshlet;
+    }
+    std::vector<uint32_t> remap = meshoptimizer::optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(),
+                                                                     mesh.vertices.size());
+    meshoptimizer::remapVertices(mesh.vertices, remap);
+}
+
+
+// the triangles of an OBJ file as an indexed mesh: the corners that have the same position, uv and normal share one
+// vertex (a missing uv or normal is 0), and every object/group of the file that has triangles is a submesh.
+// With optimize, the triangles and vertices are reordered by optimizeIndexedMesh()
+inline void buildIndexedMesh(const obj::Data &data, IndexedMesh &mesh, bool optimize = true){
+    mesh = IndexedMesh();
+    size_t cornerCount = data.corners.size() / 3;
+    mesh.indices.reserve(cornerCount);
+
+    // the hash map is a table of vertex indices + 1 (0 is an empty slot), with linear probing, at most half full,
+    // so looking up a vertex does not allocate
+    size_t tableSize = 2;
+    while (tableSize < cornerCount * 2) tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, 0);
+    auto hashVertex = [](const PackedVertex &vertex){
+        uint32_t bits[sizeof(PackedVertex) / 4];
+        memcpy(bits, &vertex, sizeof(PackedVertex));
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t word : bits)
+            hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        return (size_t) (hash ^ (hash >> 33));
+    };
+
+    for (size_t i = 0; i < cornerCount; i++) {
+        const uint32_t *corner = &data.corners[i * 3];
+        PackedVertex vertex = {};
+        memcpy(vertex.position, &data.positions[corner[0] * 3], sizeof(vertex.position));
+        if (corner[2] != obj::missing)
+            memcpy(vertex.normal, &data.normals[corner[2] * 3], sizeof(vertex.normal));
+        if (corner[1] != obj::missing) {
+            vertex.uv[0] = data.uvs[corner[1] * 2];
+            vertex.uv[1] = -data.uvs[corner[1] * 2 + 1];
+        }
+
+        size_t slot = hashVertex(vertex) & (tableSize - 1);
+        while (table[slot] != 0 && memcmp(&mesh.vertices[table[slot] - 1], &vertex, sizeof(PackedVertex)) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == 0) {
+            mesh.vertices.push_back(vertex);
+            table[slot] = (uint32_t) mesh.vertices.size();
+        }
+        mesh.indices.push_back(table[slot] - 1);
+    }
+
+    auto grow = [](float *boundsMin, float *boundsMax, const float *position){
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+        }
+    };
+    if (!mesh.vertices.empty()) {
+        memcpy(mesh.boundsMin, mesh.vertices[0].position, sizeof(mesh.boundsMin));
+        memcpy(mesh.boundsMax, mesh.vertices[0].position, sizeof(mesh.boundsMax));
+        for (const PackedVertex &vertex : mesh.vertices)
+            grow(mesh.boundsMin, mesh.boundsMax, vertex.position);
+    }
+
+    // the triangles before the first group are a submesh without a name
+    std::vector<obj::Data::Group> groups(1, obj::Data::Group{"", 0});
+    groups.insert(groups.end(), data.groups.begin(), data.groups.end());
+    for (size_t i = 0; i < groups.size(); i++) {
+        size_t first = groups[i].firstTriangle;
+        size_t last = i + 1 < groups.size() ? groups[i + 1].firstTriangle : data.triangleCount();
+        if (last <= first)
+            continue;
+        Submesh submesh = {};
+        submesh.firstIndex = (uint32_t) first * 3;
+        submesh.indexCount = (uint32_t) (last - first) * 3;
+        strncpy(submesh.name, groups[i].name.c_str(), sizeof(submesh.name) - 1);
+        const float *position = mesh.vertices[mesh.indices[submesh.firstIndex]].position;
+        memcpy(submesh.boundsMin, position, sizeof(submesh.boundsMin));
+        memcpy(submesh.boundsMax, position, sizeof(submesh.boundsMax));
+        for (uint32_t j = 0; j < submesh.indexCount; j++)
+            grow(submesh.boundsMin, submesh.boundsMax, mesh.vertices[mesh.indices[submesh.firstIndex + j]].position);
+        mesh.submeshes.push_back(submesh);
+    }
+    if (optimize)
+        optimizeIndexedMesh(mesh);
+}
+
+// the bytes of the mesh file of mesh
+inline std::vector<char> serialize(const IndexedMesh &mesh, const SourceKey &source){
+    auto align = [](uint64_t offset){ return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment; };
+    Header header = {};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byteOrderMark = byteOrderMark;
+    header.source = source;
+    header.vertexCount = (uint32_t) mesh.vertices.size();
+    header.vertexStride = sizeof(PackedVertex);
+    header.indexCount = (uint32_t) mesh.indices.size();
+    header.indexSize = mesh.vertices.size() <= 65536 ? 2 : 4;
+    header.submeshCount = (uint32_t) mesh.submeshes.size();
+    header.submeshStride = sizeof(Submesh);
+    header.vertexOffset = align(sizeof(Header));
+    header.indexOffset = align(header.vertexOffset + (uint64_t) header.vertexCount * header.vertexStride);
+    header.submeshOffset = align(header.indexOffset + (uint64_t) header.indexCount * header.indexSize);
+    std::vector<Lod> lods = mesh.lods;
+    if (lods.empty())
+        lods.push_back(Lod{0, (uint32_t) mesh.indices.size(), 0.f, 0, 0, 0});
+    header.lodCount = (uint32_t) lods.size();
+    header.lodStride = sizeof(Lod);
+    header.lodOffset = align(header.submeshOffset + (uint64_t) header.submeshCount * header.submeshStride);
+    header.meshletCount = (uint32_t) mesh.meshlets.size();
+    header.meshletStride = sizeof(meshlets::Meshlet);
+    header.meshletOffset = align(header.lodOffset + (uint64_t) header.lodCount * header.lodStride);
+    header.fileSize = header.meshletOffset + (uint64_t) header.meshletCount * header.meshletStride;
+    memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+    std::vector<char> bytes(header.fileSize, 0);
+    memcpy(bytes.data(), &header, sizeof(Header));
+    if (!mesh.vertices.empty())
+        memcpy(&bytes[header.vertexOffset], mesh.vertices.data(), mesh.vertices.size() * sizeof(PackedVertex));
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        if (header.indexSize == 2) {
+            uint16_t index = (uint16_t) mesh.indices[i];
+            memcpy(&bytes[header.indexOffset + i * 2], &index, 2);
+        }
+        else
+            memcpy(&bytes[header.indexOffset + i * 4], &mesh.indices[i], 4);
+    }
+    if (!mesh.submeshes.empty())
+        memcpy(&bytes[header.submeshOffset], mesh.submeshes.data(), mesh.submeshes.size() * sizeof(Submesh));
+    memcpy(&bytes[header.lodOffset], lods.data(), lods.size() * sizeof(Lod));
+    if (!mesh.meshlets.empty())
+        memcpy(&bytes[header.meshletOffset], mesh.meshlets.data(), mesh.meshlets.size() * sizeof(meshlets::Meshlet));
+    return bytes;
+}
+
+// writes the file at once (through a temporary file), so a program that stops in the middle does not leave half a file
+inline bool writeFile(const std::string &path, const std::vector<char> &bytes){
+    // each thread has its own temporary file, in case two threads write the same file
+    std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = fclose(file) == 0 && written;
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+    // elsewhere rename replaces the file at once, a reader sees either the old file or the new one
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+// a mesh file, mapped in memory (or built in memory), the sections are read where they are
+class MeshFile {
+public:
+    // maps the mesh file at path, returns false (with a message in error) if it is missing, of another version or
+    // damaged
+    bool open(const std::string &path){
+        close();
+        mapped.reset(new obj::MappedFile(path.c_str()));
+        if (!mapped->isOpen()) {
+            error = "can not open " + path;
+            close();
+            return false;
+        }
+        return validate(mapped->data(), mapped->size());
+    }
+
+    // uses the bytes of a mesh file that is in memory (e.g. the result of serialize())
+    bool open(std::vector<char> bytes){
+        close();
+        memory = std::move(bytes);
+        return validate(memory.data(), memory.size());
+    }
+
+    void close(){
+        data = nullptr;
+        mapped.reset();
+        memory.clear();
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+    const Header &header() const { return *reinterpret_cast<const Header*>(data); }
+    const PackedVertex *vertices() const { return reinterpret_cast<const PackedVertex*>(data + header().vertexOffset); }
+    // header().indexSize bytes per index
+    const void *indices() const { return data + header().indexOffset; }
+    const Submesh *submeshes() const { return reinterpret_cast<const Submesh*>(data + header().submeshOffset); }
+    // header().lodCount levels, at least one, the first one is the full mesh
+    const Lod *lods() const { return reinterpret_cast<const Lod*>(data + header().lodOffset); }
+    const meshlets::Meshlet *meshlets() const {
+        return reinterpret_cast<const meshlets::Meshlet*>(data + header().meshletOffset);
+    }
+    size_t sizeInBytes() const { return header().fileSize; }
+
+    uint32_t index(size_t i) const {
+        if (header().indexSize == 2)
+            return static_cast<const uint16_t*>(indices())[i];
+        return static_cast<const uint32_t*>(indices())[i];
+    }
+
+    // why open() failed
+    std::string error;
+
+private:
+    bool validate(const char *bytes, size_t size){
+        const Header *header = reinterpret_cast<const Header*>(bytes);
+        auto fits = [&](uint64_t offset, uint64_t count, uint64_t stride){
+            return offset % sectionAlignment == 0 && offset <= size && count * stride <= size - offset;
+        };
+        const char *problem = nullptr;
+        if (size < sizeof(Header) || memcmp(header->magic, magic, sizeof(magic)) != 0)
+            problem = "not a mesh file";
+        else if (header->version != version || header->byteOrderMark != byteOrderMark)
+            problem = "mesh file of another version";
+        else if (header->fileSize != size || header->vertexStride != sizeof(PackedVertex) ||
+                 header->submeshStride != sizeof(Submesh) || (header->indexSize != 2 && header->indexSize != 4) ||
+                 header->lodStride != sizeof(Lod) || header->lodCount == 0 ||
+                 header->meshletStride != sizeof(meshlets::Meshlet) ||
+                 !fits(header->vertexOffset, header->vertexCount, header->vertexStride) ||
+                 !fits(header->indexOffset, header->indexCount, header->indexSize) ||
+                 !fits(header->submeshOffset, header->submeshCount, header->submeshStride) ||
+                 !fits(header->lodOffset, header->lodCount, header->lodStride) ||
+                 !fits(header->meshletOffset, header->meshletCount, header->meshletStride))
+            problem = "damaged mesh file";
+        if (!problem) {
+            // the indices are checked once here, so the GPU never reads outside of the vertex buffer
+            data = bytes;
+            for (size_t i = 0; i < header->indexCount && !problem; i++)
+                if (index(i) >= header->vertexCount)
+                    problem = "damaged mesh file";
+            for (uint32_t i = 0; i < header->submeshCount && !problem; i++)
+                if (submeshes()[i].firstIndex > header->indexCount ||
+                    submeshes()[i].indexCount > header->indexCount - submeshes()[i].firstIndex)
+                    problem = "damaged mesh file";
+            for (uint32_t i = 0; i < header->lodCount && !problem; i++)
+                if (lods()[i].firstIndex > header->indexCount ||
+                    lods()[i].indexCount > header->indexCount - lods()[i].firstIndex ||
+                    lods()[i].firstMeshlet > header->meshletCount ||
+                    lods()[i].meshletCount > header->meshletCount - lods()[i].firstMeshlet)
+                    problem = "damaged mesh file";
+            for (uint32_t i = 0; i < header->meshletCount && !problem; i++)
+                if (meshlets()[i].firstIndex > header->indexCount ||
+                    meshlets()[i].indexCount > header->indexCount - meshlets()[i].firstIndex)
+                    problem = "damaged mesh file";
+        }
+        if (problem) {
+            error = problem;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<obj::MappedFile> mapped;
+    std::vector<char> memory;
+    const char *data = nullptr;
+};
+
+
+// where the cache of an OBJ file is kept
+inline std::string cachePath(const std::string &path){
+    return path + ".mesh";
+}
+
+// opens the cache of the OBJ file at path, or parses the OBJ file and writes its cache if the cache is missing or the
+// OBJ file changed. The cache is up to date if the OBJ file has the same size and modification time as when it was
+// built, or the same size and content (a copy or a checkout changes the modification time, not the content).
+// If the cache can not be written (e.g. the directory is read only) the mesh is still loaded, from memory.
+// Returns false, with a message in file.error, if the OBJ file can not be read
+inline bool loadOrBuild(const std::string &path, MeshFile &file, unsigned int threads = 0){
+    SourceKey source = {};
+    if (!fileStatus(path.c_str(), source.size, source.modified)) {
+        file.close();
+        file.error = "can not open " + path;
+        return false;
+    }
+    std::string cache = cachePath(path);
+    obj::MappedFile text(path.c_str());
+    bool hashed = false;
+    if (file.open(cache)) {
+        const SourceKey &built = file.header().source;
+        if (built.size == source.size && built.modified == source.modified)
+            return true;
+        if (built.size == source.size && text.isOpen()) {
+            source.hash = hashBytes(text.data(), text.size());
+            hashed = true;
+            if (source.hash == built.hash) {
+                // same content: store the new modification time, so the next loads do not hash the file again
+                if (FILE *update = fopen(cache.c_str(), "r+b")) {
+                    fseek(update, offsetof(Header, source) + offsetof(SourceKey, modified), SEEK_SET);
+                    fwrite(&source.modified, sizeof(source.modified), 1, update);
+                    fclose(update);
+                }
+                return true;
+            }
+        }
+    }
+
+    if (!text.isOpen()) {
+        file.close();
+        file.error = "can not open " + path;
+        return false;
+    }
+    if (!hashed)
+        source.hash = hashBytes(text.data(), text.size());
+    obj::Data data;
+    if (!obj::parse(text.data(), text.data() + text.size(), data, threads)) {
+        file.close();
+        file.error = path + ": " + data.error;
+        return false;
+    }
+    IndexedMesh mesh;
+    buildIndexedMesh(data, mesh);
+    buildLods(mesh);
+    buildMeshlets(mesh);
+    std::vector<char> bytes = serialize(mesh, source);
+    writeFile(cache, bytes); // the cache only makes the next loads faster, the mesh is loaded even if it fails
+    return file.open(std::move(bytes));
+}
+
+} // namespace meshcache
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MESH_CACHE_H
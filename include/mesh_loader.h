@@ -0,0 +1,95 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MESH_LOADER_H
+#define ITU_GRAPHICS_PROGRAMMING_MESH_LOADER_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_pipeline.h"
+#include "mesh_cache.h"
+
+
+// loads mesh files (see mesh_cache.h) on a pool of worker threads
+//
+// request() returns right away, a worker parses the OBJ file (or maps its cache) and the finished mesh files come back
+// through poll(), in the order they are finished. Nothing here touches OpenGL: the thread that owns the context polls
+// the results and uploads them, e.g. a few every frame, so the window keeps running while the models load.
+class MeshLoader {
+public:
+    struct Result {
+        unsigned int id; // what request() returned
+        std::string path;
+        std::unique_ptr<meshcache::MeshFile> file; // nullptr if the file could not be loaded
+        std::string error;
+    };
+
+    // threads workers, 0 is one per core but one (the core that renders)
+    explicit MeshLoader(unsigned int threads = 0){
+        if (threads == 0)
+            threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (unsigned int i = 0; i < threads; i++)
+            workers.emplace_back([this]{ work(); });
+    }
+
+    // the requests that have not started are dropped, the ones that are loading are finished
+    ~MeshLoader(){
+        requests.close();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    MeshLoader(const MeshLoader &) = delete;
+    MeshLoader &operator=(const MeshLoader &) = delete;
+
+    // loads the mesh of the OBJ file at path, returns the id of its result
+    unsigned int request(const std::string &path){
+        unsigned int id = nextId++;
+        pendingCount++;
+        requests.push(Request{id, path});
+        return id;
+    }
+
+    // the next finished mesh, returns false if there is none yet
+    bool poll(Result &result){
+        if (!results.tryPop(result))
+            return false;
+        pendingCount--;
+        return true;
+    }
+
+    // requests that have not been polled yet
+    unsigned int pending() const { return pendingCount; }
+
+private:
+    struct Request {
+        unsigned int id;
+        std::string path;
+    };
+
+    void work(){
+        Request request;
+        while (requests.pop(request)) {
+            Result result;
+            result.id = request.id;
+            result.path = request.path;
+            result.file.reset(new meshcache::MeshFile());
+            // the files are loaded in parallel, one thread each is enough
+            if (!meshcache::loadOrBuild(request.path, *result.file, 1)) {
+                result.error = result.file->error;
+                result.file.reset();
+            }
+            results.push(std::move(result));
+        }
+    }
+
+    FrameQueue<Request> requests;
+    FrameQueue<Result> results;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> nextId{0}, pendingCount{0};
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MESH_LOADER_H
@@ -0,0 +1,299 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MESH_OPTIMIZER_H
+#define ITU_GRAPHICS_PROGRAMMING_MESH_OPTIMIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+
+// reorders the triangles and the vertices of indexed meshes so the GPU (or a software renderer) does less work
+//
+//  - optimizeVertexCache: orders the triangles so the vertices they share are still in the post-transform cache
+//    (the vertex shader runs once for them), with the linear-speed vertex cache optimisation of Tom Forsyth
+//  - optimizeOverdraw: splits that order in clusters where the cache starts over anyway, and draws first the clusters
+//    that face away from the center of the mesh, which tend to hide the others (Sander, Nehab and Barczak, "Fast
+//    triangle reordering for vertex locality and reduced overdraw"), so fewer fragments are shaded and then covered.
+//    overdrawOrder gives that order for clusters chosen by the caller (e.g. meshlets)
+//  - optimizeVertexFetch: numbers the vertices in the order the triangles use them, so the vertices are read
+//    sequentially from memory
+// analyzeVertexCache measures the result with a FIFO cache: ACMR is the average number of vertex shader runs per
+// triangle (3 without any reuse, 0.5 at best on a big regular grid), ATVR the runs per vertex (1 at best).
+namespace meshoptimizer {
+
+struct CacheStats {
+    float acmr = 0.f; // average cache miss ratio, vertex shader runs per triangle
+    float atvr = 0.f; // average transformed vertex ratio, vertex shader runs per vertex
+};
+
+// simulates a FIFO post-transform cache of cacheSize vertices on the triangles of indices
+inline CacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                                     unsigned int cacheSize = 16){
+    CacheStats stats;
+    if (indexCount < 3)
+        return stats;
+    // a vertex is in the cache if fewer than cacheSize vertices were added after it
+    std::vector<size_t> addedAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, usedVertices = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t vertex = indices[i];
+        if (addedAt[vertex] == 0 || misses + 1 - addedAt[vertex] > cacheSize) {
+            misses++;
+            addedAt[vertex] = misses;
+        }
+        if (!used[vertex]) {
+            used[vertex] = true;
+            usedVertices++;
+        }
+    }
+    stats.acmr = (float) misses / (indexCount / 3);
+    stats.atvr = (float) misses / usedVertices;
+    return stats;
+}
+
+
+namespace detail {
+
+// size of the LRU cache the vertex cache optimization plans for
+const int cacheSize = 32;
+
+inline float vertexScore(int cachePosition, unsigned int remainingTriangles){
+    if (remainingTriangles == 0)
+        return -1.f;
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        // the vertices of the last triangle get the same score, so the next triangle does not favour one of its edges
+        if (cachePosition < 3)
+            score = .75f;
+        else
+            score = std::pow(1.f - float(cachePosition - 3) / (cacheSize - 3), 1.5f);
+    }
+    // vertices with few triangles left are finished first, so they do not have to come back in the cache later
+    return score + 2.f / std::sqrt((float) remainingTriangles);
+}
+
+} // namespace detail
+
+
+// reorders the triangles of indices (indexCount / 3 of them, the vertices go from 0 to vertexCount - 1) for the
+// post-transform vertex cache
+inline void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount){
+    using namespace detail;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    // the triangles of each vertex (the ones not drawn yet first), in one array
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0), remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        remaining[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<uint32_t> vertexTriangles(triangleCount * 3), filled(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[t * 3 + corner];
+            vertexTriangles[firstTriangle[vertex] + filled[vertex]++] = (uint32_t) t;
+        }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount), triangleScore(triangleCount, 0.f);
+    for (size_t v = 0; v < vertexCount; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int corner = 0; corner < 3; corner++)
+            triangleScore[t] += score[indices[t * 3 + corner]];
+
+    std::vector<bool> drawn(triangleCount, false);
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+    size_t nextUndrawn = 0; // where to look for a triangle when none of the cache is left
+    int64_t best = -1;
+
+    while (order.size() < triangleCount) {
+        if (best < 0) {
+            // a dead end: no triangle uses the cached vertices, start again from the first triangle not drawn
+            while (drawn[nextUndrawn]) nextUndrawn++;
+            best = (int64_t) nextUndrawn;
+        }
+        uint32_t triangle = (uint32_t) best;
+        drawn[triangle] = true;
+        order.push_back(triangle);
+
+        // the vertices of the triangle go to the front of the cache, the ones that fall out are evicted
+        newCache.clear();
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            newCache.push_back(vertex);
+            // remove the triangle from the triangles left of the vertex
+            uint32_t *begin = &vertexTriangles[firstTriangle[vertex]];
+            uint32_t *position = std::find(begin, begin + remaining[vertex], triangle);
+            std::swap(*position, begin[remaining[vertex] - 1]);
+            remaining[vertex]--;
+        }
+        for (uint32_t vertex : cache)
+            if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+                newCache.push_back(vertex);
+        for (size_t i = cacheSize; i < newCache.size(); i++)
+            cachePosition[newCache[i]] = -1;
+        // only the scores of the vertices that were in the cache changed, all of them are updated before the best
+        // triangle is chosen, since a triangle can have several of its vertices in the cache
+        for (size_t i = 0; i < newCache.size(); i++) {
+            uint32_t vertex = newCache[i];
+            if (i < (size_t) cacheSize)
+                cachePosition[vertex] = (int) i;
+            float change = vertexScore(cachePosition[vertex], remaining[vertex]) - score[vertex];
+            score[vertex] += change;
+            for (uint32_t j = 0; j < remaining[vertex]; j++)
+                triangleScore[vertexTriangles[firstTriangle[vertex] + j]] += change;
+        }
+        // the next triangle is the best one of the vertices left in the cache
+        newCache.resize(std::min<size_t>(newCache.size(), cacheSize));
+        best = -1;
+        float bestScore = -1.f;
+        for (uint32_t vertex : newCache)
+            for (uint32_t j = 0; j < remaining[vertex]; j++) {
+                uint32_t t = vertexTriangles[firstTriangle[vertex] + j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        std::swap(cache, newCache);
+    }
+
+    std::vector<uint32_t> reordered(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; i++)
+        std::copy(indices + order[i] * 3, indices + order[i] * 3 + 3, &reordered[i * 3]);
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+
+// the order to draw clusters of the triangles of indices in, so the ones that are likely to hide the others come first.
+// Cluster c is the triangles from clusterStarts[c] to clusterStarts[c + 1] (excluded), the last element of
+// clusterStarts is the number of triangles. The position of vertex v is the 3 floats at positions + v * stride bytes
+inline std::vector<size_t> overdrawOrder(const uint32_t *indices, const std::vector<size_t> &clusterStarts,
+                                         const float *positions, size_t stride){
+    size_t clusterCount = clusterStarts.empty() ? 0 : clusterStarts.size() - 1;
+    std::vector<size_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    if (clusterCount < 2)
+        return clusterOrder;
+    auto position = [&](uint32_t vertex){
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    };
+
+    // area weighted center and normal of each cluster, and center of the mesh
+    std::vector<float> clusterCenter(clusterCount * 3, 0.f), clusterNormal(clusterCount * 3, 0.f);
+    double meshCenter[3] = {0.0, 0.0, 0.0}, meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; c++) {
+        double center[3] = {0.0, 0.0, 0.0}, normal[3] = {0.0, 0.0, 0.0}, area = 0.0;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const float *a = position(indices[t * 3]), *b = position(indices[t * 3 + 1]);
+            const float *d = position(indices[t * 3 + 2]);
+            double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+            double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            double triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * .5;
+            for (int axis = 0; axis < 3; axis++) {
+                center[axis] += (a[axis] + b[axis] + d[axis]) / 3.0 * triangleArea;
+                normal[axis] += n[axis];
+            }
+            area += triangleArea;
+        }
+        double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int axis = 0; axis < 3; axis++) {
+            meshCenter[axis] += center[axis];
+            clusterCenter[c * 3 + axis] = float(area > 0.0 ? center[axis] / area : 0.0);
+            clusterNormal[c * 3 + axis] = float(normalLength > 0.0 ? normal[axis] / normalLength : 0.0);
+        }
+        meshArea += area;
+    }
+    for (double &axis : meshCenter)
+        axis = meshArea > 0.0 ? axis / meshArea : 0.0;
+
+    // clusters facing away from the center are on the outside of the mesh, in front of the others from most views
+    std::vector<float> occlusion(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        occlusion[c] = 0.f;
+        for (int axis = 0; axis < 3; axis++)
+            occlusion[c] += float(clusterCenter[c * 3 + axis] - meshCenter[axis]) * clusterNormal[c * 3 + axis];
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+                     [&](size_t a, size_t b){ return occlusion[a] > occlusion[b]; });
+    return clusterOrder;
+}
+
+// reorders clusters of the triangles of indices (ordered by optimizeVertexCache) to draw the ones that are likely to
+// hide the others first (see overdrawOrder). A cluster starts where all three vertices of a triangle miss the FIFO
+// cache of cacheSize vertices, there the cache starts over whatever came before, so moving the clusters barely
+// changes the ACMR. The position of vertex v is the 3 floats at positions + v * stride bytes
+inline void optimizeOverdraw(uint32_t *indices, size_t indexCount, const float *positions, size_t stride,
+                             size_t vertexCount, unsigned int cacheSize = 16){
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    std::vector<size_t> clusterStarts;
+    std::vector<size_t> addedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        int triangleMisses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[t * 3 + corner];
+            if (addedAt[vertex] == 0 || misses + 1 - addedAt[vertex] > cacheSize) {
+                misses++;
+                triangleMisses++;
+                addedAt[vertex] = misses;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusterStarts.push_back(t);
+    }
+    clusterStarts.push_back(triangleCount);
+    if (clusterStarts.size() < 3)
+        return;
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(triangleCount * 3);
+    for (size_t c : overdrawOrder(indices, clusterStarts, positions, stride))
+        reordered.insert(reordered.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+
+// numbers the vertices in the order indices first use them, rewrites indices, and returns remap: the new number of each
+// vertex (vertices that no triangle uses go last, in their order)
+inline std::vector<uint32_t> optimizeVertexFetch(uint32_t *indices, size_t indexCount, size_t vertexCount){
+    const uint32_t unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        if (remap[indices[i]] == unused)
+            remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (uint32_t &vertex : remap)
+        if (vertex == unused)
+            vertex = next++;
+    return remap;
+}
+
+// moves the elements of vertices to the positions given by remap (see optimizeVertexFetch)
+template<class Vertex>
+void remapVertices(std::vector<Vertex> &vertices, const std::vector<uint32_t> &remap){
+    std::vector<Vertex> remapped(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+        remapped[remap[v]] = vertices[v];
+    vertices.swap(remapped);
+}
+
+} // namespace meshoptimizer
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MESH_OPTIMIZER_H
@@ -0,0 +1,410 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MESH_SIMPLIFIER_H
+#define ITU_GRAPHICS_PROGRAMMING_MESH_SIMPLIFIER_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+
+// simplifies indexed triangle meshes, to draw distant objects with fewer triangles (levels of detail)
+//
+// The edges are collapsed in the order of the quadric error metric (Garland and Heckbert, "Surface simplification
+// using quadric error metrics"): every position has the sum of the squared distances to the planes of its triangles,
+// and the collapse that moves the surface the least is done first. An edge collapses to one of its ends, so the
+// simplified triangles use a subset of the original vertices, and all the levels share one vertex buffer.
+// The vertices split by their normals or uvs (the seams) stay where they are, so the seams do not open, the open
+// borders only collapse along themselves, and no collapse flips a triangle or makes the mesh non manifold.
+namespace meshsimplifier {
+
+struct Level {
+    std::vector<uint32_t> indices;
+    // the largest distance, in the units of the positions, the surface moved by (estimated by the quadrics)
+    float error = 0.f;
+};
+
+namespace detail {
+
+// a symmetric 4x4 matrix, the sum of the squared distances to planes, times the weights of the planes
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+    double weight = 0;
+
+    // the plane n.p + d = 0, n of length 1
+    void addPlane(const double n[3], double d, double planeWeight){
+        xx += planeWeight * n[0] * n[0]; xy += planeWeight * n[0] * n[1]; xz += planeWeight * n[0] * n[2];
+        xw += planeWeight * n[0] * d; yy += planeWeight * n[1] * n[1]; yz += planeWeight * n[1] * n[2];
+        yw += planeWeight * n[1] * d; zz += planeWeight * n[2] * n[2]; zw += planeWeight * n[2] * d;
+        ww += planeWeight * d * d;
+        weight += planeWeight;
+    }
+
+    void add(const Quadric &q){
+        xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw; yy += q.yy; yz += q.yz; yw += q.yw; zz += q.zz; zw += q.zw;
+        ww += q.ww;
+        weight += q.weight;
+    }
+
+    // weighted sum of the squared distances of p to the planes
+    double evaluate(const float p[3]) const {
+        double x = p[0], y = p[1], z = p[2];
+        return xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x + yy * y * y + 2 * yz * y * z + 2 * yw * y +
+               zz * z * z + 2 * zw * z + ww;
+    }
+};
+
+struct Collapse {
+    float cost; // mean squared distance
+    uint32_t from, to; // positions
+    // of the quadrics of from and to when the cost was computed, the cost is stale once either of them grew
+    uint32_t fromVersion, toVersion;
+
+    bool operator<(const Collapse &other) const { return cost > other.cost; } // the cheapest on top of the queue
+};
+
+// cross product of b - a and c - a
+inline void cross(const float *a, const float *b, const float *c, double n[3]){
+    double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+inline double length(const double v[3]){
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// the planes of the triangles are weighted by their area, the planes that keep the borders by the squared length of
+// the edge times this
+const double borderWeight = 10.0;
+
+// a triangle keeps its orientation if its normal turns by less than about 80 degrees
+const double minNormalCosine = .2;
+
+} // namespace detail
+
+
+// simplifies the triangles of indices (indexCount / 3 of them, using vertexCount vertices, the position of vertex v
+// is the 3 floats at positions + v * stride bytes) down to each triangle count of targetTriangles, in decreasing
+// order, and returns a level for each. It stops earlier, with fewer levels, when the next collapse would move the
+// surface by more than maxError or no collapse is left; then the last level has the triangles that are left, if it
+// has fewer than the previous level
+inline std::vector<Level> simplify(const float *positions, size_t stride, size_t vertexCount, const uint32_t *indices,
+                                   size_t indexCount, const std::vector<size_t> &targetTriangles,
+                                   float maxError = FLT_MAX){
+    using namespace detail;
+    std::vector<Level> levels;
+    size_t triangleCount = indexCount / 3;
+    auto vertexPosition = [&](uint32_t vertex){
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    };
+
+    // the vertices with the same position (the wedges of a position) move together
+    std::vector<uint32_t> positionOf(vertexCount, 0), wedge, wedgeCount;
+    {
+        struct Key {
+            uint32_t bits[3];
+            bool operator==(const Key &other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+        };
+        struct KeyHash {
+            size_t operator()(const Key &key) const {
+                uint64_t hash = 14695981039346656037ull;
+                for (uint32_t word : key.bits)
+                    hash = (hash ^ word) * 1099511628211ull;
+                return (size_t) (hash ^ (hash >> 32));
+            }
+        };
+        std::unordered_map<Key, uint32_t, KeyHash> positionIds;
+        positionIds.reserve(vertexCount);
+        std::vector<bool> used(vertexCount, false);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            used[indices[i]] = true;
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            if (!used[v])
+                continue;
+            Key key;
+            memcpy(key.bits, vertexPosition(v), sizeof(key.bits));
+            auto inserted = positionIds.emplace(key, (uint32_t) wedge.size());
+            if (inserted.second) {
+                wedge.push_back(v);
+                wedgeCount.push_back(0);
+            }
+            positionOf[v] = inserted.first->second;
+            wedgeCount[positionOf[v]]++;
+        }
+    }
+    size_t positionCount = wedge.size();
+    auto point = [&](uint32_t position){ return vertexPosition(wedge[position]); };
+
+    std::vector<uint32_t> corners(indices, indices + triangleCount * 3);
+    std::vector<bool> alive(triangleCount, true);
+    std::vector<std::vector<uint32_t>> positionTriangles(positionCount);
+    std::vector<Quadric> quadrics(positionCount);
+    size_t aliveCount = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        uint32_t a = positionOf[corners[t * 3]], b = positionOf[corners[t * 3 + 1]], c = positionOf[corners[t * 3 + 2]];
+        if (a == b || b == c || a == c) {
+            alive[t] = false;
+            continue;
+        }
+        aliveCount++;
+        for (uint32_t position : {a, b, c})
+            positionTriangles[position].push_back((uint32_t) t);
+        const float *pa = point(a);
+        double n[3];
+        cross(pa, point(b), point(c), n);
+        double doubleArea = length(n);
+        if (doubleArea == 0.0)
+            continue;
+        for (double &axis : n)
+            axis /= doubleArea;
+        Quadric plane;
+        plane.addPlane(n, -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]), doubleArea * .5);
+        for (uint32_t position : {a, b, c})
+            quadrics[position].add(plane);
+    }
+
+    // the edges with one triangle are borders, the ones with more than two make their ends non manifold
+    std::vector<bool> border(positionCount, false), locked(positionCount, false);
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    edgeTriangles.reserve(aliveCount * 2);
+    auto edgeKey = [](uint32_t a, uint32_t b){ return a < b ? (uint64_t) a << 32 | b : (uint64_t) b << 32 | a; };
+    auto cornerPosition = [&](size_t t, int corner){ return positionOf[corners[t * 3 + corner % 3]]; };
+    for (size_t t = 0; t < triangleCount; t++)
+        if (alive[t])
+            for (int corner = 0; corner < 3; corner++)
+                edgeTriangles[edgeKey(cornerPosition(t, corner), cornerPosition(t, corner + 1))]++;
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (!alive[t])
+            continue;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t a = cornerPosition(t, corner), b = cornerPosition(t, corner + 1);
+            uint32_t count = edgeTriangles[edgeKey(a, b)];
+            if (count > 2)
+                locked[a] = locked[b] = true;
+            if (count != 1)
+                continue;
+            // a plane through the border, perpendicular to the triangle, keeps the border where it is
+            border[a] = border[b] = true;
+            const float *pa = point(a), *pb = point(b);
+            double normal[3], edge[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            cross(pa, pb, point(cornerPosition(t, corner + 2)), normal);
+            double n[3] = {edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2],
+                           edge[0] * normal[1] - edge[1] * normal[0]};
+            double planeLength = length(n);
+            if (planeLength == 0.0)
+                continue;
+            for (double &axis : n)
+                axis /= planeLength;
+            double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+            Quadric plane;
+            plane.addPlane(n, -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]), edgeLengthSquared * borderWeight);
+            // the plane only keeps the position, it does not weigh in the mean distance of the error
+            plane.weight = 0.0;
+            quadrics[a].add(plane);
+            quadrics[b].add(plane);
+        }
+    }
+
+    std::vector<uint32_t> version(positionCount, 0);
+    std::vector<bool> removed(positionCount, false);
+    std::priority_queue<Collapse> queue;
+    // a position with several wedges, or a non manifold one, does not move (other positions can collapse onto it), a
+    // border position only moves along the border
+    auto push = [&](uint32_t from, uint32_t to, bool borderEdge){
+        if (wedgeCount[from] > 1 || locked[from] || (border[from] && !borderEdge))
+            return;
+        Quadric sum = quadrics[from];
+        sum.add(quadrics[to]);
+        double cost = sum.weight > 0.0 ? std::max(0.0, sum.evaluate(point(to)) / sum.weight) : 0.0;
+        queue.push(Collapse{(float) cost, from, to, version[from], version[to]});
+    };
+    for (const auto &edge : edgeTriangles) {
+        uint32_t a = (uint32_t) (edge.first >> 32), b = (uint32_t) edge.first;
+        push(a, b, edge.second == 1);
+        push(b, a, edge.second == 1);
+    }
+
+    std::vector<uint32_t> neighbourMark(positionCount, 0);
+    uint32_t mark = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> neighbours; // position, triangles of the edge
+    double largestCost = 0.0;
+    size_t nextTarget = 0;
+    size_t lastLevelTriangles = triangleCount;
+
+    auto emit = [&](){
+        Level level;
+        level.indices.reserve(aliveCount * 3);
+        for (size_t t = 0; t < triangleCount; t++)
+            if (alive[t])
+                level.indices.insert(level.indices.end(), &corners[t * 3], &corners[t * 3 + 3]);
+        level.error = (float) std::sqrt(largestCost);
+        levels.push_back(std::move(level));
+        lastLevelTriangles = aliveCount;
+    };
+
+    while (nextTarget < targetTriangles.size() && aliveCount <= targetTriangles[nextTarget]) {
+        emit();
+        nextTarget++;
+    }
+    double maxCost = maxError < FLT_MAX ? (double) maxError * maxError : DBL_MAX;
+    while (nextTarget < targetTriangles.size() && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+        uint32_t from = collapse.from, to = collapse.to;
+        if (removed[from] || removed[to] || collapse.fromVersion != version[from] || collapse.toVersion != version[to])
+            continue;
+        if (collapse.cost > maxCost)
+            break;
+
+        // the triangles of the edge, the wedge of to they use must be the same, it replaces the wedge of from
+        std::vector<uint32_t> &fromTriangles = positionTriangles[from];
+        uint32_t toWedge = UINT32_MAX, edgeCount = 0;
+        bool valid = true;
+        for (uint32_t t : fromTriangles) {
+            if (!alive[t])
+                continue;
+            for (int corner = 0; corner < 3; corner++)
+                if (cornerPosition(t, corner) == to) {
+                    edgeCount++;
+                    if (toWedge != UINT32_MAX && toWedge != corners[t * 3 + corner])
+                        valid = false;
+                    toWedge = corners[t * 3 + corner];
+                }
+        }
+        if (edgeCount == 0 || edgeCount > 2 || (border[from] && edgeCount != 1) || !valid)
+            continue;
+
+        // link condition: the two ends only share the neighbours of the triangles of the edge, else the collapse
+        // would glue two sheets of the surface together
+        mark++;
+        for (uint32_t t : fromTriangles)
+            if (alive[t])
+                for (int corner = 0; corner < 3; corner++)
+                    neighbourMark[cornerPosition(t, corner)] = mark;
+        uint32_t shared = 0;
+        for (uint32_t t : positionTriangles[to]) {
+            if (!alive[t])
+                continue;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = cornerPosition(t, corner);
+                if (position != from && position != to && neighbourMark[position] == mark) {
+                    shared++;
+                    neighbourMark[position] = 0; // counted once
+                }
+            }
+        }
+        if (shared != edgeCount)
+            continue;
+
+        // the triangles that stay must not flip or become degenerate
+        const float *target = point(to);
+        for (uint32_t t : fromTriangles) {
+            if (!alive[t] || !valid)
+                continue;
+            const float *p[3], *moved[3];
+            bool hasTo = false;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = cornerPosition(t, corner);
+                hasTo |= position == to;
+                p[corner] = point(position);
+                moved[corner] = position == from ? target : p[corner];
+            }
+            if (hasTo)
+                continue;
+            double before[3], after[3];
+            cross(p[0], p[1], p[2], before);
+            cross(moved[0], moved[1], moved[2], after);
+            double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            double beforeLength = length(before), afterLength = length(after);
+            // a triangle that is already degenerate has no orientation to keep
+            if (beforeLength > 0.0 && (afterLength == 0.0 || dot < minNormalCosine * beforeLength * afterLength))
+                valid = false;
+        }
+        if (!valid)
+            continue;
+
+        // collapse: the triangles of the edge disappear, the others use the wedge of to
+        std::vector<uint32_t> &toTriangles = positionTriangles[to];
+        for (uint32_t t : fromTriangles) {
+            if (!alive[t])
+                continue;
+            bool hasTo = false;
+            for (int corner = 0; corner < 3; corner++)
+                hasTo |= cornerPosition(t, corner) == to;
+            if (hasTo) {
+                alive[t] = false;
+                aliveCount--;
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++)
+                if (cornerPosition(t, corner) == from)
+                    corners[t * 3 + corner] = toWedge;
+            toTriangles.push_back(t);
+        }
+        fromTriangles.clear();
+        fromTriangles.shrink_to_fit();
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t){ return !alive[t]; }),
+                          toTriangles.end());
+        quadrics[to].add(quadrics[from]);
+        removed[from] = true;
+        version[to]++;
+        largestCost = std::max(largestCost, (double) collapse.cost);
+
+        // the collapses of the edges of to have new costs
+        neighbours.clear();
+        for (uint32_t t : toTriangles)
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = cornerPosition(t, corner);
+                if (position == to)
+                    continue;
+                auto found = std::find_if(neighbours.begin(), neighbours.end(),
+                                          [&](const std::pair<uint32_t, uint32_t> &n){ return n.first == position; });
+                if (found == neighbours.end())
+                    neighbours.emplace_back(position, 1);
+                else
+                    found->second++;
+            }
+        for (const auto &neighbour : neighbours) {
+            push(to, neighbour.first, neighbour.second == 1);
+            push(neighbour.first, to, neighbour.second == 1);
+        }
+
+        while (nextTarget < targetTriangles.size() && aliveCount <= targetTriangles[nextTarget]) {
+            emit();
+            nextTarget++;
+        }
+    }
+    if (nextTarget < targetTriangles.size() && aliveCount < lastLevelTriangles)
+        emit();
+    return levels;
+}
+
+
+// how many pixels one unit at a distance of one unit covers, for a perspective projection with a vertical field of
+// view of fovy radians on a viewport viewportHeight pixels high
+inline float pixelScale(float fovy, float viewportHeight){
+    return viewportHeight / (2.f * std::tan(fovy * .5f));
+}
+
+// the coarsest of count levels (from the finest, the errors increasing) whose error, seen from distance, covers at
+// most maxPixelError pixels. Level has an error member, in the same units as distance
+template<class Level>
+size_t selectLevel(const Level *levels, size_t count, float distance, float pixelScale, float maxPixelError){
+    size_t selected = 0;
+    distance = std::max(distance, 1e-6f);
+    for (size_t i = 1; i < count; i++)
+        if (levels[i].error * pixelScale / distance <= maxPixelError)
+            selected = i;
+    return selected;
+}
+
+} // namespace meshsimplifier
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MESH_SIMPLIFIER_H
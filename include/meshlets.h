@@ -0,0 +1,265 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MESHLETS_H
+#define ITU_GRAPHICS_PROGRAMMING_MESHLETS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// splits indexed triangle meshes in small clusters of neighbouring triangles (meshlets), that are culled as a whole
+//
+// Each meshlet has a bounding sphere and a cone that contains the normals of its triangles. Before drawing, a
+// meshlet outside of the view frustum, or whose triangles all face away from the camera, is skipped: a test per
+// meshlet instead of clipping or rasterizing its (up to) maxTriangles triangles.
+// The tests are done in model space, the frustum and the camera position are taken from the model view projection
+// matrix, so the same code serves OpenGL draws (ranges of indices) and the software renderer (ranges of vertices).
+namespace meshlets {
+
+struct Meshlet {
+    uint32_t firstIndex, indexCount; // the triangles of the meshlet, consecutive
+    float center[3], radius; // bounding sphere
+    // the normals of the triangles are within the cone around coneAxis, the meshlet faces away from the points where
+    // dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius. coneCutoff is 1 or more when no point is
+    // guaranteed to see only back faces (e.g. the triangles face in opposite directions)
+    float coneAxis[3], coneCutoff;
+};
+
+// the sizes the meshlets are limited to, about the sizes the GPUs that draw meshlets natively work best with
+const unsigned int defaultMaxVertices = 64;
+const unsigned int defaultMaxTriangles = 124;
+
+
+// bounding sphere and normal cone of the triangles of meshlet, the position of vertex v is the 3 floats at
+// positions + v * stride bytes
+inline void computeBounds(Meshlet &meshlet, const uint32_t *indices, const float *positions, size_t stride){
+    auto position = [&](uint32_t vertex){
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    };
+    const uint32_t *triangles = indices + meshlet.firstIndex;
+    float boundsMin[3] = {INFINITY, INFINITY, INFINITY}, boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; i < meshlet.indexCount; i++)
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], position(triangles[i])[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], position(triangles[i])[axis]);
+        }
+    float radiusSquared = 0.f;
+    for (int axis = 0; axis < 3; axis++)
+        meshlet.center[axis] = meshlet.indexCount ? (boundsMin[axis] + boundsMax[axis]) * .5f : 0.f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        const float *p = position(triangles[i]);
+        float d[3] = {p[0] - meshlet.center[0], p[1] - meshlet.center[1], p[2] - meshlet.center[2]};
+        radiusSquared = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // the axis is the mean of the normals, the cutoff comes from the normal that is the furthest from it
+    std::vector<float> normals;
+    float axis[3] = {0.f, 0.f, 0.f};
+    for (uint32_t t = 0; t + 2 < meshlet.indexCount; t += 3) {
+        const float *a = position(triangles[t]), *b = position(triangles[t + 1]), *c = position(triangles[t + 2]);
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.f)
+            continue;
+        for (int i = 0; i < 3; i++) {
+            normals.push_back(n[i] / length);
+            axis[i] += n[i] / length;
+        }
+    }
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minDot = 1.f;
+    for (size_t i = 0; i < normals.size(); i += 3)
+        minDot = std::min(minDot, (normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]) /
+                                  std::max(axisLength, 1e-12f));
+    for (int i = 0; i < 3; i++)
+        meshlet.coneAxis[i] = axisLength > 0.f ? axis[i] / axisLength : 0.f;
+    // with normals at 90 degrees or more from the axis, some triangle faces every point
+    meshlet.coneCutoff = axisLength > 0.f && minDot > 0.f ? std::sqrt(1.f - minDot * minDot) : 2.f;
+}
+
+
+// reorders the triangles of indices (indexCount / 3 of them, using vertexCount vertices, see computeBounds for
+// positions and stride) so they are meshlets of consecutive triangles, and returns the meshlets. A meshlet grows from
+// the first triangle left, in the order of indices, by the neighbouring triangle that adds the fewest vertices and
+// keeps the normals the closest, until it has maxVertices vertices or maxTriangles triangles
+inline std::vector<Meshlet> buildMeshlets(uint32_t *indices, size_t indexCount, const float *positions, size_t stride,
+                                          size_t vertexCount, unsigned int maxVertices = defaultMaxVertices,
+                                          unsigned int maxTriangles = defaultMaxTriangles){
+    std::vector<Meshlet> meshlets;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return meshlets;
+    auto position = [&](uint32_t vertex){
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    };
+
+    // the triangles of each vertex, and the normal of each triangle
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0), vertexTriangles(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        firstTriangle[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] += firstTriangle[v];
+    std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        vertexTriangles[filled[indices[i]]++] = (uint32_t) (i / 3);
+    std::vector<float> normals(triangleCount * 3, 0.f);
+    for (size_t t = 0; t < triangleCount; t++) {
+        const float *a = position(indices[t * 3]), *b = position(indices[t * 3 + 1]), *c = position(indices[t * 3 + 2]);
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int axis = 0; axis < 3 && length > 0.f; axis++)
+            normals[t * 3 + axis] = n[axis] / length;
+    }
+
+    std::vector<bool> used(triangleCount, false);
+    std::vector<uint32_t> inMeshlet(vertexCount, UINT32_MAX); // the meshlet a vertex was last added to
+    std::vector<uint32_t> order, candidates;
+    order.reserve(triangleCount);
+    size_t nextUnused = 0;
+    while (order.size() < triangleCount) {
+        while (used[nextUnused]) nextUnused++;
+        uint32_t id = (uint32_t) meshlets.size();
+        Meshlet meshlet = {};
+        meshlet.firstIndex = (uint32_t) order.size() * 3;
+        unsigned int vertices = 0, triangles = 0;
+        float normal[3] = {0.f, 0.f, 0.f};
+        candidates.clear();
+
+        int64_t next = (int64_t) nextUnused;
+        while (next >= 0) {
+            uint32_t triangle = (uint32_t) next;
+            used[triangle] = true;
+            order.push_back(triangle);
+            triangles++;
+            for (int axis = 0; axis < 3; axis++)
+                normal[axis] += normals[triangle * 3 + axis];
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                if (inMeshlet[vertex] == id)
+                    continue;
+                inMeshlet[vertex] = id;
+                vertices++;
+                candidates.insert(candidates.end(), &vertexTriangles[firstTriangle[vertex]],
+                                  &vertexTriangles[firstTriangle[vertex + 1]]);
+            }
+            if (triangles == maxTriangles)
+                break;
+
+            // the neighbour that adds the fewest vertices, then the one whose normal is the closest to the meshlet's
+            next = -1;
+            float bestScore = INFINITY;
+            size_t kept = 0;
+            for (uint32_t candidate : candidates) {
+                if (used[candidate])
+                    continue;
+                candidates[kept++] = candidate;
+                unsigned int added = 0;
+                for (int corner = 0; corner < 3; corner++)
+                    added += inMeshlet[indices[candidate * 3 + corner]] != id;
+                if (vertices + added > maxVertices)
+                    continue;
+                float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                float alignment = length > 0.f ? (normals[candidate * 3] * normal[0] + normals[candidate * 3 + 1] *
+                                                  normal[1] + normals[candidate * 3 + 2] * normal[2]) / length : 1.f;
+                float score = added + (1.f - alignment);
+                if (score < bestScore) {
+                    bestScore = score;
+                    next = candidate;
+                }
+            }
+            candidates.resize(kept);
+        }
+        meshlet.indexCount = triangles * 3;
+        meshlets.push_back(meshlet);
+    }
+
+    std::vector<uint32_t> reordered(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; i++)
+        std::copy(indices + order[i] * 3, indices + order[i] * 3 + 3, &reordered[i * 3]);
+    std::copy(reordered.begin(), reordered.end(), indices);
+    for (Meshlet &meshlet : meshlets)
+        computeBounds(meshlet, indices, positions, stride);
+    return meshlets;
+}
+
+
+// the planes of a view frustum, in the space the matrix it comes from transforms to clip space, with their normals
+// pointing inside: a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for the 6 planes
+struct Frustum {
+    float planes[6][4];
+};
+
+// the frustum of a model view projection matrix (column major, like glm and OpenGL), in model space
+inline Frustum frustumFromMatrix(const float *matrix){
+    Frustum frustum;
+    auto row = [&](int r, int c){ return matrix[c * 4 + r]; };
+    // left, right, bottom, top, near, far: the last row plus or minus the rows of x, y and z
+    for (int plane = 0; plane < 6; plane++) {
+        int r = plane / 2;
+        float sign = plane % 2 == 0 ? 1.f : -1.f;
+        float length = 0.f;
+        for (int c = 0; c < 4; c++)
+            frustum.planes[plane][c] = row(3, c) + sign * row(r, c);
+        for (int c = 0; c < 3; c++)
+            length += frustum.planes[plane][c] * frustum.planes[plane][c];
+        length = std::sqrt(length);
+        for (int c = 0; c < 4 && length > 0.f; c++)
+            frustum.planes[plane][c] /= length;
+    }
+    return frustum;
+}
+
+// the camera position of a perspective model view projection matrix (column major), in model space: the point that
+// projects to w = 0 at the center of the view. Returns false for other projections (e.g. orthographic)
+inline bool cameraFromMatrix(const float *matrix, float camera[3]){
+    // the camera is the point p with (x, y, w) of matrix * p all 0, solved with Cramer's rule
+    auto row = [&](int r, int c){ return (double) matrix[c * 4 + r]; };
+    const int rows[3] = {0, 1, 3};
+    double a[3][3], b[3];
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 3; c++)
+            a[i][c] = row(rows[i], c);
+        b[i] = -row(rows[i], 3);
+    }
+    auto determinant = [](const double m[3][3]){
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    };
+    double d = determinant(a);
+    if (std::fabs(d) < 1e-12)
+        return false;
+    for (int c = 0; c < 3; c++) {
+        double m[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                m[i][j] = j == c ? b[i] : a[i][j];
+        camera[c] = (float) (determinant(m) / d);
+    }
+    return true;
+}
+
+// false if meshlet is outside of frustum, or if camera (in model space, nullptr to skip the test) only sees the back
+// of its triangles
+inline bool isVisible(const Meshlet &meshlet, const Frustum &frustum, const float *camera){
+    for (const float *plane : frustum.planes)
+        if (plane[0] * meshlet.center[0] + plane[1] * meshlet.center[1] + plane[2] * meshlet.center[2] + plane[3] <
+            -meshlet.radius)
+            return false;
+    if (camera && meshlet.coneCutoff < 1.f) {
+        float d[3] = {meshlet.center[0] - camera[0], meshlet.center[1] - camera[1], meshlet.center[2] - camera[2]};
+        float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        if (d[0] * meshlet.coneAxis[0] + d[1] * meshlet.coneAxis[1] + d[2] * meshlet.coneAxis[2] >=
+            meshlet.coneCutoff * distance + meshlet.radius)
+            return false;
+    }
+    return true;
+}
+
+} // namespace meshlets
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MESHLETS_H
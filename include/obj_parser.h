@@ -0,0 +1,519 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_OBJ_PARSER_H
+#define ITU_GRAPHICS_PROGRAMMING_OBJ_PARSER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OBJ_PARSER_MMAP
+#endif
+
+
+// a fast parser of Wavefront OBJ files (positions, texture coordinates, normals and faces)
+//
+// The file is mapped in memory and scanned in two passes:
+//  - the first pass only counts the lines of each kind (and the triangles of the faces), so every array is allocated
+//    once with its exact size
+//  - the second pass parses the numbers, with a hand written tokenizer, and writes them in place
+// Big files are split in chunks (at line ends) and both passes run on one thread per chunk. The counts of the first
+// pass tell where each chunk starts in the arrays, so the chunks write their part directly and there is nothing to
+// merge, the result is the same with any number of threads.
+// The numbers are parsed independently of the locale of the program (a "," locale breaks scanf("%f")), and they are
+// rounded exactly like strtof/scanf, so the result is bit for bit the one of a scanf based parser.
+//
+// Objects and groups (o and g lines) are kept as named ranges of triangles, other lines (comments, materials...) are
+// skipped. Faces with more than 3 corners are split in a fan of triangles (a quad 0 1 2 3 gives 0 1 2 and 0 2 3).
+// Negative (relative) indices are supported, and all indices are checked.
+namespace obj {
+
+// index of an attribute a face corner does not have (e.g. "f 1//1 2//2 3//3" has no texture coordinates)
+const uint32_t missing = 0xFFFFFFFFu;
+
+struct Data {
+    std::vector<float> positions; // x y z, in the order of the file
+    std::vector<float> uvs; // u v, as they are in the file (v is not flipped)
+    std::vector<float> normals; // x y z
+    std::vector<uint32_t> corners; // 3 indices per triangle corner, 0 based: position, uv (or missing), normal (or missing)
+    // the o and g lines, in the order of the file, each group goes from its first triangle to the next group
+    struct Group {
+        std::string name;
+        size_t firstTriangle;
+    };
+    std::vector<Group> groups;
+    std::string error; // why parse() failed
+
+    size_t triangleCount() const { return corners.size() / 9; }
+
+    // true if every corner has a texture coordinate and a normal
+    bool hasUvsAndNormals() const {
+        for (size_t i = 0; i < corners.size(); i += 3)
+            if (corners[i + 1] == missing || corners[i + 2] == missing)
+                return false;
+        return true;
+    }
+};
+
+
+// the content of a file, mapped in memory (read only) where the system supports it, else read in memory
+class MappedFile {
+public:
+    explicit MappedFile(const char *path){
+#ifdef OBJ_PARSER_MMAP
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            length = (size_t) info.st_size;
+            opened = true;
+            if (length > 0) {
+                void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, length, MADV_SEQUENTIAL);
+                    memory = static_cast<const char*>(mapped);
+                }
+                else
+                    opened = false;
+            }
+        }
+        close(fd);
+#else
+        FILE *file = fopen(path, "rb");
+        if (!file)
+            return;
+        char block[1 << 16];
+        size_t read;
+        while ((read = fread(block, 1, sizeof(block), file)) > 0)
+            buffer.insert(buffer.end(), block, block + read);
+        opened = !ferror(file);
+        fclose(file);
+        memory = buffer.data();
+        length = buffer.size();
+#endif
+    }
+
+    ~MappedFile(){
+#ifdef OBJ_PARSER_MMAP
+        if (memory)
+            munmap(const_cast<char*>(memory), length);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return opened; }
+    const char *data() const { return memory; }
+    size_t size() const { return length; }
+
+private:
+    const char *memory = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifndef OBJ_PARSER_MMAP
+    std::vector<char> buffer;
+#endif
+};
+
+
+namespace detail {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skipBlanks(const char *p, const char *end){
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+inline const char *skipLine(const char *p, const char *end){
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : p;
+}
+
+inline const char *skipToken(const char *p, const char *end){
+    while (p < end && !isBlank(*p) && *p != '\n') p++;
+    return p;
+}
+
+enum class Keyword {position, uv, normal, face, group, other};
+
+// reads the first word of the line at p, and returns the position after it
+inline const char *readKeyword(const char *p, const char *end, Keyword &keyword){
+    const char *word = p;
+    p = skipToken(p, end);
+    size_t length = p - word;
+    keyword = Keyword::other;
+    if (length == 1 && word[0] == 'v') keyword = Keyword::position;
+    else if (length == 1 && word[0] == 'f') keyword = Keyword::face;
+    else if (length == 1 && (word[0] == 'o' || word[0] == 'g')) keyword = Keyword::group;
+    else if (length == 2 && word[0] == 'v' && word[1] == 't') keyword = Keyword::uv;
+    else if (length == 2 && word[0] == 'v' && word[1] == 'n') keyword = Keyword::normal;
+    return p;
+}
+
+// a number parsed with a stream that uses the "C" locale, for the numbers the fast path can not round exactly
+inline float parseFloatSlow(const char *begin, const char *end){
+    std::istringstream stream(std::string(begin, end));
+    stream.imbue(std::locale::classic());
+    float value = 0.f;
+    stream >> value;
+    return value;
+}
+
+// parses a decimal number ([+-]digits[.digits][e[+-]digits]) at p, returns the position after it,
+// or nullptr if there is no number at p
+inline const char *parseFloat(const char *p, const char *end, float &value){
+    // powers of 10 that are exact in a double
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+                                    1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0, exponent = 0;
+    bool anyDigit = false, truncated = false;
+    for (; p < end && isDigit(*p); p++) {
+        anyDigit = true;
+        if (significantDigits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significantDigits += mantissa != 0;
+        }
+        else {
+            truncated |= *p != '0';
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isDigit(*p); p++) {
+            anyDigit = true;
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significantDigits += mantissa != 0;
+                exponent--;
+            }
+            else
+                truncated |= *p != '0';
+        }
+    }
+    if (!anyDigit)
+        return nullptr;
+
+    // the exponent is only part of the number if it has digits (like strtof, "1e" is the number 1 followed by "e")
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); q++)
+                e = std::min(e * 10 + (*q - '0'), 100000);
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    if (mantissa == 0) {
+        value = negative ? -0.f : 0.f;
+        return p;
+    }
+    // the mantissa and the power of 10 are exact in a double, so the product (or quotient) is rounded once to a double.
+    // Rounding it again to a float gives the correctly rounded float, unless the first rounding landed exactly on the
+    // halfway point between two floats (the 29 bits of the double below the float mantissa are 1000...0): the number
+    // may then be on either side of it, and only the slow path knows. The result is always a normal float (between
+    // 1e-22 and 2^53 * 1e22), so the halfway points are always at the same bits
+    if (!truncated && mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double) mantissa;
+        result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+        uint64_t bits;
+        std::memcpy(&bits, &result, sizeof(bits));
+        if ((bits & 0x1FFFFFFFu) != 0x10000000u) {
+            value = (float) (negative ? -result : result);
+            return p;
+        }
+    }
+    value = parseFloatSlow(begin, p);
+    return p;
+}
+
+// parses an integer at p, returns the position after it, or nullptr if there is none
+inline const char *parseInt(const char *p, const char *end, int64_t &value){
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p >= end || !isDigit(*p))
+        return nullptr;
+    int64_t result = 0;
+    for (; p < end && isDigit(*p); p++)
+        result = std::min<int64_t>(result * 10 + (*p - '0'), int64_t(1) << 40);
+    value = negative ? -result : result;
+    return p;
+}
+
+// what a part of the file contains, the first pass counts it, the second pass fills it
+struct Counts {
+    size_t positions = 0, uvs = 0, normals = 0, triangles = 0;
+};
+
+struct Chunk {
+    const char *begin, *end;
+    Counts count, offset; // what the chunk contains, and where its part starts in the arrays
+    std::vector<Data::Group> groups;
+    const char *errorAt = nullptr;
+    std::string error;
+};
+
+// first pass: counts the elements of the chunk, only the faces are tokenized
+inline void countChunk(Chunk &chunk){
+    Counts count;
+    const char *p = chunk.begin, *end = chunk.end;
+    while (p < end) {
+        p = skipBlanks(p, end);
+        Keyword keyword;
+        p = readKeyword(p, end, keyword);
+        switch (keyword) {
+            case Keyword::position: count.positions++; break;
+            case Keyword::uv: count.uvs++; break;
+            case Keyword::normal: count.normals++; break;
+            case Keyword::face: {
+                unsigned int corners = 0;
+                for (p = skipBlanks(p, end); p < end && *p != '\n' && *p != '#'; p = skipBlanks(p, end)) {
+                    p = skipToken(p, end);
+                    corners++;
+                }
+                if (corners > 2)
+                    count.triangles += corners - 2;
+                break;
+            }
+            default: break;
+        }
+        p = skipLine(p, end);
+    }
+    chunk.count = count;
+}
+
+// resolves a 1 based (or negative, relative to the elements defined so far) index into a 0 based index
+inline bool resolveIndex(int64_t index, size_t definedSoFar, size_t total, uint32_t &resolved){
+    int64_t zeroBased = index > 0 ? index - 1 : (int64_t) definedSoFar + index;
+    if (index == 0 || zeroBased < 0 || zeroBased >= (int64_t) total)
+        return false;
+    resolved = (uint32_t) zeroBased;
+    return true;
+}
+
+// second pass: parses the chunk, and writes its elements at its offsets in the arrays of data
+inline void parseChunk(Chunk &chunk, Data &data, const Counts &total){
+    float *position = data.positions.data() + chunk.offset.positions * 3;
+    float *uv = data.uvs.data() + chunk.offset.uvs * 2;
+    float *normal = data.normals.data() + chunk.offset.normals * 3;
+    uint32_t *corner = data.corners.data() + chunk.offset.triangles * 9;
+    Counts defined = chunk.offset;
+
+    const char *p = chunk.begin, *end = chunk.end;
+    auto fail = [&](const char *at, const char *message){
+        chunk.errorAt = at;
+        chunk.error = message;
+    };
+    // reads count floats, the ones that are not in the file are 0
+    auto readFloats = [&](float *out, int count, int required) -> bool {
+        for (int i = 0; i < count; i++) {
+            p = skipBlanks(p, end);
+            const char *next = p < end && *p != '\n' ? parseFloat(p, end, out[i]) : nullptr;
+            if (!next) {
+                if (i < required) {
+                    fail(p, "expected a number");
+                    return false;
+                }
+                for (; i < count; i++) out[i] = 0.f;
+                return true;
+            }
+            p = next;
+        }
+        return true;
+    };
+
+    while (p < end) {
+        p = skipBlanks(p, end);
+        Keyword keyword;
+        const char *line = p;
+        p = readKeyword(p, end, keyword);
+        switch (keyword) {
+            case Keyword::position:
+                if (!readFloats(position, 3, 3)) return;
+                position += 3;
+                defined.positions++;
+                break;
+            case Keyword::uv:
+                if (!readFloats(uv, 2, 1)) return;
+                uv += 2;
+                defined.uvs++;
+                break;
+            case Keyword::normal:
+                if (!readFloats(normal, 3, 3)) return;
+                normal += 3;
+                defined.normals++;
+                break;
+            case Keyword::face: {
+                // corners are v, v/t, v//n or v/t/n, the first corner and the previous one make a triangle with each new one
+                uint32_t first[3], previous[3];
+                unsigned int corners = 0;
+                for (p = skipBlanks(p, end); p < end && *p != '\n' && *p != '#'; p = skipBlanks(p, end)) {
+                    uint32_t current[3] = {missing, missing, missing};
+                    const size_t definedSoFar[3] = {defined.positions, defined.uvs, defined.normals};
+                    const size_t totals[3] = {total.positions, total.uvs, total.normals};
+                    for (int attribute = 0; attribute < 3; attribute++) {
+                        if (attribute > 0) {
+                            if (p >= end || *p != '/')
+                                break;
+                            p++;
+                            if (attribute == 1 && p < end && *p == '/')
+                                continue;
+                        }
+                        int64_t index;
+                        const char *next = parseInt(p, end, index);
+                        if (!next) {
+                            fail(p, "expected a face index");
+                            return;
+                        }
+                        if (!resolveIndex(index, definedSoFar[attribute], totals[attribute], current[attribute])) {
+                            fail(p, "face index out of range");
+                            return;
+                        }
+                        p = next;
+                    }
+                    if (p < end && !isBlank(*p) && *p != '\n') {
+                        fail(p, "unexpected character in a face");
+                        return;
+                    }
+                    if (corners == 0)
+                        std::copy(current, current + 3, first);
+                    else if (corners >= 2) {
+                        std::copy(first, first + 3, corner);
+                        std::copy(previous, previous + 3, corner + 3);
+                        std::copy(current, current + 3, corner + 6);
+                        corner += 9;
+                    }
+                    std::copy(current, current + 3, previous);
+                    corners++;
+                }
+                if (corners < 3) {
+                    fail(line, "a face needs at least 3 corners");
+                    return;
+                }
+                break;
+            }
+            case Keyword::group: {
+                // the name is the rest of the line, without the blanks around it
+                const char *name = skipBlanks(p, end), *nameEnd = name;
+                for (p = name; p < end && *p != '\n'; p++)
+                    if (!isBlank(*p)) nameEnd = p + 1;
+                Data::Group group = {std::string(name, nameEnd), (size_t) (corner - data.corners.data()) / 9};
+                chunk.groups.push_back(group);
+                break;
+            }
+            default: break;
+        }
+        p = skipLine(p, end);
+    }
+}
+
+// runs work(i) for every chunk, on one thread per chunk (the first chunk runs on the calling thread)
+template<class Work>
+void forEachChunk(std::vector<Chunk> &chunks, Work work){
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunks.size(); i++)
+        threads.emplace_back(work, i);
+    work(0);
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+} // namespace detail
+
+
+// chunks are at least this big, smaller files are parsed on the calling thread only
+const size_t minChunkSize = 1 << 20;
+
+// parses the OBJ text in [begin, end) into data, with up to threads threads (0 is one per core).
+// Returns false, with a message in data.error, if the text is not valid
+inline bool parse(const char *begin, const char *end, Data &data, unsigned int threads = 0){
+    using namespace detail;
+    data = Data();
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t size = end - begin;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, size / minChunkSize));
+
+    // split at line ends
+    std::vector<Chunk> chunks(chunkCount);
+    const char *chunkBegin = begin;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char *chunkEnd = i + 1 == chunkCount ? end : std::max(chunkBegin, begin + size * (i + 1) / chunkCount);
+        while (chunkEnd < end && chunkEnd > begin && chunkEnd[-1] != '\n') chunkEnd++;
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    forEachChunk(chunks, [&](size_t i){ countChunk(chunks[i]); });
+
+    Counts total;
+    for (Chunk &chunk : chunks) {
+        chunk.offset = total;
+        total.positions += chunk.count.positions;
+        total.uvs += chunk.count.uvs;
+        total.normals += chunk.count.normals;
+        total.triangles += chunk.count.triangles;
+    }
+    if (total.positions >= missing || total.uvs >= missing || total.normals >= missing) {
+        data.error = "too many elements";
+        return false;
+    }
+    data.positions.resize(total.positions * 3);
+    data.uvs.resize(total.uvs * 2);
+    data.normals.resize(total.normals * 3);
+    data.corners.resize(total.triangles * 9);
+
+    forEachChunk(chunks, [&](size_t i){ parseChunk(chunks[i], data, total); });
+
+    for (const Chunk &chunk : chunks) {
+        if (chunk.errorAt) {
+            size_t line = 1 + std::count(begin, chunk.errorAt, '\n');
+            data.error = "line " + std::to_string(line) + ": " + chunk.error;
+            data.positions.clear(); data.uvs.clear(); data.normals.clear(); data.corners.clear();
+            return false;
+        }
+        data.groups.insert(data.groups.end(), chunk.groups.begin(), chunk.groups.end());
+    }
+    return true;
+}
+
+// maps the file at path and parses it, see parse()
+inline bool load(const char *path, Data &data, unsigned int threads = 0){
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        data = Data();
+        data.error = std::string("can not open ") + path;
+        return false;
+    }
+    return parse(file.data(), file.data() + file.size(), data, threads);
+}
+
+} // namespace obj
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_OBJ_PARSER_H
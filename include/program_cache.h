@@ -0,0 +1,206 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_PROGRAM_CACHE_H
+#define ITU_GRAPHICS_PROGRAMMING_PROGRAM_CACHE_H
+
+#include "gl_features.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+
+// an on disk cache of linked shader programs, so a program is compiled once and not at every start
+//
+// The driver gives the linked program as a binary blob (glGetProgramBinary), in a format of its own that only the same
+// driver on the same GPU can load back (glProgramBinary). Each program is kept in a file of the cache directory,
+// named after the paths of its shader files: the file stores the binary with a key, a hash of the sources of the
+// shaders and of the vendor, renderer and version of the driver. The binary is used if the key is the same, else
+// (the sources were edited, or the driver was updated) the program is compiled again and the file replaced.
+// The driver can still refuse a binary (e.g. its format changed without a new version string), then load() fails
+// and the program is compiled as if there was no cache.
+// Without GL 4.1 or ARB_get_program_binary, or with a driver that has no binary format, nothing is cached. That is
+// checked on the context at run time (see gl_features.h), the glad header of the repo is only for GL 3.3.
+namespace programcache {
+
+const char magic[8] = {'I', 'T', 'U', 'P', 'R', 'O', 'G', '\0'};
+// increase it when the format changes, files of another version are compiled again
+const uint32_t version = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t binaryFormat; // the GLenum given by glGetProgramBinary
+    uint64_t key;
+    uint64_t binarySize; // the binary follows the header
+};
+
+// where the programs are kept, relative to the working directory (like the shader files), empty to cache nothing
+inline std::string &directory(){
+    static std::string path = "shader_cache";
+    return path;
+}
+
+namespace detail {
+
+// FNV-1a, the shaders are a few KB so a simple hash is fast enough
+inline uint64_t hash(uint64_t hash, const char *data, size_t size){
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (unsigned char) data[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+inline uint64_t hash(uint64_t value, const std::string &text){
+    // the size goes first, so "ab" + "c" and "a" + "bc" give different keys
+    uint64_t size = text.size();
+    return hash(hash(value, (const char *) &size, sizeof(size)), text.data(), text.size());
+}
+
+inline std::string glString(GLenum name){
+    const GLubyte *text = glGetString(name);
+    return text ? std::string((const char *) text) : std::string();
+}
+
+// the functions of program binaries, all nullptr if the context does not have them or has no binary format
+struct Functions {
+    GLFeatures::GetProgramBinary getProgramBinary = nullptr;
+    GLFeatures::ProgramBinary programBinary = nullptr;
+    GLFeatures::ProgramParameteri programParameteri = nullptr;
+};
+
+// loaded at the first use, the programs of the exercises are all made with one context
+inline const Functions &functions(){
+    static const Functions loaded = [](){
+        using namespace GLFeatures;
+        Functions result;
+        result.getProgramBinary = load<GetProgramBinary>("glGetProgramBinary", 41, "GL_ARB_get_program_binary");
+        result.programBinary = load<ProgramBinary>("glProgramBinary", 41, "GL_ARB_get_program_binary");
+        result.programParameteri = load<ProgramParameteri>("glProgramParameteri", 41, "GL_ARB_get_program_binary");
+        GLint formats = 0;
+        if (result.getProgramBinary && result.programBinary && result.programParameteri)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0 ? result : Functions();
+    }();
+    return loaded;
+}
+
+inline bool supported(){
+    return functions().getProgramBinary != nullptr;
+}
+
+} // namespace detail
+
+const uint64_t emptyKey = 0xCBF29CE484222325ull;
+
+// the key of a program made of these sources with the current driver, add the sources in the order of the stages
+inline uint64_t programKey(const std::vector<std::string> &sources){
+    uint64_t key = emptyKey;
+    key = detail::hash(key, detail::glString(GL_VENDOR));
+    key = detail::hash(key, detail::glString(GL_RENDERER));
+    key = detail::hash(key, detail::glString(GL_VERSION));
+    for (const std::string &source : sources)
+        key = detail::hash(key, source);
+    return key;
+}
+
+// the file of the program made of the shader files at these paths (any of them can be null, e.g. no geometry shader),
+// variant tells apart the programs built from the same files (e.g. with different #define keys)
+inline std::string cachePath(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr,
+                             const std::string &variant = std::string()){
+    uint64_t name = emptyKey;
+    for (const char *path : {vertexPath, fragmentPath, geometryPath})
+        name = detail::hash(name, path ? std::string(path) : std::string());
+    name = detail::hash(name, variant);
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) name);
+    return directory() + "/" + hex + ".program";
+}
+
+// loads the program cached at path in program, if it was built with key and the driver accepts it. On false program
+// is not linked, and can be compiled and linked as usual
+inline bool load(GLuint program, const std::string &path, uint64_t key){
+    if (directory().empty() || !detail::supported())
+        return false;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    Header header;
+    std::vector<char> binary;
+    bool read = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+                header.version == version && header.key == key && header.binarySize > 0;
+    if (read) {
+        binary.resize((size_t) header.binarySize);
+        read = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!read)
+        return false;
+    detail::functions().programBinary(program, header.binaryFormat, binary.data(), (GLsizei) binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+// call it before linking the program, so the driver keeps what store() needs
+inline void prepare(GLuint program){
+    if (!directory().empty() && detail::supported())
+        detail::functions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// writes the linked program to path with key, returns false if it is not linked or it can not be written (a program
+// that is not cached is compiled again at the next start, nothing else changes)
+inline bool store(GLuint program, const std::string &path, uint64_t key){
+    GLint linked = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (directory().empty() || linked != GL_TRUE || !detail::supported())
+        return false;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    Header header = {};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.key = key;
+    std::vector<char> bytes(sizeof(Header) + length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    detail::functions().getProgramBinary(program, length, &written, &format, bytes.data() + sizeof(Header));
+    if (written <= 0)
+        return false;
+    header.binaryFormat = format;
+    header.binarySize = (uint64_t) written;
+    memcpy(bytes.data(), &header, sizeof(Header));
+    bytes.resize(sizeof(Header) + written);
+
+#ifdef _WIN32
+    _mkdir(directory().c_str());
+#else
+    mkdir(directory().c_str(), 0755);
+#endif
+    // written through a temporary file, so a program that stops in the middle does not leave half a file
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    bool saved = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    saved = fclose(file) == 0 && saved;
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+    // elsewhere rename replaces the file at once, a reader sees either the old file or the new one
+    if (!saved || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace programcache
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_PROGRAM_CACHE_H
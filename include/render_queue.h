@@ -0,0 +1,267 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_RENDER_QUEUE_H
+#define ITU_GRAPHICS_PROGRAMMING_RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// the draws of a frame, sorted so that the OpenGL state changes as little as possible between them
+//
+// Instead of binding and drawing each object in the order of the code, drawObjects() adds the draws of the frame to
+// the queue, and submit() issues them. Each draw has a 64 bits key made of, from the highest bits, its program, its
+// vertex array, its material and its depth, and the draws are issued in the order of their keys: the draws of a
+// program are together, in it the draws of a vertex array, and so on, the closest first (so the depth test discards
+// the hidden fragments before they are shaded). glUseProgram, glBindVertexArray and the material are then only set
+// when they differ from the previous draw.
+// The matrices of the draws are computed together before the draws, in one loop over the model matrices added with
+// transform(): the matrix of the model uniform (the model matrix, or model view projection if the shaders want it in
+// clip space) and inverse(transpose(model)) for the programs with the normal uniform. The draws of the parts of an
+// object with the same model matrix share one transform, its matrices are computed once. They are uploaded when the
+// transform differs from the previous draw: the transform is not in the key (a vertex array costs more to change than
+// a matrix), so parts with other vertex arrays (e.g. the body and the wings of the plane) each upload it again.
+// The locations of the uniforms are kept from frame to frame: given by setLocations() (e.g. the ones a Shader keeps),
+// or else looked up by name at the first draw of the program.
+class RenderQueue {
+public:
+    // sets the uniforms of material in program, called before a draw whose program or material differs from the
+    // previous draw. It must set every uniform that differs between materials: the draws are sorted, so the previous
+    // material can be any of them
+    typedef std::function<void(GLuint program, uint32_t material)> MaterialFunction;
+    // draws with the program and the material of the draw set, and its matrices uploaded, for what is not a plain
+    // glDrawElements (e.g. Model::Draw()). It can bind other vertex arrays, not other programs
+    typedef std::function<void(const glm::mat4 &model)> DrawFunction;
+
+    // the key keeps 12 bits for the program, 12 bits for the vertex array (the rank of each in the frame), 16 bits for
+    // the material and 24 bits for the depth. Above 4096 programs or vertex arrays the draws are still right, grouped
+    // a bit less
+    static const uint32_t maxMaterials = 1u << 16;
+
+    // the model matrix of each draw goes in modelUniform, multiplied by the view projection matrix of begin() if
+    // clipSpace is true, and inverse(transpose(model)) in normalUniform if the program has one
+    explicit RenderQueue(bool clipSpace = false, const std::string &modelUniform = "model",
+                         const std::string &normalUniform = "invTransposeModel")
+        : clipSpace(clipSpace), modelUniform(modelUniform), normalUniform(normalUniform) {}
+
+    void setMaterials(MaterialFunction function){
+        materials = std::move(function);
+    }
+
+    // the locations of the model and normal uniforms in program (-1 if it has none), e.g. from Shader::getLocation(),
+    // so submit() does not ask the driver. Give them again when the program is rebuilt: a new program can get the
+    // name of a deleted one
+    void setLocations(GLuint program, GLint model, GLint normal){
+        Locations &locations = find(knownLocations, program);
+        locations.model = model;
+        locations.normal = normal;
+    }
+
+    // starts the draws of a frame seen with viewProjection (for the depth of the draws, and the clip space matrices)
+    void begin(const glm::mat4 &viewProjection){
+        this->viewProjection = viewProjection;
+        models.clear();
+        draws.clear();
+    }
+
+    // adds a model matrix, for the draws that follow, and returns its index
+    uint32_t transform(const glm::mat4 &model){
+        models.push_back(model);
+        return (uint32_t) models.size() - 1;
+    }
+
+    // adds a draw of count indices of the element buffer of vertexArray, from indices (an offset in bytes)
+    void add(GLuint program, GLuint vertexArray, uint32_t material, uint32_t transform, GLsizei count,
+             GLenum indexType = GL_UNSIGNED_INT, const void *indices = nullptr){
+        Draw draw;
+        draw.program = program;
+        draw.vertexArray = vertexArray;
+        draw.material = material;
+        draw.transform = transform;
+        draw.count = count;
+        draw.indexType = indexType;
+        draw.indices = indices;
+        draws.push_back(std::move(draw));
+    }
+
+    // adds a draw made by function, vertexArray is the one it binds, if it is always the same (0 if it is not known)
+    void add(GLuint program, GLuint vertexArray, uint32_t material, uint32_t transform, DrawFunction function){
+        Draw draw;
+        draw.program = program;
+        draw.vertexArray = vertexArray;
+        draw.material = material;
+        draw.transform = transform;
+        draw.function = std::move(function);
+        draws.push_back(std::move(draw));
+    }
+
+    // sorts and issues the draws added since begin(). The program and the vertex array bound are the ones of the last
+    // draw afterwards
+    void submit(){
+        statistics = Stats();
+        statistics.draws = (unsigned int) draws.size();
+        if (draws.empty())
+            return;
+
+        // 1. the keys, and the locations of the uniforms of each program (looked up by name the first time a program
+        // is drawn, if setLocations() did not give them)
+        programs.clear();
+        vertexArrays.clear();
+        order.clear();
+        bool normals = false;
+        for (uint32_t i = 0; i < draws.size(); i++){
+            const Draw &draw = draws[i];
+            uint32_t programRank = rank(programs, draw.program);
+            if (programRank == programs.size() - 1 && programs.back().second.model == unknown){
+                Locations &locations = find(knownLocations, draw.program);
+                if (locations.model == unknown){
+                    locations.model = glGetUniformLocation(draw.program, modelUniform.c_str());
+                    locations.normal = -1;
+                    if (!normalUniform.empty())
+                        locations.normal = glGetUniformLocation(draw.program, normalUniform.c_str());
+                }
+                programs.back().second = locations;
+                normals = normals || locations.normal != -1;
+            }
+            uint64_t key = (uint64_t) std::min(programRank, 0xFFFu) << 52 |
+                           (uint64_t) std::min(rank(vertexArrays, draw.vertexArray), 0xFFFu) << 40 |
+                           (uint64_t) std::min(draw.material, maxMaterials - 1) << 24 |
+                           depthBits(models[draw.transform]);
+            order.emplace_back(key, i);
+        }
+        std::sort(order.begin(), order.end());
+
+        // 2. the matrices of every transform, in one loop
+        uploaded.resize(models.size());
+        for (size_t i = 0; i < models.size(); i++)
+            uploaded[i] = clipSpace ? viewProjection * models[i] : models[i];
+        normalMatrices.resize(normals ? models.size() : 0);
+        for (size_t i = 0; i < normalMatrices.size(); i++)
+            normalMatrices[i] = glm::inverse(glm::transpose(models[i]));
+
+        // 3. the draws, setting only the state that changes
+        const uint32_t none = 0xFFFFFFFFu;
+        GLuint program = 0;
+        const Locations *locations = nullptr;
+        GLuint vertexArray = 0;
+        bool vertexArrayKnown = false;
+        uint32_t material = none, transform = none;
+        for (const auto &entry : order){
+            const Draw &draw = draws[entry.second];
+            if (locations == nullptr || draw.program != program){
+                program = draw.program;
+                locations = &find(programs, program);
+                glUseProgram(program);
+                statistics.programChanges++;
+                // the uniforms are per program
+                material = transform = none;
+            }
+            if (draw.vertexArray != 0 && (!vertexArrayKnown || draw.vertexArray != vertexArray)){
+                glBindVertexArray(draw.vertexArray);
+                vertexArray = draw.vertexArray;
+                vertexArrayKnown = true;
+                statistics.vertexArrayChanges++;
+            }
+            if (draw.material != material && materials){
+                materials(program, draw.material);
+                statistics.materialChanges++;
+            }
+            material = draw.material;
+            if (draw.transform != transform){
+                if (locations->model != -1)
+                    glUniformMatrix4fv(locations->model, 1, GL_FALSE, &uploaded[draw.transform][0][0]);
+                if (locations->normal != -1)
+                    glUniformMatrix4fv(locations->normal, 1, GL_FALSE, &normalMatrices[draw.transform][0][0]);
+                transform = draw.transform;
+                statistics.transformChanges++;
+            }
+            if (draw.function){
+                draw.function(models[draw.transform]);
+                // it may have bound another vertex array
+                vertexArrayKnown = false;
+            }
+            else
+                glDrawElements(GL_TRIANGLES, draw.count, draw.indexType, draw.indices);
+        }
+    }
+
+    // what the last submit() did
+    struct Stats {
+        unsigned int draws = 0;
+        unsigned int programChanges = 0;
+        unsigned int vertexArrayChanges = 0;
+        unsigned int materialChanges = 0;
+        unsigned int transformChanges = 0;
+    };
+    const Stats &stats() const { return statistics; }
+
+private:
+    struct Draw {
+        GLuint program = 0;
+        GLuint vertexArray = 0;
+        uint32_t material = 0;
+        uint32_t transform = 0;
+        GLsizei count = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        const void *indices = nullptr;
+        DrawFunction function;
+    };
+    static const GLint unknown = -2;
+    struct Locations {
+        GLint model = unknown;
+        GLint normal = unknown;
+    };
+
+    // the rank of name in the frame, in the order of the first draw that uses it (there are a few programs and vertex
+    // arrays, and the draws of one are usually added together, so the search is short)
+    template <class Value>
+    static uint32_t rank(std::vector<std::pair<GLuint, Value>> &names, GLuint name){
+        for (size_t i = names.size(); i > 0; i--)
+            if (names[i - 1].first == name)
+                return (uint32_t) i - 1;
+        names.emplace_back(name, Value());
+        return (uint32_t) names.size() - 1;
+    }
+
+    static Locations &find(std::vector<std::pair<GLuint, Locations>> &names, GLuint name){
+        return names[rank(names, name)].second;
+    }
+
+    // the distance of the origin of the model to the camera as 24 bits that sort like it: the w of clip space
+    // (the depth in view space for a perspective projection), whose bits as a positive float sort like the float
+    uint64_t depthBits(const glm::mat4 &model) const{
+        float w = glm::dot(glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3],
+                                     viewProjection[3][3]), model[3]);
+        w = std::max(w, 0.0f);
+        uint32_t bits;
+        memcpy(&bits, &w, sizeof(bits));
+        return bits >> 8;
+    }
+
+    bool clipSpace;
+    std::string modelUniform, normalUniform;
+    MaterialFunction materials;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<glm::mat4> models;
+    std::vector<Draw> draws;
+
+    // the locations of the uniforms of every program drawn so far, or given by setLocations()
+    std::vector<std::pair<GLuint, Locations>> knownLocations;
+
+    // reused from frame to frame
+    std::vector<std::pair<GLuint, Locations>> programs;
+    std::vector<std::pair<GLuint, char>> vertexArrays;
+    std::vector<std::pair<uint64_t, uint32_t>> order;
+    std::vector<glm::mat4> uploaded, normalMatrices;
+    Stats statistics;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_RENDER_QUEUE_H
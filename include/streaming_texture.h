@@ -0,0 +1,154 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_STREAMING_TEXTURE_H
+#define ITU_GRAPHICS_PROGRAMMING_STREAMING_TEXTURE_H
+
+#include <glad/glad.h>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gl_features.h"
+
+
+// a RGBA8 texture that receives a new image every frame from the CPU (e.g. the frame of a software renderer)
+//
+// The texture storage is allocated once. The frames go through a ring of pixel unpack buffers (PBOs):
+//  - beginFrame() returns the memory of the next PBO of the ring, the CPU writes the frame there directly
+//  - endFrame() copies the PBO to the texture, the copy runs on the GPU and the CPU goes on to the next frame
+//  - a fence is placed after the copy, and the PBO is only written again once the GPU is done reading it
+// Several frames can be begun before they end (e.g. when the frames are rendered on another thread, which writes to
+// the memory returned by beginFrame() while this thread makes the OpenGL calls), they end in the order they began.
+// When the context supports it (OpenGL 4.4 or ARB_buffer_storage, checked at run time, see gl_features.h) the PBOs
+// are mapped once, for as long as they exist (persistent mapping), else they are mapped and unmapped every frame,
+// which works on an OpenGL 3.3 context.
+// The memory is mapped for reading too, so the renderer can read back what it wrote (e.g. to blend), but mapped
+// memory can be slower to read than regular memory.
+//
+// like the window, the OpenGL objects live until the program ends (they are released by glfwTerminate)
+class StreamingTexture {
+public:
+    unsigned int W, H;
+
+    // needs a current OpenGL context, ringSize is the number of frames that can be in flight at the same time
+    StreamingTexture(unsigned int width, unsigned int height, unsigned int ringSize = 3) :
+            W(width), H(height), slots(ringSize) {
+        assert(ringSize > 0);
+        using namespace GLFeatures;
+        auto texStorage2D = load<TexStorage2D>("glTexStorage2D", 42, "GL_ARB_texture_storage");
+        auto bufferStorage = load<BufferStorage>("glBufferStorage", 44, "GL_ARB_buffer_storage");
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        if (texStorage2D)
+            texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, W, H);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, W, H, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        GLsizeiptr size = sizeInBytes();
+        persistentMapping = bufferStorage != nullptr;
+        for (Slot &slot : slots) {
+            glGenBuffers(1, &slot.pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            if (persistentMapping) {
+                // CLIENT_STORAGE hints the driver to keep the buffer in CPU memory, where the CPU writes (and reads) it
+                GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+                slot.memory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+                continue;
+            }
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        // the read frame buffer object is used to copy the texture to the window in blit()
+        glGenFramebuffers(1, &readFrameBuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFrameBuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    // returns W * H * 4 bytes of memory where the next frame is written, rows are tightly packed and go bottom to top
+    // (like the textures), the content is the frame written to this PBO ringSize frames ago.
+    // At most ringSize frames can be begun and not ended
+    void *beginFrame(){
+        assert(framesInFlight < slots.size());
+        Slot &slot = slots[beginSlot];
+        // wait until the GPU has copied the previous frame of this PBO to the texture
+        if (slot.fence) {
+            while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        if (!persistentMapping) {
+            // the fence guarantees the GPU is not reading the buffer, so mapping it does not stall
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            slot.memory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sizeInBytes(), GL_MAP_WRITE_BIT | GL_MAP_READ_BIT);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        beginSlot = (beginSlot + 1) % slots.size();
+        framesInFlight++;
+        return slot.memory;
+    }
+
+    // starts copying the oldest frame that was begun and not ended to the texture
+    void endFrame(){
+        assert(framesInFlight > 0);
+        Slot &slot = slots[endSlot];
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (!persistentMapping) {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            slot.memory = nullptr;
+        }
+        // with a PBO bound, the data pointer is an offset in the PBO, the copy does not wait for the GPU
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, W, H, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        endSlot = (endSlot + 1) % slots.size();
+        framesInFlight--;
+    }
+
+    // streams a frame that is already in CPU memory (W * H 32 bits texels)
+    void upload(const void *pixels){
+        std::memcpy(beginFrame(), pixels, sizeInBytes());
+        endFrame();
+    }
+
+    // copies the texture to the whole draw frame buffer (e.g. the window, 0) of size dstW x dstH
+    void blit(int dstW, int dstH, GLuint drawFrameBuffer = 0) const {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFrameBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFrameBuffer);
+        glBlitFramebuffer(0, 0, W, H, 0, 0, dstW, dstH, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    GLuint textureId() const { return texture; }
+
+    // true if the PBOs are persistently mapped
+    bool isPersistentlyMapped() const { return persistentMapping; }
+
+    GLsizeiptr sizeInBytes() const { return (GLsizeiptr) W * H * 4; }
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        void *memory = nullptr;
+        GLsync fence = nullptr;
+    };
+
+    GLuint texture = 0;
+    GLuint readFrameBuffer = 0;
+    std::vector<Slot> slots;
+    unsigned int beginSlot = 0, endSlot = 0, framesInFlight = 0;
+    bool persistentMapping = false;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_STREAMING_TEXTURE_H
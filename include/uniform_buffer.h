@@ -0,0 +1,61 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_UNIFORM_BUFFER_H
+#define ITU_GRAPHICS_PROGRAMMING_UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+
+// a uniform buffer object holding a std140 uniform block, that every program declaring the block reads
+//
+// The uniforms that are the same for every draw of a frame (e.g. the camera and the lights) go in a block, declared
+// in the shaders as
+//   layout (std140) uniform Camera { mat4 projection; mat4 view; vec3 camPosition; };
+// each program connects its block to the binding of the buffer once, with Shader::bindUniformBlock(), and update()
+// uploads the block once per frame for all of them, instead of setting the same uniforms in every program.
+//
+// Block is a C++ struct with the members of the block in the same order, and alignas(16) on every vec3, vec4 and
+// mat4: that is the std140 layout for those types and for float, int and bool (a float after a vec3 takes its 4th
+// component in both). Arrays, whose elements are 16 bytes apart in std140, need padding by hand.
+template <class Block>
+class UniformBuffer {
+public:
+    explicit UniformBuffer(GLuint binding) : binding(binding) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    }
+
+    ~UniformBuffer() {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer &operator=(const UniformBuffer&) = delete;
+
+    // uploads block, unless it has the bytes uploaded last time (keep the block in a global, whose padding is zero,
+    // and assign its members every frame, so that only the members are compared)
+    void update(const Block &block) {
+        if (uploaded && memcmp(&block, &last, sizeof(Block)) == 0)
+            return;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        memcpy(&last, &block, sizeof(Block)); // with the padding, unlike an assignment
+        uploaded = true;
+    }
+
+    // the binding point of the buffer, the one given to Shader::bindUniformBlock()
+    GLuint getBinding() const { return binding; }
+
+private:
+    GLuint binding;
+    GLuint buffer = 0;
+    Block last;
+    bool uploaded = false;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_UNIFORM_BUFFER_H